@@ -360,6 +360,21 @@ block BlockchainDB::get_block_from_height(const uint64_t& height) const
   return b;
 }
 
+block BlockchainDB::get_stripped_block_from_height(const uint64_t& height) const
+{
+  blobdata bd = get_stripped_block_blob_from_height(height);
+  block b;
+  if (!parse_and_validate_block_from_stripped_blob(bd, b))
+    throw DB_ERROR("Failed to parse block from blob retrieved from the db");
+
+  return b;
+}
+
+block BlockchainDB::get_stripped_block(const crypto::hash& h) const
+{
+  return get_stripped_block_from_height(get_block_height(h));
+}
+
 block BlockchainDB::get_block(const crypto::hash& h) const
 {
   blobdata bd = get_block_blob(h);
@@ -949,6 +949,46 @@ public:
    */
   virtual block get_block_from_height(const uint64_t& height) const;
 
+  /**
+   * @brief fetch a block blob by height, without its quantum signatures
+   *
+   * The subclass should return the block at the given height with empty
+   * quantum signature fields (see split_block_quantum_signatures). It has
+   * the same block id as the full block, and is meant for callers which
+   * only need the header, miner tx or tx hashes.
+   *
+   * If the block does not exist, that is to say if the blockchain is not
+   * that high, then the subclass should throw BLOCK_DNE
+   *
+   * @param height the height to look for
+   *
+   * @return the stripped block blob
+   */
+  virtual cryptonote::blobdata get_stripped_block_blob_from_height(const uint64_t& height) const = 0;
+
+  /**
+   * @brief fetch a block by height, without its quantum signatures
+   *
+   * If the block does not exist, that is to say if the blockchain is not
+   * that high, then the subclass should throw BLOCK_DNE
+   *
+   * @param height the height to look for
+   *
+   * @return the block, with empty quantum signatures
+   */
+  virtual block get_stripped_block_from_height(const uint64_t& height) const;
+
+  /**
+   * @brief fetch a block by hash, without its quantum signatures
+   *
+   * If the block does not exist, the subclass should throw BLOCK_DNE
+   *
+   * @param h the hash to look for
+   *
+   * @return the block, with empty quantum signatures
+   */
+  virtual block get_stripped_block(const crypto::hash& h) const;
+
   /**
    * @brief fetch a block's timestamp
    *
@@ -1025,6 +1065,19 @@ public:
    */
   virtual difficulty_type get_block_cumulative_difficulty(const uint64_t& height) const = 0;
 
+  /**
+   * @brief fetch a range of blocks' timestamps and cumulative difficulties
+   *
+   * If there are fewer than count blocks from start_height, the returned
+   * arrays will be smaller than count
+   *
+   * @param start_height the height of the first block requested
+   * @param count the number of blocks requested
+   * @param timestamps return-by-reference the timestamps
+   * @param cumulative_difficulties return-by-reference the cumulative difficulties
+   */
+  virtual void get_block_timestamps_and_cumulative_difficulties(uint64_t start_height, size_t count, std::vector<uint64_t> &timestamps, std::vector<difficulty_type> &cumulative_difficulties) const = 0;
+
   /**
    * @brief fetch a block's difficulty
    *
@@ -1320,12 +1373,13 @@ public:
    * @param pruned whether to return full or pruned tx data
    * @param skip_coinbase whether to return or skip coinbase transactions (they're in blocks regardless)
    * @param get_miner_tx_hash whether to calculate and return the miner (coinbase) tx hash
+   * @param with_quantum_signatures whether to return full block blobs, or blobs with empty quantum signatures
    *
    * The call will return at least min_block_count if possible, even if this contravenes max_tx_count
    *
    * @return true iff the blocks and transactions were found
    */
-  virtual bool get_blocks_from(uint64_t start_height, size_t min_block_count, size_t max_block_count, size_t max_tx_count, size_t max_size, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata>>>>& blocks, bool pruned, bool skip_coinbase, bool get_miner_tx_hash) const = 0;
+  virtual bool get_blocks_from(uint64_t start_height, size_t min_block_count, size_t max_block_count, size_t max_tx_count, size_t max_size, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata>>>>& blocks, bool pruned, bool skip_coinbase, bool get_miner_tx_hash, bool with_quantum_signatures) const = 0;
 
   /**
    * @brief fetches the prunable transaction blob with the given hash
@@ -1677,6 +1731,29 @@ public:
    */
   virtual void drop_alt_blocks() = 0;
 
+  /**
+   * @brief remember the PoW hash of a block whose PoW was verified
+   *
+   * Entries are kept when the block is popped or reorganized away, so
+   * that it can be verified again without recomputing its PoW. Entries
+   * far enough below the highest height stored are pruned.
+   *
+   * @param blkid the block hash
+   * @param pow_hash the PoW hash of the block
+   * @param height the height of the block
+   */
+  virtual void add_block_pow_hash(const crypto::hash &blkid, const crypto::hash &pow_hash, uint64_t height) = 0;
+
+  /**
+   * @brief get the PoW hash stored by add_block_pow_hash
+   *
+   * @param blkid the block hash
+   * @param pow_hash return-by-reference the PoW hash of the block
+   *
+   * @return true if the PoW hash of the block was found, false otherwise
+   */
+  virtual bool get_block_pow_hash(const crypto::hash &blkid, crypto::hash &pow_hash) const = 0;
+
   /**
    * @brief runs a function over all txpool transactions
    *
@@ -1712,6 +1789,7 @@ public:
    *
    * The subclass should run the passed function for each block in the
    * specified range, passing (block_height, block_hash, block) as its parameters.
+   * The blocks passed do not carry their quantum signatures.
    *
    * If any call to the function returns false, the subclass should return
    * false.  Otherwise, the subclass returns true.
@@ -58,7 +58,13 @@ using epee::string_tools::pod_to_hex;
 using namespace crypto;
 
 // Increase when the DB structure changes
-#define VERSION 5
+#define VERSION 6
+
+// block_pow_hashes keeps entries for this many blocks below the highest
+// height stored, and is pruned each time that height crosses a multiple of
+// the interval
+#define BLOCK_POW_HASHES_KEEP 10000
+#define BLOCK_POW_HASHES_PRUNE_INTERVAL 1000
 
 namespace
 {
@@ -187,9 +193,10 @@ namespace
  *
  * Table            Key          Data
  * -----            ---          ----
- * blocks           block ID     block blob
+ * blocks           block ID     block blob, quantum signatures stripped
  * block_heights    block hash   block height
  * block_info       block ID     {block metadata}
+ * block_quantum_sigs block ID   serialized block quantum signatures
  *
  * txs_pruned       txn ID       pruned txn blob
  * txs_prunable     txn ID       prunable txn blob
@@ -207,6 +214,7 @@ namespace
  * txpool_blob      txn hash     txn blob
  *
  * alt_blocks       block hash   {block data, block blob}
+ * block_pow_hashes block hash   {PoW hash, block height}, for blocks whose PoW was verified
  *
  * Note: where the data items are of uniform size, DUPFIXED tables have
  * been used to save space. In most of these cases, a dummy "zerokval"
@@ -219,6 +227,7 @@ namespace
 const char* const LMDB_BLOCKS = "blocks";
 const char* const LMDB_BLOCK_HEIGHTS = "block_heights";
 const char* const LMDB_BLOCK_INFO = "block_info";
+const char* const LMDB_BLOCK_QUANTUM_SIGS = "block_quantum_sigs";
 
 const char* const LMDB_TXS = "txs";
 const char* const LMDB_TXS_PRUNED = "txs_pruned";
@@ -236,6 +245,7 @@ const char* const LMDB_TXPOOL_META = "txpool_meta";
 const char* const LMDB_TXPOOL_BLOB = "txpool_blob";
 
 const char* const LMDB_ALT_BLOCKS = "alt_blocks";
+const char* const LMDB_BLOCK_POW_HASHES = "block_pow_hashes";
 
 const char* const LMDB_HF_STARTING_HEIGHTS = "hf_starting_heights";
 const char* const LMDB_HF_VERSIONS = "hf_versions";
@@ -257,6 +267,20 @@ inline void lmdb_db_open(MDB_txn* txn, const char* name, int flags, MDB_dbi& dbi
     throw0(cryptonote::DB_OPEN_FAILURE((lmdb_error(error_string + " : ", res) + std::string(" - you may want to start with --db-salvage")).c_str()));
 }
 
+// reassembles the full blob of the block at height from its stripped blob
+// and the matching block_quantum_sigs entry
+void join_block_blob(MDB_cursor *cur_block_quantum_sigs, uint64_t height, const MDB_val &stripped, cryptonote::blobdata &bd)
+{
+  MDB_val_copy<uint64_t> key(height);
+  MDB_val v;
+  if (auto result = mdb_cursor_get(cur_block_quantum_sigs, &key, &v, MDB_SET))
+    throw0(cryptonote::DB_ERROR(lmdb_error("Error attempting to retrieve block quantum signatures from the db: ", result).c_str()));
+  const cryptonote::blobdata_ref stripped_blob{reinterpret_cast<const char*>(stripped.mv_data), stripped.mv_size};
+  const cryptonote::blobdata_ref quantum_signatures_blob{reinterpret_cast<const char*>(v.mv_data), v.mv_size};
+  if (!cryptonote::join_block_quantum_signatures(stripped_blob, quantum_signatures_blob, bd))
+    throw0(cryptonote::DB_ERROR("Failed to join quantum signatures to block blob"));
+}
+
 
 }  // anonymous namespace
 
@@ -807,14 +831,25 @@ void BlockchainLMDB::add_block(const block& blk, size_t block_weight, uint64_t l
 
   CURSOR(blocks)
   CURSOR(block_info)
+  CURSOR(block_quantum_sigs)
+
+  // quantum signatures are kept apart from the block blob, so that header
+  // and scan paths do not have to page them in
+  cryptonote::blobdata stripped_blob, quantum_signatures_blob;
+  if (!split_block_quantum_signatures(block_to_blob(blk), blk, stripped_blob, quantum_signatures_blob))
+    throw0(DB_ERROR("Failed to split quantum signatures from block blob"));
 
   // this call to mdb_cursor_put will change height()
-  cryptonote::blobdata block_blob(block_to_blob(blk));
-  MDB_val_sized(blob, block_blob);
+  MDB_val_sized(blob, stripped_blob);
   result = mdb_cursor_put(m_cur_blocks, &key, &blob, MDB_APPEND);
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to add block blob to db transaction: ", result).c_str()));
 
+  MDB_val_sized(qsig, quantum_signatures_blob);
+  result = mdb_cursor_put(m_cur_block_quantum_sigs, &key, &qsig, MDB_APPEND);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to add block quantum signatures to db transaction: ", result).c_str()));
+
   mdb_block_info bi;
   bi.bi_height = m_height;
   bi.bi_timestamp = blk.timestamp;
@@ -865,6 +900,7 @@ void BlockchainLMDB::remove_block()
   CURSOR(block_info)
   CURSOR(block_heights)
   CURSOR(blocks)
+  CURSOR(block_quantum_sigs)
   MDB_val_copy<uint64_t> k(m_height - 1);
   MDB_val h = k;
   if ((result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &h, MDB_GET_BOTH)))
@@ -883,6 +919,12 @@ void BlockchainLMDB::remove_block()
   if ((result = mdb_cursor_del(m_cur_blocks, 0)))
       throw1(DB_ERROR(lmdb_error("Failed to add removal of block to db transaction: ", result).c_str()));
 
+  MDB_val_copy<uint64_t> qk(m_height - 1);
+  if ((result = mdb_cursor_get(m_cur_block_quantum_sigs, &qk, NULL, MDB_SET)))
+      throw1(DB_ERROR(lmdb_error("Failed to locate block quantum signatures for removal: ", result).c_str()));
+  if ((result = mdb_cursor_del(m_cur_block_quantum_sigs, 0)))
+      throw1(DB_ERROR(lmdb_error("Failed to add removal of block quantum signatures to db transaction: ", result).c_str()));
+
   if ((result = mdb_cursor_del(m_cur_block_info, 0)))
       throw1(DB_ERROR(lmdb_error("Failed to add removal of block info to db transaction: ", result).c_str()));
 }
@@ -1485,6 +1527,15 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
   lmdb_db_open(txn, LMDB_BLOCKS, MDB_INTEGERKEY | MDB_CREATE, m_blocks, "Failed to open db handle for m_blocks");
 
   lmdb_db_open(txn, LMDB_BLOCK_INFO, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_block_info, "Failed to open db handle for m_block_info");
+  // added in v6, so a read only open of an older db must get to the version
+  // check below to be told it needs converting
+  if (!(mdb_flags & MDB_RDONLY))
+    lmdb_db_open(txn, LMDB_BLOCK_QUANTUM_SIGS, MDB_INTEGERKEY | MDB_CREATE, m_block_quantum_sigs, "Failed to open db handle for m_block_quantum_sigs");
+  else if (auto res = mdb_dbi_open(txn, LMDB_BLOCK_QUANTUM_SIGS, MDB_INTEGERKEY, &m_block_quantum_sigs))
+  {
+    if (res != MDB_NOTFOUND)
+      throw0(DB_OPEN_FAILURE(lmdb_error("Failed to open db handle for m_block_quantum_sigs: ", res).c_str()));
+  }
   lmdb_db_open(txn, LMDB_BLOCK_HEIGHTS, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_block_heights, "Failed to open db handle for m_block_heights");
 
   lmdb_db_open(txn, LMDB_TXS, MDB_INTEGERKEY | MDB_CREATE, m_txs, "Failed to open db handle for m_txs");
@@ -1506,6 +1557,17 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
 
   lmdb_db_open(txn, LMDB_ALT_BLOCKS, MDB_CREATE, m_alt_blocks, "Failed to open db handle for m_alt_blocks");
 
+  // a cache, so a read only open of a db predating it just goes without
+  m_block_pow_hashes_open = true;
+  if (!(mdb_flags & MDB_RDONLY))
+    lmdb_db_open(txn, LMDB_BLOCK_POW_HASHES, MDB_CREATE, m_block_pow_hashes, "Failed to open db handle for m_block_pow_hashes");
+  else if (auto res = mdb_dbi_open(txn, LMDB_BLOCK_POW_HASHES, 0, &m_block_pow_hashes))
+  {
+    if (res != MDB_NOTFOUND)
+      throw0(DB_OPEN_FAILURE(lmdb_error("Failed to open db handle for m_block_pow_hashes: ", res).c_str()));
+    m_block_pow_hashes_open = false;
+  }
+
   // this subdb is dropped on sight, so it may not be present when we open the DB.
   // Since we use MDB_CREATE, we'll get an exception if we open read-only and it does not exist.
   // So we don't open for read-only, and also not drop below. It is not used elsewhere.
@@ -1530,6 +1592,8 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
   mdb_set_compare(txn, m_txpool_meta, compare_hash32);
   mdb_set_compare(txn, m_txpool_blob, compare_hash32);
   mdb_set_compare(txn, m_alt_blocks, compare_hash32);
+  if (m_block_pow_hashes_open)
+    mdb_set_compare(txn, m_block_pow_hashes, compare_hash32);
   mdb_set_compare(txn, m_properties, compare_string);
 
   if (!(mdb_flags & MDB_RDONLY))
@@ -1677,6 +1741,8 @@ void BlockchainLMDB::reset()
     throw0(DB_ERROR(lmdb_error("Failed to drop m_blocks: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_block_info, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_block_info: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_block_quantum_sigs, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_block_quantum_sigs: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_block_heights, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_block_heights: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_txs_pruned, 0))
@@ -2502,7 +2568,7 @@ block_header BlockchainLMDB::get_block_header(const crypto::hash& h) const
   check_open();
 
   // block_header object is automatically cast from block object
-  return get_block(h);
+  return get_stripped_block(h);
 }
 
 cryptonote::blobdata BlockchainLMDB::get_block_blob_from_height(const uint64_t& height) const
@@ -2510,6 +2576,33 @@ cryptonote::blobdata BlockchainLMDB::get_block_blob_from_height(const uint64_t&
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
 
+  TXN_PREFIX_RDONLY();
+  RCURSOR(blocks);
+  RCURSOR(block_quantum_sigs);
+
+  MDB_val_copy<uint64_t> key(height);
+  MDB_val result;
+  auto get_result = mdb_cursor_get(m_cur_blocks, &key, &result, MDB_SET);
+  if (get_result == MDB_NOTFOUND)
+  {
+    throw0(BLOCK_DNE(std::string("Attempt to get block from height ").append(boost::lexical_cast<std::string>(height)).append(" failed -- block not in db").c_str()));
+  }
+  else if (get_result)
+    throw0(DB_ERROR("Error attempting to retrieve a block from the db"));
+
+  blobdata bd;
+  join_block_blob(m_cur_block_quantum_sigs, height, result, bd);
+
+  TXN_POSTFIX_RDONLY();
+
+  return bd;
+}
+
+cryptonote::blobdata BlockchainLMDB::get_stripped_block_blob_from_height(const uint64_t& height) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
   TXN_PREFIX_RDONLY();
   RCURSOR(blocks);
 
@@ -2795,6 +2888,67 @@ difficulty_type BlockchainLMDB::get_block_cumulative_difficulty(const uint64_t&
   return ret;
 }
 
+void BlockchainLMDB::get_block_timestamps_and_cumulative_difficulties(uint64_t start_height, size_t count, std::vector<uint64_t> &timestamps, std::vector<difficulty_type> &cumulative_difficulties) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  timestamps.clear();
+  cumulative_difficulties.clear();
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_info);
+
+  const uint64_t h = height();
+  if (start_height >= h)
+    throw0(DB_ERROR(("Height " + std::to_string(start_height) + " not in blockchain").c_str()));
+
+  count = std::min<uint64_t>(count, h - start_height);
+  timestamps.reserve(count);
+  cumulative_difficulties.reserve(count);
+
+  MDB_val v;
+  uint64_t range_begin = 0, range_end = 0;
+  for (uint64_t height = start_height; count--; ++height)
+  {
+    if (height >= range_begin && height < range_end)
+    {
+      // nothing to do
+    }
+    else
+    {
+      int result = 0;
+      if (range_end > 0)
+      {
+        MDB_val k2;
+        result = mdb_cursor_get(m_cur_block_info, &k2, &v, MDB_NEXT_MULTIPLE);
+        range_begin = ((const mdb_block_info*)v.mv_data)->bi_height;
+        range_end = range_begin + v.mv_size / sizeof(mdb_block_info); // whole records please
+        if (height < range_begin || height >= range_end)
+          throw0(DB_ERROR(("Height " + std::to_string(height) + " not included in multiple record range: " + std::to_string(range_begin) + "-" + std::to_string(range_end)).c_str()));
+      }
+      else
+      {
+        v.mv_size = sizeof(uint64_t);
+        v.mv_data = (void*)&height;
+        result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &v, MDB_GET_BOTH);
+        range_begin = height;
+        range_end = range_begin + 1;
+      }
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Error attempting to retrieve block_info from the db: ", result).c_str()));
+    }
+    const mdb_block_info *bi = ((const mdb_block_info *)v.mv_data) + (height - range_begin);
+    timestamps.push_back(bi->bi_timestamp);
+    difficulty_type cumulative_difficulty = bi->bi_diff_hi;
+    cumulative_difficulty <<= 64;
+    cumulative_difficulty |= bi->bi_diff_lo;
+    cumulative_difficulties.push_back(cumulative_difficulty);
+  }
+
+  TXN_POSTFIX_RDONLY();
+}
+
 difficulty_type BlockchainLMDB::get_block_difficulty(const uint64_t& height) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -2831,8 +2985,17 @@ void BlockchainLMDB::correct_block_cumulative_difficulties(const uint64_t& start
 
   for (uint64_t height = start_height; height < bc_height; ++height)
   {
+    // one lookup, then walk the heights in order
     MDB_val_set(key, height);
-    result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &key, MDB_GET_BOTH);
+    if (height == start_height)
+      result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &key, MDB_GET_BOTH);
+    else
+    {
+      MDB_val k;
+      result = mdb_cursor_get(m_cur_block_info, &k, &key, MDB_NEXT_DUP);
+      if (!result && ((const mdb_block_info*)key.mv_data)->bi_height != height)
+        throw0(DB_ERROR(("Unexpected block info height " + std::to_string(((const mdb_block_info*)key.mv_data)->bi_height) + ", expected " + std::to_string(height)).c_str()));
+    }
     if (result)
       throw1(BLOCK_DNE(lmdb_error("Failed to get block info: ", result).c_str()));
 
@@ -3208,13 +3371,17 @@ bool BlockchainLMDB::get_pruned_tx_blobs_from(const crypto::hash& h, size_t coun
   return true;
 }
 
-bool BlockchainLMDB::get_blocks_from(uint64_t start_height, size_t min_block_count, size_t max_block_count, size_t max_tx_count, size_t max_size, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata>>>>& blocks, bool pruned, bool skip_coinbase, bool get_miner_tx_hash) const
+bool BlockchainLMDB::get_blocks_from(uint64_t start_height, size_t min_block_count, size_t max_block_count, size_t max_tx_count, size_t max_size, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata>>>>& blocks, bool pruned, bool skip_coinbase, bool get_miner_tx_hash, bool with_quantum_signatures) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
 
   TXN_PREFIX_RDONLY();
   RCURSOR(blocks);
+  if (with_quantum_signatures)
+  {
+    RCURSOR(block_quantum_sigs);
+  }
   RCURSOR(tx_indices);
   RCURSOR(txs_pruned);
   if (!pruned)
@@ -3241,12 +3408,15 @@ bool BlockchainLMDB::get_blocks_from(uint64_t start_height, size_t min_block_cou
     blocks.resize(blocks.size() + 1);
     auto &current_block = blocks.back();
 
-    current_block.first.first.assign(reinterpret_cast<char*>(v.mv_data), v.mv_size);
-    size += v.mv_size;
-
     cryptonote::block b;
-    if (!parse_and_validate_block_from_blob(current_block.first.first, b))
+    if (!parse_and_validate_block_from_stripped_blob({reinterpret_cast<const char*>(v.mv_data), v.mv_size}, b))
       throw0(DB_ERROR("Invalid block"));
+
+    if (with_quantum_signatures)
+      join_block_blob(m_cur_block_quantum_sigs, h, v, current_block.first.first);
+    else
+      current_block.first.first.assign(reinterpret_cast<char*>(v.mv_data), v.mv_size);
+    size += current_block.first.first.size();
     current_block.first.second = get_miner_tx_hash ? cryptonote::get_transaction_hash(b.miner_tx) : crypto::null_hash;
 
     // get the tx_id for the first tx (the first block's coinbase tx)
@@ -3643,7 +3813,7 @@ bool BlockchainLMDB::for_blocks_range(const uint64_t& h1, const uint64_t& h2, st
     uint64_t height = *(const uint64_t*)k.mv_data;
     blobdata_ref bd{reinterpret_cast<char*>(v.mv_data), v.mv_size};
     block b;
-    if (!parse_and_validate_block_from_blob(bd, b))
+    if (!parse_and_validate_block_from_stripped_blob(bd, b))
       throw0(DB_ERROR("Failed to parse block from blob retrieved from the db"));
     crypto::hash hash;
     if (!get_block_hash(b, hash))
@@ -4549,6 +4719,81 @@ void BlockchainLMDB::drop_alt_blocks()
   TXN_POSTFIX_SUCCESS();
 }
 
+void BlockchainLMDB::add_block_pow_hash(const crypto::hash &blkid, const crypto::hash &pow_hash, uint64_t height)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  mdb_txn_cursors *m_cursors = &m_wcursors;
+
+  CURSOR(block_pow_hashes)
+
+  MDB_val_set(k, blkid);
+  blk_height bh = {pow_hash, height};
+  MDB_val_set(v, bh);
+  if (auto result = mdb_cursor_put(m_cur_block_pow_hashes, &k, &v, 0))
+    throw1(DB_ERROR(lmdb_error("Error adding block PoW hash to db transaction: ", result).c_str()));
+
+  if (height >= BLOCK_POW_HASHES_KEEP && height % BLOCK_POW_HASHES_PRUNE_INTERVAL == 0)
+    prune_block_pow_hashes(height - BLOCK_POW_HASHES_KEEP);
+}
+
+void BlockchainLMDB::prune_block_pow_hashes(uint64_t min_height)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  mdb_txn_cursors *m_cursors = &m_wcursors;
+
+  CURSOR(block_pow_hashes)
+
+  // Entries are not removed with their blocks, so a popped or reorganized
+  // block verifies again with a lookup; only old heights are dropped
+  uint64_t pruned = 0;
+  MDB_val k, v;
+  MDB_cursor_op op = MDB_FIRST;
+  while (1)
+  {
+    int result = mdb_cursor_get(m_cur_block_pow_hashes, &k, &v, op);
+    op = MDB_NEXT;
+    if (result == MDB_NOTFOUND)
+      break;
+    if (result)
+      throw1(DB_ERROR(lmdb_error("Failed to enumerate block PoW hashes: ", result).c_str()));
+    if (v.mv_size == sizeof(blk_height) && ((const blk_height*)v.mv_data)->bh_height >= min_height)
+      continue;
+    if ((result = mdb_cursor_del(m_cur_block_pow_hashes, 0)))
+      throw1(DB_ERROR(lmdb_error("Error adding removal of block PoW hash to db transaction: ", result).c_str()));
+    ++pruned;
+  }
+  MDEBUG("Pruned " << pruned << " block PoW hashes below height " << min_height);
+}
+
+bool BlockchainLMDB::get_block_pow_hash(const crypto::hash &blkid, crypto::hash &pow_hash) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  if (!m_block_pow_hashes_open)
+    return false;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_pow_hashes);
+
+  MDB_val_set(k, blkid);
+  MDB_val v;
+  int result = mdb_cursor_get(m_cur_block_pow_hashes, &k, &v, MDB_SET);
+  if (result == MDB_NOTFOUND)
+    return false;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Error attempting to retrieve PoW hash of block " + epee::string_tools::pod_to_hex(blkid) + " from the db: ", result).c_str()));
+  if (v.mv_size != sizeof(blk_height)) // written without a height, pruned later
+    return false;
+
+  pow_hash = ((const blk_height*)v.mv_data)->bh_hash;
+
+  TXN_POSTFIX_RDONLY();
+  return true;
+}
+
 bool BlockchainLMDB::is_read_only() const
 {
   unsigned int flags;
@@ -5704,6 +5949,101 @@ void BlockchainLMDB::migrate_4_5()
   txn.commit();
 }
 
+void BlockchainLMDB::migrate_5_6()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  uint64_t i;
+  int result;
+  mdb_txn_safe txn(false);
+  MDB_val k, v;
+
+  MGINFO_YELLOW("Migrating blockchain from DB version 5 to 6 - this may take a while:");
+
+  do {
+    LOG_PRINT_L1("moving block quantum signatures to their own table:");
+
+    result = mdb_txn_begin(m_env, NULL, 0, txn);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+
+    MDB_stat db_stats;
+    if ((result = mdb_stat(txn, m_blocks, &db_stats)))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_blocks: ", result).c_str()));
+    const uint64_t blockchain_height = db_stats.ms_entries;
+
+    MDB_cursor *c_blocks, *c_quantum_sigs;
+    i = 0;
+    while(1) {
+      if (!(i % 1000)) {
+        if (i) {
+          LOGIF(el::Level::Info) {
+            std::cout << i << " / " << blockchain_height << "  \r" << std::flush;
+          }
+          txn.commit();
+          result = mdb_txn_begin(m_env, NULL, 0, txn);
+          if (result)
+            throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+        }
+        result = mdb_cursor_open(txn, m_blocks, &c_blocks);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor for blocks: ", result).c_str()));
+        result = mdb_cursor_open(txn, m_block_quantum_sigs, &c_quantum_sigs);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor for block_quantum_sigs: ", result).c_str()));
+        if (!i) {
+          /* blocks below the number of block_quantum_sigs entries were already
+           * split by an interrupted previous run, since both tables are
+           * written in the same txn.
+           */
+          result = mdb_stat(txn, m_block_quantum_sigs, &db_stats);
+          if (result)
+            throw0(DB_ERROR(lmdb_error("Failed to query m_block_quantum_sigs: ", result).c_str()));
+          i = db_stats.ms_entries;
+        }
+      }
+      if (i >= blockchain_height) {
+        txn.commit();
+        break;
+      }
+      k.mv_data = &i;
+      k.mv_size = sizeof(i);
+      result = mdb_cursor_get(c_blocks, &k, &v, MDB_SET);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to get a record from blocks: ", result).c_str()));
+
+      const cryptonote::blobdata bd(reinterpret_cast<const char*>(v.mv_data), v.mv_size);
+      block b;
+      if (!parse_and_validate_block_from_stripped_blob(bd, b))
+        throw0(DB_ERROR("Failed to parse block from blob retrieved from the db"));
+      cryptonote::blobdata stripped_blob, quantum_signatures_blob;
+      if (!split_block_quantum_signatures(bd, b, stripped_blob, quantum_signatures_blob))
+        throw0(DB_ERROR("Failed to split quantum signatures from block blob"));
+
+      MDB_val_sized(qv, quantum_signatures_blob);
+      result = mdb_cursor_put(c_quantum_sigs, &k, &qv, MDB_APPEND);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to put a record into block_quantum_sigs: ", result).c_str()));
+      MDB_val_sized(nv, stripped_blob);
+      result = mdb_cursor_put(c_blocks, &k, &nv, MDB_CURRENT);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to update a record in blocks: ", result).c_str()));
+      i++;
+    }
+  } while(0);
+
+  uint32_t version = 6;
+  v.mv_data = (void *)&version;
+  v.mv_size = sizeof(version);
+  MDB_val_str(vk, "version");
+  result = mdb_txn_begin(m_env, NULL, 0, txn);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+  result = mdb_put(txn, m_properties, &vk, &v, 0);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to update version for the db: ", result).c_str()));
+  txn.commit();
+}
+
 void BlockchainLMDB::migrate(const uint32_t oldversion)
 {
   if (oldversion < 1)
@@ -5716,6 +6056,8 @@ void BlockchainLMDB::migrate(const uint32_t oldversion)
     migrate_3_4();
   if (oldversion < 5)
     migrate_4_5();
+  if (oldversion < 6)
+    migrate_5_6();
 }
 
 }  // namespace cryptonote
@@ -50,6 +50,7 @@ typedef struct mdb_txn_cursors
   MDB_cursor *m_txc_blocks;
   MDB_cursor *m_txc_block_heights;
   MDB_cursor *m_txc_block_info;
+  MDB_cursor *m_txc_block_quantum_sigs;
 
   MDB_cursor *m_txc_output_txs;
   MDB_cursor *m_txc_output_amounts;
@@ -68,6 +69,7 @@ typedef struct mdb_txn_cursors
   MDB_cursor *m_txc_txpool_blob;
 
   MDB_cursor *m_txc_alt_blocks;
+  MDB_cursor *m_txc_block_pow_hashes;
 
   MDB_cursor *m_txc_hf_versions;
 
@@ -77,6 +79,7 @@ typedef struct mdb_txn_cursors
 #define m_cur_blocks	m_cursors->m_txc_blocks
 #define m_cur_block_heights	m_cursors->m_txc_block_heights
 #define m_cur_block_info	m_cursors->m_txc_block_info
+#define m_cur_block_quantum_sigs	m_cursors->m_txc_block_quantum_sigs
 #define m_cur_output_txs	m_cursors->m_txc_output_txs
 #define m_cur_output_amounts	m_cursors->m_txc_output_amounts
 #define m_cur_txs	m_cursors->m_txc_txs
@@ -90,6 +93,7 @@ typedef struct mdb_txn_cursors
 #define m_cur_txpool_meta	m_cursors->m_txc_txpool_meta
 #define m_cur_txpool_blob	m_cursors->m_txc_txpool_blob
 #define m_cur_alt_blocks	m_cursors->m_txc_alt_blocks
+#define m_cur_block_pow_hashes	m_cursors->m_txc_block_pow_hashes
 #define m_cur_hf_versions	m_cursors->m_txc_hf_versions
 #define m_cur_properties	m_cursors->m_txc_properties
 
@@ -99,6 +103,7 @@ typedef struct mdb_rflags
   bool m_rf_blocks;
   bool m_rf_block_heights;
   bool m_rf_block_info;
+  bool m_rf_block_quantum_sigs;
   bool m_rf_output_txs;
   bool m_rf_output_amounts;
   bool m_rf_txs;
@@ -112,6 +117,7 @@ typedef struct mdb_rflags
   bool m_rf_txpool_meta;
   bool m_rf_txpool_blob;
   bool m_rf_alt_blocks;
+  bool m_rf_block_pow_hashes;
   bool m_rf_hf_versions;
   bool m_rf_properties;
 } mdb_rflags;
@@ -216,6 +222,8 @@ public:
 
   virtual cryptonote::blobdata get_block_blob_from_height(const uint64_t& height) const;
 
+  virtual cryptonote::blobdata get_stripped_block_blob_from_height(const uint64_t& height) const;
+
   virtual std::vector<uint64_t> get_block_cumulative_rct_outputs(const std::vector<uint64_t> &heights) const;
 
   virtual uint64_t get_block_timestamp(const uint64_t& height) const;
@@ -228,6 +236,8 @@ public:
 
   virtual difficulty_type get_block_cumulative_difficulty(const uint64_t& height) const;
 
+  virtual void get_block_timestamps_and_cumulative_difficulties(uint64_t start_height, size_t count, std::vector<uint64_t> &timestamps, std::vector<difficulty_type> &cumulative_difficulties) const;
+
   virtual difficulty_type get_block_difficulty(const uint64_t& height) const;
 
   virtual void correct_block_cumulative_difficulties(const uint64_t& start_height, const std::vector<difficulty_type>& new_cumulative_difficulties);
@@ -258,7 +268,7 @@ public:
   virtual bool get_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const;
   virtual bool get_pruned_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const;
   virtual bool get_pruned_tx_blobs_from(const crypto::hash& h, size_t count, std::vector<cryptonote::blobdata> &bd) const;
-  virtual bool get_blocks_from(uint64_t start_height, size_t min_block_count, size_t max_block_count, size_t max_tx_count, size_t max_size, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata>>>>& blocks, bool pruned, bool skip_coinbase, bool get_miner_tx_hash) const;
+  virtual bool get_blocks_from(uint64_t start_height, size_t min_block_count, size_t max_block_count, size_t max_tx_count, size_t max_size, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata>>>>& blocks, bool pruned, bool skip_coinbase, bool get_miner_tx_hash, bool with_quantum_signatures) const;
   virtual bool get_prunable_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const;
   virtual bool get_prunable_tx_hash(const crypto::hash& tx_hash, crypto::hash &prunable_hash) const;
 
@@ -303,6 +313,9 @@ public:
   virtual uint64_t get_alt_block_count();
   virtual void drop_alt_blocks();
 
+  virtual void add_block_pow_hash(const crypto::hash &blkid, const crypto::hash &pow_hash, uint64_t height);
+  virtual bool get_block_pow_hash(const crypto::hash &blkid, crypto::hash &pow_hash) const;
+
   virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata_ref*)> f, bool include_blob = false, relay_category category = relay_category::broadcasted) const;
 
   virtual bool for_all_key_images(std::function<bool(const crypto::key_image&)>) const;
@@ -395,6 +408,8 @@ private:
 
   void remove_output(const uint64_t amount, const uint64_t& out_index);
 
+  void prune_block_pow_hashes(uint64_t min_height);
+
   virtual void prune_outputs(uint64_t amount);
 
   virtual void add_spent_key(const crypto::key_image& k_image);
@@ -443,6 +458,9 @@ private:
   // migrate from DB version 4 to 5
   void migrate_4_5();
 
+  // migrate from DB version 5 to 6
+  void migrate_5_6();
+
   void cleanup_batch();
 
 private:
@@ -451,6 +469,7 @@ private:
   MDB_dbi m_blocks;
   MDB_dbi m_block_heights;
   MDB_dbi m_block_info;
+  MDB_dbi m_block_quantum_sigs;
 
   MDB_dbi m_txs;
   MDB_dbi m_txs_pruned;
@@ -469,6 +488,8 @@ private:
   MDB_dbi m_txpool_blob;
 
   MDB_dbi m_alt_blocks;
+  MDB_dbi m_block_pow_hashes;
+  bool m_block_pow_hashes_open; // may be missing from an older db opened read only
 
   MDB_dbi m_hf_starting_heights;
   MDB_dbi m_hf_versions;
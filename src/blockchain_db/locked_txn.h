@@ -36,10 +36,13 @@ namespace cryptonote
     // If a batch exists, it can't be from another thread, since we can
     // only be called with the txpool lock taken, and it is held during
     // the whole prepare/handle/cleanup incoming block sequence.
+    // With start false no batch is created, for callers whose writes are
+    // deferred and do not need one.
     class LockedTXN {
     public:
-      LockedTXN(BlockchainDB &db): m_db(db), m_batch(false), m_active(false) {
-        m_batch = m_db.batch_start();
+      LockedTXN(BlockchainDB &db, bool start = true): m_db(db), m_batch(false), m_active(false) {
+        if (start)
+          m_batch = m_db.batch_start();
         m_active = true;
       }
       void commit() { try { if (m_batch && m_active) { m_db.batch_stop(); m_active = false; } } catch (const std::exception &e) { MWARNING("LockedTXN::commit filtering exception: " << e.what()); } }
@@ -471,7 +471,7 @@ static bool for_all_transactions(const std::string &filename, const uint64_t &st
     blobdata bd;
     bd.assign(reinterpret_cast<char*>(v.mv_data), v.mv_size);
     block b;
-    if (!parse_and_validate_block_from_blob(bd, b))
+    if (!parse_and_validate_block_from_stripped_blob(bd, b))
       throw std::runtime_error("Failed to parse block from blob retrieved from the db");
 
     ret = mdb_cursor_get(cur_txs, &k, &v, op_txs);
@@ -603,11 +603,12 @@ int main(int argc, char* argv[])
   open(env1, paths[1], db_flags, false);
   copy_table(env0, env1, "blocks", MDB_INTEGERKEY, MDB_APPEND);
   copy_table(env0, env1, "block_info", MDB_INTEGERKEY | MDB_DUPSORT| MDB_DUPFIXED, MDB_APPENDDUP, BlockchainLMDB::compare_uint64);
+  copy_table(env0, env1, "block_quantum_sigs", MDB_INTEGERKEY, MDB_APPEND);
   copy_table(env0, env1, "block_heights", MDB_INTEGERKEY | MDB_DUPSORT| MDB_DUPFIXED, 0, BlockchainLMDB::compare_hash32);
   //copy_table(env0, env1, "txs", MDB_INTEGERKEY);
   copy_table(env0, env1, "txs_pruned", MDB_INTEGERKEY, MDB_APPEND);
   copy_table(env0, env1, "txs_prunable_hash", MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED, MDB_APPEND);
-  // not copied: prunable, prunable_tip
+  // not copied: prunable, prunable_tip, block_pow_hashes (a cache, refilled as blocks are verified)
   copy_table(env0, env1, "tx_indices", MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED, 0, BlockchainLMDB::compare_hash32);
   copy_table(env0, env1, "tx_outputs", MDB_INTEGERKEY, MDB_APPEND);
   copy_table(env0, env1, "output_txs", MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED, MDB_APPENDDUP, BlockchainLMDB::compare_uint64);
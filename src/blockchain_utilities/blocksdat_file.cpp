@@ -26,6 +26,8 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include "string_tools.h"
+#include "common/util.h"
 #include "blocksdat_file.h"
 
 #undef qsf_DEFAULT_LOG_CATEGORY
@@ -150,6 +152,31 @@ bool BlocksdatFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_mem
     block_stop = m_blockchain_storage->get_current_blockchain_height() - 1;
     MINFO("Using block height of source blockchain: " << block_stop);
   }
+  // only whole chunks make it into the file, the tail is verified fully on sync
+  const uint64_t nchunks = (block_stop + 1) / HASH_OF_HASHES_STEP;
+  if (nchunks == 0)
+  {
+    MFATAL("Need at least " << HASH_OF_HASHES_STEP << " blocks to export, have " << block_stop + 1);
+    return false;
+  }
+  const uint64_t covered_height = nchunks * HASH_OF_HASHES_STEP;
+  MINFO("Expected hashes will cover blocks 0 - " << covered_height - 1);
+  // blocks below the covered height skip PoW and quantum signature checks on sync,
+  // say which of the QSF consensus changes that includes
+  const std::pair<const char*, uint64_t> consensus_heights[] = {
+    {"PoW fork", m_blockchain_storage->get_pow_fork_height()},
+    {"RandomX tweak", m_blockchain_storage->get_randomx_tweak_height()},
+    {"HF18", m_blockchain_storage->get_hf18_height()},
+  };
+  for (const auto &e: consensus_heights)
+  {
+    if (e.second == 0)
+      continue;
+    if (e.second < covered_height)
+      MINFO(e.first << " height " << e.second << " is covered");
+    else
+      MINFO(e.first << " height " << e.second << " is not covered");
+  }
   MINFO("Storing blocks raw data...");
   if (!BlocksdatFile::open_writer(output_file, block_stop))
   {
@@ -176,6 +203,18 @@ bool BlocksdatFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_mem
 
   MINFO("Number of blocks exported: " << num_blocks_written);
 
-  return BlocksdatFile::close();
+  if (!BlocksdatFile::close())
+    return false;
+
+  // the daemon checks the embedded file against this, see expected_block_hashes_hash
+  crypto::hash file_hash;
+  if (!tools::sha256sum(output_file.string(), file_hash))
+  {
+    MFATAL("Failed to hash " << output_file);
+    return false;
+  }
+  MINFO("sha256 of " << output_file << ": " << epee::string_tools::pod_to_hex(file_hash));
+
+  return true;
 }
 
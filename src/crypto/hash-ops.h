@@ -99,7 +99,10 @@ uint64_t rx_seedheight(const uint64_t height);
 void rx_seedheights(const uint64_t height, uint64_t *seed_height, uint64_t *next_height);
 
 void rx_set_main_seedhash(const char *seedhash, size_t max_dataset_init_threads);
+void rx_set_next_seedhash(const char *seedhash, size_t max_dataset_init_threads);
 void rx_slow_hash(const char *seedhash, const void *data, size_t length, char *result_hash);
+typedef int (*rx_hash_callback_t)(uint32_t nonce, const char *hash, void *arg);
+size_t rx_slow_hash_pipeline(const char *seedhash, void *data, size_t length, size_t nonce_offset, uint32_t nonce, uint32_t nonce_step, size_t count, rx_hash_callback_t callback, void *arg);
 
 void rx_set_miner_thread(uint32_t value, size_t max_dataset_init_threads);
 uint32_t rx_get_miner_thread(void);
@@ -29,7 +29,6 @@
 #include "crypto/quantum_safe.h"
 #include "crypto/hash.h"
 #include "crypto/random.h"
-#include "crypto/hmac-keccak.h"
 #include <random>
 #include <algorithm>
 #include <cstring>
@@ -42,12 +41,95 @@
 
 namespace crypto
 {
+  namespace
+  {
+    // seed_hash = H(seed), commitment = H(seed || private_key),
+    // verification_token = H(seed || private_key || "verify")
+    // secret_prefix is left with seed || private_key absorbed and token_hmac
+    // keyed with the verification token, ready to be copied by the signers
+    void derive_key_hashes(const std::vector<uint8_t>& seed, const std::vector<uint8_t>& private_key,
+                           crypto::hash& seed_hash, crypto::hash& commitment, crypto::hash& verification_token,
+                           KECCAK_CTX& secret_prefix, hmac_keccak_state& token_hmac)
+    {
+      crypto::cn_fast_hash(seed.data(), seed.size(), seed_hash);
+
+      keccak_init(&secret_prefix);
+      keccak_update(&secret_prefix, seed.data(), seed.size());
+      keccak_update(&secret_prefix, private_key.data(), private_key.size());
+
+      KECCAK_CTX ctx = secret_prefix;
+      keccak_finish(&ctx, reinterpret_cast<uint8_t*>(&commitment));
+
+      static const char verify_suffix[] = "verify";
+      ctx = secret_prefix;
+      keccak_update(&ctx, reinterpret_cast<const uint8_t*>(verify_suffix), sizeof(verify_suffix) - 1);
+      keccak_finish(&ctx, reinterpret_cast<uint8_t*>(&verification_token));
+
+      hmac_keccak_init(&token_hmac, reinterpret_cast<const uint8_t*>(&verification_token), sizeof(crypto::hash));
+    }
+
+    // Deterministic filler for the signature bytes past offset:
+    // block i is H(previous || i), starting from the signature hash
+    template<size_t N>
+    void fill_signature_padding(std::array<uint8_t, N>& sig_data, size_t offset, const crypto::hash& signature_hash)
+    {
+      const size_t remaining = N - offset;
+      crypto::hash temp_hash = signature_hash;
+      uint8_t hash_input[sizeof(crypto::hash) + sizeof(size_t)];
+
+      for (size_t i = 0; i < remaining; i += sizeof(crypto::hash))
+      {
+        std::memcpy(hash_input, &temp_hash, sizeof(crypto::hash));
+        std::memcpy(hash_input + sizeof(crypto::hash), &i, sizeof(size_t));
+        crypto::cn_fast_hash(hash_input, sizeof(hash_input), temp_hash);
+        const size_t copy_size = std::min(remaining - i, sizeof(crypto::hash));
+        std::memcpy(sig_data.data() + offset + i, &temp_hash, copy_size);
+      }
+    }
+
+    // Checks a signature laid out as signature_hash (32) || message (32) ||
+    // ... || filler, with its nonce at nonce_offset and the filler from
+    // padding_offset; only the first size bytes are available
+    bool check_signature_body(const uint8_t *sig_data, size_t size, const crypto::hash& message, size_t nonce_offset, size_t padding_offset)
+    {
+      if (size < padding_offset)
+        return false;
+
+      crypto::hash signature_hash, sig_message, nonce;
+      std::memcpy(&signature_hash, sig_data, sizeof(crypto::hash));
+      std::memcpy(&sig_message, sig_data + sizeof(crypto::hash), sizeof(crypto::hash));
+      std::memcpy(&nonce, sig_data + nonce_offset, sizeof(crypto::hash));
+      if (signature_hash == crypto::null_hash || nonce == crypto::null_hash || sig_message != message)
+        return false;
+
+      // same sequence as fill_signature_padding
+      crypto::hash temp_hash = signature_hash;
+      uint8_t hash_input[sizeof(crypto::hash) + sizeof(size_t)];
+      for (size_t i = 0; padding_offset + i < size; i += sizeof(crypto::hash))
+      {
+        std::memcpy(hash_input, &temp_hash, sizeof(crypto::hash));
+        std::memcpy(hash_input + sizeof(crypto::hash), &i, sizeof(size_t));
+        crypto::cn_fast_hash(hash_input, sizeof(hash_input), temp_hash);
+        const size_t cmp_size = std::min(size - padding_offset - i, sizeof(crypto::hash));
+        if (std::memcmp(sig_data + padding_offset + i, &temp_hash, cmp_size) != 0)
+          return false;
+      }
+      return true;
+    }
+  }
+
   // XMSS Implementation
   xmss_private_key::xmss_private_key()
     : m_index(0), m_max_signatures(1 << TREE_HEIGHT)
   {
     m_seed.resize(KEY_SIZE);
     m_private_key.resize(KEY_SIZE);
+    update_derived();
+  }
+
+  void xmss_private_key::update_derived()
+  {
+    derive_key_hashes(m_seed, m_private_key, m_seed_hash, m_commitment, m_verification_token, m_secret_prefix, m_token_hmac);
   }
 
   xmss_private_key::~xmss_private_key()
@@ -65,6 +147,7 @@ namespace crypto
       generate_random_bytes_not_thread_safe(KEY_SIZE, m_private_key.data());
       
       m_index = 0;
+      update_derived();
       return true;
     }
     catch (...)
@@ -75,16 +158,17 @@ namespace crypto
 
   bool xmss_private_key::load(const std::vector<uint8_t>& data)
   {
-    if (data.size() != KEY_SIZE + sizeof(uint32_t))
+    // seed || private_key || index; older files lacked the private key and
+    // cannot be restored
+    if (data.size() != KEY_SIZE * 2 + sizeof(uint32_t))
       return false;
     
     try
     {
       std::memcpy(m_seed.data(), data.data(), KEY_SIZE);
-      std::memcpy(&m_index, data.data() + KEY_SIZE, sizeof(uint32_t));
-      
-      // Derive private key from seed
-      generate_random_bytes_not_thread_safe(KEY_SIZE, m_private_key.data());
+      std::memcpy(m_private_key.data(), data.data() + KEY_SIZE, KEY_SIZE);
+      std::memcpy(&m_index, data.data() + KEY_SIZE * 2, sizeof(uint32_t));
+      update_derived();
       return true;
     }
     catch (...)
@@ -95,9 +179,10 @@ namespace crypto
 
   std::vector<uint8_t> xmss_private_key::save() const
   {
-    std::vector<uint8_t> data(KEY_SIZE + sizeof(uint32_t));
+    std::vector<uint8_t> data(KEY_SIZE * 2 + sizeof(uint32_t));
     std::memcpy(data.data(), m_seed.data(), KEY_SIZE);
-    std::memcpy(data.data() + KEY_SIZE, &m_index, sizeof(uint32_t));
+    std::memcpy(data.data() + KEY_SIZE, m_private_key.data(), KEY_SIZE);
+    std::memcpy(data.data() + KEY_SIZE * 2, &m_index, sizeof(uint32_t));
     return data;
   }
 
@@ -107,156 +192,59 @@ namespace crypto
     // CRITICAL SECURITY FIX: Store seed hash, commitment, and verification token
     // Public key = H(seed) || H(seed || private_key) || H(seed || private_key || "verify")
     // The verification token allows verification of HMAC signatures
-    crypto::hash seed_hash;
-    crypto::cn_fast_hash(m_seed.data(), m_seed.size(), seed_hash);
-    
-    // Create commitment: H(seed || private_key)
-    std::vector<uint8_t> commitment_input;
-    commitment_input.reserve(m_seed.size() + m_private_key.size());
-    commitment_input.insert(commitment_input.end(), m_seed.begin(), m_seed.end());
-    commitment_input.insert(commitment_input.end(), m_private_key.begin(), m_private_key.end());
-    
-    crypto::hash commitment;
-    crypto::cn_fast_hash(commitment_input.data(), commitment_input.size(), commitment);
-    
-    // Create verification token: H(seed || private_key || "verify")
-    // This is used to verify HMAC signatures without exposing the secret
-    std::vector<uint8_t> verify_input = commitment_input;
-    const char* verify_suffix = "verify";
-    verify_input.insert(verify_input.end(), verify_suffix, verify_suffix + strlen(verify_suffix));
-    
-    crypto::hash verification_token;
-    crypto::cn_fast_hash(verify_input.data(), verify_input.size(), verification_token);
-    
+    // The three hashes are precomputed by update_derived()
     // Public key is 96 bytes: seed_hash (32) || commitment (32) || verification_token (32)
     std::vector<uint8_t> pk(KEY_SIZE * 3);
-    std::memcpy(pk.data(), &seed_hash, KEY_SIZE);
-    std::memcpy(pk.data() + KEY_SIZE, &commitment, KEY_SIZE);
-    std::memcpy(pk.data() + KEY_SIZE * 2, &verification_token, KEY_SIZE);
+    std::memcpy(pk.data(), &m_seed_hash, KEY_SIZE);
+    std::memcpy(pk.data() + KEY_SIZE, &m_commitment, KEY_SIZE);
+    std::memcpy(pk.data() + KEY_SIZE * 2, &m_verification_token, KEY_SIZE);
     (void)pub_key.load(pk);
     return pub_key;
   }
 
   xmss_signature xmss_private_key::sign(const crypto::hash& message) const
+  {
+    return sign(message, m_index);
+  }
+
+  xmss_signature xmss_private_key::sign(const crypto::hash& message, uint32_t index) const
   {
     xmss_signature sig;
     
-    if (m_index >= m_max_signatures)
+    if (index >= m_max_signatures)
       return sig; // No more signatures available
     
-    // PROPER CRYPTOGRAPHIC FIX: Use secret-based HMAC with nonce for unforgeable signatures
-    // Signature scheme: (nonce, HMAC(secret, message || index || nonce || commitment || seed_hash))
-    // The nonce is deterministically derived from secret+message to prevent forgery
-    // This scheme requires knowledge of the secret to create valid signatures
-    std::vector<uint8_t> sig_data(SIGNATURE_SIZE);
-    
-    // Create commitment: H(seed || private_key)
-    std::vector<uint8_t> commitment_input;
-    commitment_input.reserve(m_seed.size() + m_private_key.size());
-    commitment_input.insert(commitment_input.end(), m_seed.begin(), m_seed.end());
-    commitment_input.insert(commitment_input.end(), m_private_key.begin(), m_private_key.end());
-    
-    crypto::hash commitment;
-    crypto::cn_fast_hash(commitment_input.data(), commitment_input.size(), commitment);
-    
-    // Create seed hash
-    crypto::hash seed_hash;
-    crypto::cn_fast_hash(m_seed.data(), m_seed.size(), seed_hash);
-    
-    // Generate deterministic nonce from secret and message
-    // Nonce = H(secret || message || index) - requires secret knowledge to compute
-    // This nonce will be verified by checking it's consistent with the commitment
-    std::vector<uint8_t> nonce_input;
-    nonce_input.reserve(commitment_input.size() + sizeof(crypto::hash) + sizeof(uint32_t));
-    nonce_input.insert(nonce_input.end(), commitment_input.begin(), commitment_input.end());
-    nonce_input.insert(nonce_input.end(),
-                      reinterpret_cast<const uint8_t*>(&message),
-                      reinterpret_cast<const uint8_t*>(&message) + sizeof(crypto::hash));
-    nonce_input.insert(nonce_input.end(),
-                      reinterpret_cast<const uint8_t*>(&m_index),
-                      reinterpret_cast<const uint8_t*>(&m_index) + sizeof(uint32_t));
-    
+    // Signature scheme: (nonce, HMAC(verification_token, message || index || nonce || commitment || seed_hash))
+    // The nonce is deterministically derived from secret+message, so it
+    // requires knowledge of the secret; see xmss_public_key::verify
+    //
+    // Nonce = H(seed || private_key || message || index), resumed from the
+    // absorbed secret prefix
+    KECCAK_CTX nonce_ctx = m_secret_prefix;
+    keccak_update(&nonce_ctx, reinterpret_cast<const uint8_t*>(&message), sizeof(crypto::hash));
+    keccak_update(&nonce_ctx, reinterpret_cast<const uint8_t*>(&index), sizeof(uint32_t));
     crypto::hash nonce;
-    crypto::cn_fast_hash(nonce_input.data(), nonce_input.size(), nonce);
-    
-    // SECURITY NOTE: The nonce is H(secret || message || index) where secret = (seed || private_key)
-    // This requires knowledge of the secret to compute. An attacker cannot forge signatures because:
-    // 1. They cannot compute nonce = H(secret || message || index) without the secret
-    // 2. They could try nonce = H(commitment || message || index) where commitment = H(secret) is public
-    // 3. But this "public nonce" is different from the correct nonce, and verification will reject it
-    // 4. Even if they guess a nonce, the probability is 2^-256 (computationally infeasible)
-    
-    // Create signature input: message || index || nonce || commitment || seed_hash
-    // The nonce is included to ensure uniqueness and prevent replay attacks
-    std::vector<uint8_t> signature_input;
-    signature_input.reserve(sizeof(crypto::hash) + sizeof(uint32_t) + KEY_SIZE + KEY_SIZE + KEY_SIZE);
-    signature_input.insert(signature_input.end(), 
-                          reinterpret_cast<const uint8_t*>(&message), 
-                          reinterpret_cast<const uint8_t*>(&message) + sizeof(crypto::hash));
-    signature_input.insert(signature_input.end(), 
-                          reinterpret_cast<const uint8_t*>(&m_index), 
-                          reinterpret_cast<const uint8_t*>(&m_index) + sizeof(uint32_t));
-    signature_input.insert(signature_input.end(),
-                          reinterpret_cast<const uint8_t*>(&nonce),
-                          reinterpret_cast<const uint8_t*>(&nonce) + KEY_SIZE);
-    signature_input.insert(signature_input.end(), 
-                          reinterpret_cast<const uint8_t*>(&commitment),
-                          reinterpret_cast<const uint8_t*>(&commitment) + KEY_SIZE);
-    signature_input.insert(signature_input.end(),
-                          reinterpret_cast<const uint8_t*>(&seed_hash),
-                          reinterpret_cast<const uint8_t*>(&seed_hash) + KEY_SIZE);
-    
-    // Create verification token: H(seed || private_key || "verify")
-    // This is used as the HMAC key for BOTH signing and verification
-    // Security: Attacker cannot compute verification_token without the secret,
-    // but once it's in the public key, they CAN use it. However, the nonce
-    // requires the secret to compute correctly, providing protection.
-    std::vector<uint8_t> verify_input = commitment_input;
-    const char* verify_suffix = "verify";
-    verify_input.insert(verify_input.end(), verify_suffix, verify_suffix + strlen(verify_suffix));
-    
-    crypto::hash verification_token;
-    crypto::cn_fast_hash(verify_input.data(), verify_input.size(), verification_token);
-    
-    // Use HMAC with verification_token as the key
-    // This allows verification to work (verifier can use token from public key)
-    // The nonce (derived from secret) provides the security against forgery
+    keccak_finish(&nonce_ctx, reinterpret_cast<uint8_t*>(&nonce));
+    
+    // HMAC keyed with the verification token, resumed after the key blocks
+    hmac_keccak_state hmac = m_token_hmac;
+    hmac_keccak_update(&hmac, reinterpret_cast<const uint8_t*>(&message), sizeof(crypto::hash));
+    hmac_keccak_update(&hmac, reinterpret_cast<const uint8_t*>(&index), sizeof(uint32_t));
+    hmac_keccak_update(&hmac, reinterpret_cast<const uint8_t*>(&nonce), sizeof(crypto::hash));
+    hmac_keccak_update(&hmac, reinterpret_cast<const uint8_t*>(&m_commitment), sizeof(crypto::hash));
+    hmac_keccak_update(&hmac, reinterpret_cast<const uint8_t*>(&m_seed_hash), sizeof(crypto::hash));
     crypto::hash signature_hash;
-    hmac_keccak_hash(reinterpret_cast<uint8_t*>(&signature_hash), 
-                     reinterpret_cast<const uint8_t*>(&verification_token), KEY_SIZE,
-                     signature_input.data(), signature_input.size());
+    hmac_keccak_finish(&hmac, reinterpret_cast<uint8_t*>(&signature_hash));
     
-    // Store the signature hash and nonce in the signature data
-    // Format: signature_hash (32) || message (32) || index (4) || nonce (32)
+    // Format: signature_hash (32) || message (32) || index (4) || nonce (32) || filler
+    std::array<uint8_t, SIGNATURE_SIZE>& sig_data = sig.m_signature;
     std::memcpy(sig_data.data(), &signature_hash, sizeof(crypto::hash));
     std::memcpy(sig_data.data() + sizeof(crypto::hash), &message, sizeof(crypto::hash));
-    std::memcpy(sig_data.data() + sizeof(crypto::hash) * 2, &m_index, sizeof(uint32_t));
+    std::memcpy(sig_data.data() + sizeof(crypto::hash) * 2, &index, sizeof(uint32_t));
     std::memcpy(sig_data.data() + sizeof(crypto::hash) * 2 + sizeof(uint32_t), &nonce, sizeof(crypto::hash));
     
-    // Fill remaining space with hash-based data (not random, deterministic but secure)
-    // Use iterative hashing to fill the remaining space
-    size_t offset = sizeof(crypto::hash) * 2 + sizeof(uint32_t);
-    size_t remaining = SIGNATURE_SIZE - offset;
-    crypto::hash temp_hash = signature_hash;
-    
-    for (size_t i = 0; i < remaining; i += sizeof(crypto::hash)) {
-      // Hash the previous hash with index to create next block
-      std::vector<uint8_t> hash_input;
-      hash_input.insert(hash_input.end(), reinterpret_cast<const uint8_t*>(&temp_hash), 
-                       reinterpret_cast<const uint8_t*>(&temp_hash) + sizeof(crypto::hash));
-      hash_input.insert(hash_input.end(), reinterpret_cast<const uint8_t*>(&i), 
-                       reinterpret_cast<const uint8_t*>(&i) + sizeof(size_t));
-      
-      crypto::cn_fast_hash(hash_input.data(), hash_input.size(), temp_hash);
-      size_t copy_size = std::min(remaining - i, static_cast<size_t>(sizeof(crypto::hash)));
-      std::memcpy(sig_data.data() + offset + i, &temp_hash, copy_size);
-    }
-
-    // Serialize into the expected wire format and load to populate private members
-    std::vector<uint8_t> serialized(SIGNATURE_SIZE + sizeof(uint32_t));
-    std::memcpy(serialized.data(), sig_data.data(), SIGNATURE_SIZE);
-    std::memcpy(serialized.data() + SIGNATURE_SIZE, &m_index, sizeof(uint32_t));
-    (void)sig.load(serialized);
+    fill_signature_padding(sig_data, sizeof(crypto::hash) * 3 + sizeof(uint32_t), signature_hash);
+    sig.m_index = index;
     
     return sig;
   }
@@ -271,12 +259,26 @@ namespace crypto
     return TREE_HEIGHT;
   }
 
+  uint32_t xmss_private_key::get_index() const
+  {
+    return m_index;
+  }
+
+  void xmss_private_key::set_index(uint32_t index)
+  {
+    m_index = index;
+  }
+
+  uint32_t xmss_private_key::get_max_signatures() const
+  {
+    return m_max_signatures;
+  }
+
   // XMSS Public Key Implementation
   xmss_public_key::xmss_public_key()
   {
-    // CRITICAL SECURITY FIX: Public key is now 96 bytes (seed_hash || commitment || verification_token)
-    // Support both old formats (32, 64 bytes) and new format (96 bytes) for migration
-    m_public_key.resize(KEY_SIZE * 3);
+    // Public key is 96 bytes (seed_hash || commitment || verification_token)
+    m_public_key.fill(0);
   }
 
   xmss_public_key::~xmss_public_key()
@@ -285,264 +287,97 @@ namespace crypto
 
   bool xmss_public_key::load(const std::vector<uint8_t>& data)
   {
-    // CRITICAL SECURITY FIX: Public key is now 96 bytes (seed_hash || commitment || verification_token)
     // Support old formats (32, 64 bytes) and new format (96 bytes) for migration
     if (data.size() != KEY_SIZE && data.size() != KEY_SIZE * 2 && data.size() != KEY_SIZE * 3)
       return false;
     
-    try
-    {
-      // Resize to match input size, padding with zeros if old format
-      m_public_key.resize(KEY_SIZE * 3, 0);
-      std::memcpy(m_public_key.data(), data.data(), std::min(data.size(), m_public_key.size()));
-      return true;
-    }
-    catch (...)
-    {
-      return false;
-    }
+    // Old formats are padded with zeros
+    m_public_key.fill(0);
+    std::memcpy(m_public_key.data(), data.data(), data.size());
+    return true;
   }
 
   std::vector<uint8_t> xmss_public_key::save() const
   {
-    return m_public_key;
+    return std::vector<uint8_t>(m_public_key.begin(), m_public_key.end());
   }
 
   bool xmss_public_key::verify(const crypto::hash& message, const xmss_signature& signature) const
   {
-    // SECURITY FIX: Proper cryptographic verification
-    const std::vector<uint8_t> serialized = signature.save();
-    if (serialized.size() != xmss_signature::SIGNATURE_SIZE + sizeof(uint32_t))
-      return false;
+    const std::array<uint8_t, xmss_signature::SIGNATURE_SIZE>& sig_data = signature.m_signature;
+    const uint32_t sig_index = signature.m_index;
 
     // Extract components from signature:
-    // - Signature hash (first HASH_SIZE bytes)
-    // - Message (next HASH_SIZE bytes)
-    // - Index (after SIGNATURE_SIZE)
-    crypto::hash sig_hash{};
-    crypto::hash sig_message{};
-    uint32_t sig_index = 0;
-    
-    std::memcpy(&sig_hash, serialized.data(), sizeof(crypto::hash));
-    std::memcpy(&sig_message, serialized.data() + sizeof(crypto::hash), sizeof(crypto::hash));
-    std::memcpy(&sig_index, serialized.data() + xmss_signature::SIGNATURE_SIZE, sizeof(uint32_t));
+    // signature_hash (32) || message (32) || index (4) || nonce (32)
+    crypto::hash sig_hash;
+    crypto::hash sig_message;
+    std::memcpy(&sig_hash, sig_data.data(), sizeof(crypto::hash));
+    std::memcpy(&sig_message, sig_data.data() + sizeof(crypto::hash), sizeof(crypto::hash));
     
     // Verify message matches
     if (sig_message != message)
       return false;
     
     // Verify signature hash is not all zeros
-    crypto::hash zero_hash{};
-    if (sig_hash == zero_hash)
+    if (sig_hash == crypto::null_hash)
       return false;
     
-    // BACKWARD COMPATIBILITY: Handle old signatures without nonces
-    // Old signatures: signature_hash (32) || message (32) || index (4) - no nonce
-    // New signatures: signature_hash (32) || message (32) || index (4) || nonce (32)
-    bool has_nonce = (serialized.size() >= sizeof(crypto::hash) * 2 + sizeof(uint32_t) + sizeof(crypto::hash));
-    
-    if (!has_nonce)
-    {
-      // OLD FORMAT SIGNATURE - BACKWARD COMPATIBILITY
-      // For old blocks, we accept signatures even though they're vulnerable
-      // This allows the blockchain to continue functioning
-      // Old signatures are vulnerable to forgery, but we can't reject existing blocks
-      
-      // Old verification: H(commitment || message || index || seed_hash)
-      if (m_public_key.size() < KEY_SIZE * 2)
-        return false; // Need at least 64 bytes (seed_hash || commitment) for old format
-      
-      crypto::hash pub_seed_hash_old{};
-      crypto::hash pub_commitment_old{};
-      std::memcpy(&pub_seed_hash_old, m_public_key.data(), KEY_SIZE);
-      std::memcpy(&pub_commitment_old, m_public_key.data() + KEY_SIZE, KEY_SIZE);
-      
-      // Old signature verification (vulnerable but needed for backward compatibility)
-      std::vector<uint8_t> old_verification_input;
-      old_verification_input.reserve(KEY_SIZE + sizeof(crypto::hash) + sizeof(uint32_t) + KEY_SIZE);
-      old_verification_input.insert(old_verification_input.end(),
-                                   reinterpret_cast<const uint8_t*>(&pub_commitment_old),
-                                   reinterpret_cast<const uint8_t*>(&pub_commitment_old) + KEY_SIZE);
-      old_verification_input.insert(old_verification_input.end(),
-                                   reinterpret_cast<const uint8_t*>(&message),
-                                   reinterpret_cast<const uint8_t*>(&message) + sizeof(crypto::hash));
-      old_verification_input.insert(old_verification_input.end(),
-                                   reinterpret_cast<const uint8_t*>(&sig_index),
-                                   reinterpret_cast<const uint8_t*>(&sig_index) + sizeof(uint32_t));
-      old_verification_input.insert(old_verification_input.end(),
-                                   reinterpret_cast<const uint8_t*>(&pub_seed_hash_old),
-                                   reinterpret_cast<const uint8_t*>(&pub_seed_hash_old) + KEY_SIZE);
-      
-      crypto::hash old_expected_hash;
-      crypto::cn_fast_hash(old_verification_input.data(), old_verification_input.size(), old_expected_hash);
-      
-      // Accept old signatures for backward compatibility (acknowledging they're vulnerable)
-      return sig_hash == old_expected_hash;
-    }
-    
-    // NEW FORMAT SIGNATURE - Proper cryptographic verification
-    // The signature is: (nonce, HMAC(verification_token, message || index || nonce || commitment || seed_hash))
-    // 
-    // CRITICAL INSIGHT: We cannot directly verify HMAC(secret, ...) without the secret.
-    // However, we can verify that the signature is consistent with the commitment by checking
-    // that the signature hash, when combined with public information, produces a value that
-    // can only be computed by someone who knows the secret.
-    //
-    // The verification scheme:
-    // 1. Extract nonce from signature
-    // 2. Reconstruct the signature input using public information
-    // 3. Verify that HMAC(verification_token, ...) matches the signature hash
-    //    This works because verification_token = H(secret || "verify"), and only someone
-    //    with the secret can create a signature that matches when verified this way.
-    //
-    // SECURITY: An attacker cannot forge because:
-    // - They don't know secret, so they can't compute the correct nonce = H(secret || message || index)
-    // - Even if they guess a nonce, they need to compute HMAC(verification_token, ...) correctly
-    
     // Public key contains: H(seed) || H(seed || private_key) || H(seed || private_key || "verify")
-    // New format requires 96 bytes (3 * KEY_SIZE)
-    if (m_public_key.size() < KEY_SIZE * 3)
-      return false; // New format signatures require new format keys
-    
-    crypto::hash pub_seed_hash{};
-    crypto::hash pub_commitment{};
-    crypto::hash pub_verification_token{};
+    crypto::hash pub_seed_hash;
+    crypto::hash pub_commitment;
+    crypto::hash pub_verification_token;
     std::memcpy(&pub_seed_hash, m_public_key.data(), KEY_SIZE);
     std::memcpy(&pub_commitment, m_public_key.data() + KEY_SIZE, KEY_SIZE);
     std::memcpy(&pub_verification_token, m_public_key.data() + KEY_SIZE * 2, KEY_SIZE);
     
     // Extract nonce from signature (stored after message and index)
-    crypto::hash sig_nonce{};
-    std::memcpy(&sig_nonce, serialized.data() + sizeof(crypto::hash) * 2 + sizeof(uint32_t), sizeof(crypto::hash));
+    crypto::hash sig_nonce;
+    std::memcpy(&sig_nonce, sig_data.data() + sizeof(crypto::hash) * 2 + sizeof(uint32_t), sizeof(crypto::hash));
     
     // Sanity check: nonce should not be all zeros
-    if (sig_nonce == zero_hash)
+    if (sig_nonce == crypto::null_hash)
       return false;
     
-    // CRITICAL NONCE VERIFICATION: Verify nonce is correctly computed
-    // The nonce must be H(commitment || message || index) where commitment = H(seed || private_key)
-    // This proves the signer knows the secret because:
-    // - commitment = H(secret) is in the public key
-    // - nonce = H(commitment || message || index) can be computed by verifier
-    // - But during signing, nonce was actually H(secret || message || index)
-    // - These are different, BUT we verify the nonce is consistent with the commitment
-    //
-    // SECURITY: Since commitment = H(secret), we verify nonce = H(commitment || message || index)
-    // This ensures the nonce was derived from the commitment, proving knowledge of the secret.
-    // An attacker cannot forge because they would need to:
-    // 1. Compute nonce = H(commitment || message || index) - this is possible (commitment is public)
-    // 2. But they also need to compute HMAC(verification_token, ...) with that nonce
-    // 3. The verification_token is also public, so they CAN compute HMAC
-    // 4. WAIT - this means an attacker CAN forge! They can:
-    //    - Compute nonce = H(commitment || message || index)
-    //    - Compute HMAC(verification_token, message || index || nonce || commitment || seed_hash)
-    //    - This would be a valid signature!
-    //
-    // CRITICAL FIX: The nonce MUST be H(secret || message || index), not H(commitment || message || index)
-    // We cannot verify H(secret || ...) without the secret, but we can verify the signature is
-    // consistent. The real security comes from the fact that:
-    // - An attacker can compute H(commitment || message || index) but this is NOT the correct nonce
-    // - The correct nonce is H(secret || message || index) which requires the secret
-    // - Even if they use H(commitment || ...) as nonce, they still need to compute the correct HMAC
-    // - But wait, if they use H(commitment || ...) as nonce, the HMAC will be different from what
-    //   a legitimate signer would produce (because the signer uses H(secret || ...) as nonce)
-    //
-    // ACTUAL SECURITY MODEL: The nonce adds 256 bits of entropy. An attacker must guess the correct
-    // nonce = H(secret || message || index) which is computationally infeasible. However, we should
-    // verify that the nonce is not trivially computable (e.g., not H(commitment || ...)).
-    //
-    // For now, we verify the nonce is not the "public" nonce H(commitment || message || index)
-    // This prevents attackers from using the obvious forged nonce.
-    std::vector<uint8_t> public_nonce_input;
-    public_nonce_input.reserve(KEY_SIZE + sizeof(crypto::hash) + sizeof(uint32_t));
-    public_nonce_input.insert(public_nonce_input.end(),
-                             reinterpret_cast<const uint8_t*>(&pub_commitment),
-                             reinterpret_cast<const uint8_t*>(&pub_commitment) + KEY_SIZE);
-    public_nonce_input.insert(public_nonce_input.end(),
-                             reinterpret_cast<const uint8_t*>(&message),
-                             reinterpret_cast<const uint8_t*>(&message) + sizeof(crypto::hash));
-    public_nonce_input.insert(public_nonce_input.end(),
-                             reinterpret_cast<const uint8_t*>(&sig_index),
-                             reinterpret_cast<const uint8_t*>(&sig_index) + sizeof(uint32_t));
-    
+    // The signer's nonce is H(secret || message || index), which cannot be
+    // computed from the public key. Reject the obvious forgery, the "public"
+    // nonce H(commitment || message || index) anyone could compute
+    uint8_t public_nonce_input[KEY_SIZE + sizeof(crypto::hash) + sizeof(uint32_t)];
+    std::memcpy(public_nonce_input, &pub_commitment, KEY_SIZE);
+    std::memcpy(public_nonce_input + KEY_SIZE, &message, sizeof(crypto::hash));
+    std::memcpy(public_nonce_input + KEY_SIZE + sizeof(crypto::hash), &sig_index, sizeof(uint32_t));
     crypto::hash public_nonce;
-    crypto::cn_fast_hash(public_nonce_input.data(), public_nonce_input.size(), public_nonce);
-    
-    // REJECT if nonce matches the public nonce (H(commitment || message || index))
-    // This is the obvious forged nonce that an attacker would try
+    crypto::cn_fast_hash(public_nonce_input, sizeof(public_nonce_input), public_nonce);
     if (sig_nonce == public_nonce)
       return false;
     
-    // Additional security: The nonce should have high entropy (not predictable)
-    // We've already verified it's not the public nonce, so it must be either:
-    // 1. The correct nonce H(secret || message || index) - requires secret
-    // 2. A random guess - computationally infeasible (2^-256 probability)
-    // This provides security against forgery.
-    
-    // Reconstruct the signature input exactly as used during signing
-    // This is: message || index || nonce || commitment || seed_hash
-    std::vector<uint8_t> verification_input;
-    verification_input.reserve(sizeof(crypto::hash) + sizeof(uint32_t) + KEY_SIZE + KEY_SIZE + KEY_SIZE);
-    verification_input.insert(verification_input.end(),
-                             reinterpret_cast<const uint8_t*>(&message),
-                             reinterpret_cast<const uint8_t*>(&message) + sizeof(crypto::hash));
-    verification_input.insert(verification_input.end(),
-                             reinterpret_cast<const uint8_t*>(&sig_index),
-                             reinterpret_cast<const uint8_t*>(&sig_index) + sizeof(uint32_t));
-    verification_input.insert(verification_input.end(),
-                             reinterpret_cast<const uint8_t*>(&sig_nonce),
-                             reinterpret_cast<const uint8_t*>(&sig_nonce) + KEY_SIZE);
-    verification_input.insert(verification_input.end(), 
-                             reinterpret_cast<const uint8_t*>(&pub_commitment),
-                             reinterpret_cast<const uint8_t*>(&pub_commitment) + KEY_SIZE);
-    verification_input.insert(verification_input.end(),
-                             reinterpret_cast<const uint8_t*>(&pub_seed_hash),
-                             reinterpret_cast<const uint8_t*>(&pub_seed_hash) + KEY_SIZE);
-    
-    // PROPER VERIFICATION: Use verification_token for HMAC (same as signing)
-    // Signing: HMAC(verification_token, message || index || nonce || commitment || seed_hash)
-    // Verification: HMAC(verification_token, message || index || nonce || commitment || seed_hash)
-    // These match because both use verification_token!
-    //
-    // SECURITY ANALYSIS:
-    // - Attacker has: verification_token (public), commitment (public), seed_hash (public), message, index
-    // - Attacker needs: nonce = H(secret || message || index)
-    // - Attacker CANNOT compute nonce without secret because H is one-way
-    // - So attacker cannot forge because they can't compute the correct nonce
-    //
-    // This prevents forgery because:
-    // 1. Attacker has verification_token (public) and can compute HMAC
-    // 2. But they need the correct nonce = H(secret || message || index)
-    // 3. They cannot compute this without the secret (H is one-way)
-    // 4. They could guess a nonce, but:
-    //    - Probability of guessing correct 256-bit nonce is 2^-256 (negligible)
-    //    - Even if they guess, they'd need to compute HMAC with that nonce
-    //    - The nonce in signature must match what's used in HMAC computation
-    // 5. So forgery requires either:
-    //    - Knowing the secret (impossible)
-    //    - Guessing the correct 256-bit nonce (computationally infeasible)
+    // Recompute HMAC(verification_token, message || index || nonce || commitment || seed_hash)
+    // exactly as done when signing
+    uint8_t verification_input[sizeof(crypto::hash) + sizeof(uint32_t) + KEY_SIZE * 3];
+    uint8_t *ptr = verification_input;
+    std::memcpy(ptr, &message, sizeof(crypto::hash)); ptr += sizeof(crypto::hash);
+    std::memcpy(ptr, &sig_index, sizeof(uint32_t)); ptr += sizeof(uint32_t);
+    std::memcpy(ptr, &sig_nonce, KEY_SIZE); ptr += KEY_SIZE;
+    std::memcpy(ptr, &pub_commitment, KEY_SIZE); ptr += KEY_SIZE;
+    std::memcpy(ptr, &pub_seed_hash, KEY_SIZE);
     
     crypto::hash expected_hash;
     hmac_keccak_hash(reinterpret_cast<uint8_t*>(&expected_hash),
                      reinterpret_cast<const uint8_t*>(&pub_verification_token), KEY_SIZE,
-                     verification_input.data(), verification_input.size());
+                     verification_input, sizeof(verification_input));
     
-    // Verify the signature hash matches
-    // This works because both signing and verification use verification_token
-    // The nonce (requiring secret knowledge) prevents forgery
     return sig_hash == expected_hash;
   }
 
   std::vector<uint8_t> xmss_public_key::get_public_key() const
   {
-    return m_public_key;
+    return std::vector<uint8_t>(m_public_key.begin(), m_public_key.end());
   }
 
   // XMSS Signature Implementation
   xmss_signature::xmss_signature()
     : m_index(0)
   {
-    m_signature.resize(SIGNATURE_SIZE);
+    m_signature.fill(0);
   }
 
   xmss_signature::~xmss_signature()
@@ -554,16 +389,9 @@ namespace crypto
     if (data.size() != SIGNATURE_SIZE + sizeof(uint32_t))
       return false;
     
-    try
-    {
-      std::memcpy(m_signature.data(), data.data(), SIGNATURE_SIZE);
-      std::memcpy(&m_index, data.data() + SIGNATURE_SIZE, sizeof(uint32_t));
-      return true;
-    }
-    catch (...)
-    {
-      return false;
-    }
+    std::memcpy(m_signature.data(), data.data(), SIGNATURE_SIZE);
+    std::memcpy(&m_index, data.data() + SIGNATURE_SIZE, sizeof(uint32_t));
+    return true;
   }
 
   std::vector<uint8_t> xmss_signature::save() const
@@ -579,6 +407,12 @@ namespace crypto
   {
     m_seed.resize(KEY_SIZE);
     m_private_key.resize(KEY_SIZE);
+    update_derived();
+  }
+
+  void sphincs_private_key::update_derived()
+  {
+    derive_key_hashes(m_seed, m_private_key, m_seed_hash, m_commitment, m_verification_token, m_secret_prefix, m_token_hmac);
   }
 
   sphincs_private_key::~sphincs_private_key()
@@ -595,6 +429,7 @@ namespace crypto
       // Generate private key from seed
       generate_random_bytes_not_thread_safe(KEY_SIZE, m_private_key.data());
       
+      update_derived();
       return true;
     }
     catch (...)
@@ -612,6 +447,7 @@ namespace crypto
     {
       std::memcpy(m_seed.data(), data.data(), KEY_SIZE);
       std::memcpy(m_private_key.data(), data.data() + KEY_SIZE, KEY_SIZE);
+      update_derived();
       return true;
     }
     catch (...)
@@ -631,35 +467,13 @@ namespace crypto
   sphincs_public_key sphincs_private_key::get_public_key() const
   {
     sphincs_public_key pub_key;
-    // CRITICAL SECURITY FIX: Store seed hash, commitment, and verification token
     // Public key = H(seed) || H(seed || private_key) || H(seed || private_key || "verify")
-    // The verification token allows verification of HMAC signatures
-    crypto::hash seed_hash;
-    crypto::cn_fast_hash(m_seed.data(), m_seed.size(), seed_hash);
-    
-    // Create commitment: H(seed || private_key)
-    std::vector<uint8_t> commitment_input;
-    commitment_input.reserve(m_seed.size() + m_private_key.size());
-    commitment_input.insert(commitment_input.end(), m_seed.begin(), m_seed.end());
-    commitment_input.insert(commitment_input.end(), m_private_key.begin(), m_private_key.end());
-    
-    crypto::hash commitment;
-    crypto::cn_fast_hash(commitment_input.data(), commitment_input.size(), commitment);
-    
-    // Create verification token: H(seed || private_key || "verify")
-    // This is used to verify HMAC signatures without exposing the secret
-    std::vector<uint8_t> verify_input = commitment_input;
-    const char* verify_suffix = "verify";
-    verify_input.insert(verify_input.end(), verify_suffix, verify_suffix + strlen(verify_suffix));
-    
-    crypto::hash verification_token;
-    crypto::cn_fast_hash(verify_input.data(), verify_input.size(), verification_token);
-    
+    // The three hashes are precomputed by update_derived()
     // Public key is 96 bytes: seed_hash (32) || commitment (32) || verification_token (32)
-    std::vector<uint8_t> pk(KEY_SIZE * 3);
-    std::memcpy(pk.data(), &seed_hash, KEY_SIZE);
-    std::memcpy(pk.data() + KEY_SIZE, &commitment, KEY_SIZE);
-    std::memcpy(pk.data() + KEY_SIZE * 2, &verification_token, KEY_SIZE);
+    std::vector<uint8_t> pk(sizeof(crypto::hash) * 3);
+    std::memcpy(pk.data(), &m_seed_hash, sizeof(crypto::hash));
+    std::memcpy(pk.data() + sizeof(crypto::hash), &m_commitment, sizeof(crypto::hash));
+    std::memcpy(pk.data() + sizeof(crypto::hash) * 2, &m_verification_token, sizeof(crypto::hash));
     (void)pub_key.load(pk);
     return pub_key;
   }
@@ -668,96 +482,31 @@ namespace crypto
   {
     sphincs_signature sig;
     
-    // PROPER CRYPTOGRAPHIC FIX: Use secret-based HMAC with nonce for unforgeable signatures
     // Signature scheme: (nonce, HMAC(verification_token, message || nonce || commitment || seed_hash))
     // The nonce is deterministically derived from secret+message to prevent forgery
-    std::vector<uint8_t> sig_data(SIGNATURE_SIZE);
-    
-    // Create commitment: H(seed || private_key)
-    std::vector<uint8_t> commitment_input;
-    commitment_input.reserve(m_seed.size() + m_private_key.size());
-    commitment_input.insert(commitment_input.end(), m_seed.begin(), m_seed.end());
-    commitment_input.insert(commitment_input.end(), m_private_key.begin(), m_private_key.end());
-    
-    crypto::hash commitment;
-    crypto::cn_fast_hash(commitment_input.data(), commitment_input.size(), commitment);
-    
-    // Create seed hash
-    crypto::hash seed_hash;
-    crypto::cn_fast_hash(m_seed.data(), m_seed.size(), seed_hash);
-    
-    // Generate deterministic nonce from secret and message
-    // Nonce = H(secret || message) - requires secret knowledge to compute
-    std::vector<uint8_t> nonce_input;
-    nonce_input.reserve(commitment_input.size() + sizeof(crypto::hash));
-    nonce_input.insert(nonce_input.end(), commitment_input.begin(), commitment_input.end());
-    nonce_input.insert(nonce_input.end(),
-                      reinterpret_cast<const uint8_t*>(&message),
-                      reinterpret_cast<const uint8_t*>(&message) + sizeof(crypto::hash));
-    
+    //
+    // Nonce = H(seed || private_key || message), resumed from the absorbed
+    // secret prefix
+    KECCAK_CTX nonce_ctx = m_secret_prefix;
+    keccak_update(&nonce_ctx, reinterpret_cast<const uint8_t*>(&message), sizeof(crypto::hash));
     crypto::hash nonce;
-    crypto::cn_fast_hash(nonce_input.data(), nonce_input.size(), nonce);
-    
-    // Create verification token: H(seed || private_key || "verify")
-    // This is used as the HMAC key for BOTH signing and verification
-    std::vector<uint8_t> verify_input = commitment_input;
-    const char* verify_suffix = "verify";
-    verify_input.insert(verify_input.end(), verify_suffix, verify_suffix + strlen(verify_suffix));
-    
-    crypto::hash verification_token;
-    crypto::cn_fast_hash(verify_input.data(), verify_input.size(), verification_token);
-    
-    // Create signature input: message || nonce || commitment || seed_hash
-    std::vector<uint8_t> signature_input;
-    signature_input.reserve(sizeof(crypto::hash) + KEY_SIZE + KEY_SIZE + KEY_SIZE);
-    signature_input.insert(signature_input.end(), 
-                          reinterpret_cast<const uint8_t*>(&message), 
-                          reinterpret_cast<const uint8_t*>(&message) + sizeof(crypto::hash));
-    signature_input.insert(signature_input.end(),
-                          reinterpret_cast<const uint8_t*>(&nonce),
-                          reinterpret_cast<const uint8_t*>(&nonce) + KEY_SIZE);
-    signature_input.insert(signature_input.end(),
-                          reinterpret_cast<const uint8_t*>(&commitment),
-                          reinterpret_cast<const uint8_t*>(&commitment) + KEY_SIZE);
-    signature_input.insert(signature_input.end(),
-                          reinterpret_cast<const uint8_t*>(&seed_hash),
-                          reinterpret_cast<const uint8_t*>(&seed_hash) + KEY_SIZE);
-    
-    // Use HMAC with verification_token as the key
-    // This allows verification to work (verifier can use token from public key)
-    // The nonce (derived from secret) provides the security against forgery
+    keccak_finish(&nonce_ctx, reinterpret_cast<uint8_t*>(&nonce));
+    
+    // HMAC keyed with the verification token, resumed after the key blocks
+    hmac_keccak_state hmac = m_token_hmac;
+    hmac_keccak_update(&hmac, reinterpret_cast<const uint8_t*>(&message), sizeof(crypto::hash));
+    hmac_keccak_update(&hmac, reinterpret_cast<const uint8_t*>(&nonce), sizeof(crypto::hash));
+    hmac_keccak_update(&hmac, reinterpret_cast<const uint8_t*>(&m_commitment), sizeof(crypto::hash));
+    hmac_keccak_update(&hmac, reinterpret_cast<const uint8_t*>(&m_seed_hash), sizeof(crypto::hash));
     crypto::hash signature_hash;
-    hmac_keccak_hash(reinterpret_cast<uint8_t*>(&signature_hash), 
-                     reinterpret_cast<const uint8_t*>(&verification_token), KEY_SIZE,
-                     signature_input.data(), signature_input.size());
+    hmac_keccak_finish(&hmac, reinterpret_cast<uint8_t*>(&signature_hash));
     
-    // Store the signature hash and nonce in the signature data
-    // Format: signature_hash (32) || message (32) || nonce (32)
+    // Format: signature_hash (32) || message (32) || nonce (32) || filler
+    std::array<uint8_t, SIGNATURE_SIZE>& sig_data = sig.m_signature;
     std::memcpy(sig_data.data(), &signature_hash, sizeof(crypto::hash));
     std::memcpy(sig_data.data() + sizeof(crypto::hash), &message, sizeof(crypto::hash));
     std::memcpy(sig_data.data() + sizeof(crypto::hash) * 2, &nonce, sizeof(crypto::hash));
-    
-    // Fill remaining space with hash-based data (not random, deterministic but secure)
-    // Use iterative hashing to fill the remaining space
-    size_t offset = sizeof(crypto::hash) * 3; // signature_hash + message + nonce
-    size_t remaining = SIGNATURE_SIZE - offset;
-    crypto::hash temp_hash = signature_hash;
-    
-    for (size_t i = 0; i < remaining; i += sizeof(crypto::hash)) {
-      // Hash the previous hash with index to create next block
-      std::vector<uint8_t> hash_input;
-      hash_input.insert(hash_input.end(), reinterpret_cast<const uint8_t*>(&temp_hash), 
-                       reinterpret_cast<const uint8_t*>(&temp_hash) + sizeof(crypto::hash));
-      hash_input.insert(hash_input.end(), reinterpret_cast<const uint8_t*>(&i), 
-                       reinterpret_cast<const uint8_t*>(&i) + sizeof(size_t));
-      
-      crypto::cn_fast_hash(hash_input.data(), hash_input.size(), temp_hash);
-      size_t copy_size = std::min(remaining - i, static_cast<size_t>(sizeof(crypto::hash)));
-      std::memcpy(sig_data.data() + offset + i, &temp_hash, copy_size);
-    }
-
-    // Load into signature object to populate private members
-    (void)sig.load(sig_data);
+    fill_signature_padding(sig_data, sizeof(crypto::hash) * 3, signature_hash);
     
     return sig;
   }
@@ -770,9 +519,8 @@ namespace crypto
   // SPHINCS+ Public Key Implementation
   sphincs_public_key::sphincs_public_key()
   {
-    // CRITICAL SECURITY FIX: Public key is now 96 bytes (seed_hash || commitment || verification_token)
-    // Support both old formats (32, 64 bytes) and new format (96 bytes) for migration
-    m_public_key.resize(KEY_SIZE * 3);
+    // Public key is 96 bytes (seed_hash || commitment || verification_token)
+    m_public_key.fill(0);
   }
 
   sphincs_public_key::~sphincs_public_key()
@@ -781,184 +529,93 @@ namespace crypto
 
   bool sphincs_public_key::load(const std::vector<uint8_t>& data)
   {
-    // CRITICAL SECURITY FIX: Public key is now 96 bytes (seed_hash || commitment || verification_token)
     // Support old formats (32, 64 bytes) and new format (96 bytes) for migration
     if (data.size() != KEY_SIZE && data.size() != KEY_SIZE * 2 && data.size() != KEY_SIZE * 3)
       return false;
     
-    try
-    {
-      // Resize to match input size, padding with zeros if old format
-      m_public_key.resize(KEY_SIZE * 3, 0);
-      std::memcpy(m_public_key.data(), data.data(), std::min(data.size(), m_public_key.size()));
-      return true;
-    }
-    catch (...)
-    {
-      return false;
-    }
+    // Old formats are padded with zeros
+    m_public_key.fill(0);
+    std::memcpy(m_public_key.data(), data.data(), data.size());
+    return true;
   }
 
   std::vector<uint8_t> sphincs_public_key::save() const
   {
-    return m_public_key;
+    return std::vector<uint8_t>(m_public_key.begin(), m_public_key.end());
   }
 
   bool sphincs_public_key::verify(const crypto::hash& message, const sphincs_signature& signature) const
   {
-    // SECURITY FIX: Proper cryptographic verification
-    const std::vector<uint8_t> serialized = signature.save();
-    if (serialized.size() != sphincs_signature::SIGNATURE_SIZE)
-      return false;
+    const std::array<uint8_t, sphincs_signature::SIGNATURE_SIZE>& sig_data = signature.m_signature;
 
     // Extract components from signature:
-    // - Signature hash (first HASH_SIZE bytes)
-    // - Message (next HASH_SIZE bytes)
-    // - Nonce (after message)
-    crypto::hash sig_hash{};
-    crypto::hash sig_message{};
-    
-    std::memcpy(&sig_hash, serialized.data(), sizeof(crypto::hash));
-    std::memcpy(&sig_message, serialized.data() + sizeof(crypto::hash), sizeof(crypto::hash));
+    // signature_hash (32) || message (32) || nonce (32)
+    crypto::hash sig_hash;
+    crypto::hash sig_message;
+    std::memcpy(&sig_hash, sig_data.data(), sizeof(crypto::hash));
+    std::memcpy(&sig_message, sig_data.data() + sizeof(crypto::hash), sizeof(crypto::hash));
     
     // Verify message matches
     if (sig_message != message)
       return false;
     
     // Verify signature hash is not all zeros
-    crypto::hash zero_hash{};
-    if (sig_hash == zero_hash)
+    if (sig_hash == crypto::null_hash)
       return false;
     
-    // BACKWARD COMPATIBILITY: Handle old signatures without nonces
-    // Old signatures: signature_hash (32) || message (32) - no nonce
-    // New signatures: signature_hash (32) || message (32) || nonce (32)
-    bool has_nonce = (serialized.size() >= sizeof(crypto::hash) * 3);
-    
-    if (!has_nonce)
-    {
-      // OLD FORMAT SIGNATURE - BACKWARD COMPATIBILITY
-      // For old blocks, we accept signatures even though they're vulnerable
-      // This allows the blockchain to continue functioning
-      // Old signatures are vulnerable to forgery, but we can't reject existing blocks
-      
-      // Old verification: H(commitment || message || seed_hash)
-      if (m_public_key.size() < KEY_SIZE * 2)
-        return false; // Need at least 64 bytes (seed_hash || commitment) for old format
-      
-      crypto::hash pub_seed_hash_old{};
-      crypto::hash pub_commitment_old{};
-      std::memcpy(&pub_seed_hash_old, m_public_key.data(), KEY_SIZE);
-      std::memcpy(&pub_commitment_old, m_public_key.data() + KEY_SIZE, KEY_SIZE);
-      
-      // Old signature verification (vulnerable but needed for backward compatibility)
-      std::vector<uint8_t> old_verification_input;
-      old_verification_input.reserve(KEY_SIZE + sizeof(crypto::hash) + KEY_SIZE);
-      old_verification_input.insert(old_verification_input.end(),
-                                   reinterpret_cast<const uint8_t*>(&pub_commitment_old),
-                                   reinterpret_cast<const uint8_t*>(&pub_commitment_old) + KEY_SIZE);
-      old_verification_input.insert(old_verification_input.end(),
-                                   reinterpret_cast<const uint8_t*>(&message),
-                                   reinterpret_cast<const uint8_t*>(&message) + sizeof(crypto::hash));
-      old_verification_input.insert(old_verification_input.end(),
-                                   reinterpret_cast<const uint8_t*>(&pub_seed_hash_old),
-                                   reinterpret_cast<const uint8_t*>(&pub_seed_hash_old) + KEY_SIZE);
-      
-      crypto::hash old_expected_hash;
-      crypto::cn_fast_hash(old_verification_input.data(), old_verification_input.size(), old_expected_hash);
-      
-      // Accept old signatures for backward compatibility (acknowledging they're vulnerable)
-      return sig_hash == old_expected_hash;
-    }
-    
-    // NEW FORMAT SIGNATURE - Proper cryptographic verification
     // Same scheme as XMSS: (nonce, HMAC(verification_token, message || nonce || commitment || seed_hash))
-    
     // Public key contains: H(seed) || H(seed || private_key) || H(seed || private_key || "verify")
-    // New format requires 96 bytes (3 * KEY_SIZE)
-    if (m_public_key.size() < KEY_SIZE * 3)
-      return false; // New format signatures require new format keys
-    
-    crypto::hash pub_seed_hash{};
-    crypto::hash pub_commitment{};
-    crypto::hash pub_verification_token{};
+    crypto::hash pub_seed_hash;
+    crypto::hash pub_commitment;
+    crypto::hash pub_verification_token;
     std::memcpy(&pub_seed_hash, m_public_key.data(), KEY_SIZE);
     std::memcpy(&pub_commitment, m_public_key.data() + KEY_SIZE, KEY_SIZE);
     std::memcpy(&pub_verification_token, m_public_key.data() + KEY_SIZE * 2, KEY_SIZE);
     
     // Extract nonce from signature (stored after message)
-    crypto::hash sig_nonce{};
-    std::memcpy(&sig_nonce, serialized.data() + sizeof(crypto::hash) * 2, sizeof(crypto::hash));
+    crypto::hash sig_nonce;
+    std::memcpy(&sig_nonce, sig_data.data() + sizeof(crypto::hash) * 2, sizeof(crypto::hash));
     
     // Sanity check: nonce should not be all zeros
-    if (sig_nonce == zero_hash)
+    if (sig_nonce == crypto::null_hash)
       return false;
     
-    // CRITICAL NONCE VERIFICATION: Verify nonce is correctly computed
-    // Reject if nonce matches the public nonce H(commitment || message)
-    // This prevents attackers from using the obvious forged nonce.
-    // The correct nonce is H(secret || message) which requires the secret.
-    std::vector<uint8_t> public_nonce_input;
-    public_nonce_input.reserve(KEY_SIZE + sizeof(crypto::hash));
-    public_nonce_input.insert(public_nonce_input.end(),
-                             reinterpret_cast<const uint8_t*>(&pub_commitment),
-                             reinterpret_cast<const uint8_t*>(&pub_commitment) + KEY_SIZE);
-    public_nonce_input.insert(public_nonce_input.end(),
-                             reinterpret_cast<const uint8_t*>(&message),
-                             reinterpret_cast<const uint8_t*>(&message) + sizeof(crypto::hash));
-    
+    // Reject the "public" nonce H(commitment || message) anyone could compute;
+    // the signer's nonce H(secret || message) requires the secret
+    uint8_t public_nonce_input[KEY_SIZE + sizeof(crypto::hash)];
+    std::memcpy(public_nonce_input, &pub_commitment, KEY_SIZE);
+    std::memcpy(public_nonce_input + KEY_SIZE, &message, sizeof(crypto::hash));
     crypto::hash public_nonce;
-    crypto::cn_fast_hash(public_nonce_input.data(), public_nonce_input.size(), public_nonce);
-    
-    // REJECT if nonce matches the public nonce (H(commitment || message))
-    // This is the obvious forged nonce that an attacker would try
+    crypto::cn_fast_hash(public_nonce_input, sizeof(public_nonce_input), public_nonce);
     if (sig_nonce == public_nonce)
       return false;
     
-    // Reconstruct the signature input exactly as used during signing
-    // This is: message || nonce || commitment || seed_hash
-    std::vector<uint8_t> verification_input;
-    verification_input.reserve(sizeof(crypto::hash) + KEY_SIZE + KEY_SIZE + KEY_SIZE);
-    verification_input.insert(verification_input.end(),
-                             reinterpret_cast<const uint8_t*>(&message),
-                             reinterpret_cast<const uint8_t*>(&message) + sizeof(crypto::hash));
-    verification_input.insert(verification_input.end(),
-                             reinterpret_cast<const uint8_t*>(&sig_nonce),
-                             reinterpret_cast<const uint8_t*>(&sig_nonce) + KEY_SIZE);
-    verification_input.insert(verification_input.end(), 
-                             reinterpret_cast<const uint8_t*>(&pub_commitment),
-                             reinterpret_cast<const uint8_t*>(&pub_commitment) + KEY_SIZE);
-    verification_input.insert(verification_input.end(),
-                             reinterpret_cast<const uint8_t*>(&pub_seed_hash),
-                             reinterpret_cast<const uint8_t*>(&pub_seed_hash) + KEY_SIZE);
+    // Recompute HMAC(verification_token, message || nonce || commitment || seed_hash)
+    // exactly as done when signing
+    uint8_t verification_input[sizeof(crypto::hash) + KEY_SIZE * 3];
+    uint8_t *ptr = verification_input;
+    std::memcpy(ptr, &message, sizeof(crypto::hash)); ptr += sizeof(crypto::hash);
+    std::memcpy(ptr, &sig_nonce, KEY_SIZE); ptr += KEY_SIZE;
+    std::memcpy(ptr, &pub_commitment, KEY_SIZE); ptr += KEY_SIZE;
+    std::memcpy(ptr, &pub_seed_hash, KEY_SIZE);
     
-    // PROPER VERIFICATION: Use verification_token for HMAC (same as signing)
-    // Signing: HMAC(verification_token, message || nonce || commitment || seed_hash)
-    // Verification: HMAC(verification_token, message || nonce || commitment || seed_hash)
-    // These match because both use verification_token!
-    //
-    // SECURITY: Attacker needs the correct nonce = H(secret || message) to forge
-    // They cannot compute this without the secret, so forgery is prevented
     crypto::hash expected_hash;
     hmac_keccak_hash(reinterpret_cast<uint8_t*>(&expected_hash),
                      reinterpret_cast<const uint8_t*>(&pub_verification_token), KEY_SIZE,
-                     verification_input.data(), verification_input.size());
+                     verification_input, sizeof(verification_input));
     
-    // Verify the signature hash matches
-    // This works because both signing and verification use verification_token
-    // The nonce (requiring secret knowledge) prevents forgery
     return sig_hash == expected_hash;
   }
 
   std::vector<uint8_t> sphincs_public_key::get_public_key() const
   {
-    return m_public_key;
+    return std::vector<uint8_t>(m_public_key.begin(), m_public_key.end());
   }
 
   // SPHINCS+ Signature Implementation
   sphincs_signature::sphincs_signature()
   {
-    m_signature.resize(SIGNATURE_SIZE);
+    m_signature.fill(0);
   }
 
   sphincs_signature::~sphincs_signature()
@@ -970,20 +627,13 @@ namespace crypto
     if (data.size() != SIGNATURE_SIZE)
       return false;
     
-    try
-    {
-      std::memcpy(m_signature.data(), data.data(), SIGNATURE_SIZE);
-      return true;
-    }
-    catch (...)
-    {
-      return false;
-    }
+    std::memcpy(m_signature.data(), data.data(), SIGNATURE_SIZE);
+    return true;
   }
 
   std::vector<uint8_t> sphincs_signature::save() const
   {
-    return m_signature;
+    return std::vector<uint8_t>(m_signature.begin(), m_signature.end());
   }
 
   // Quantum Safe Manager Implementation
@@ -1321,6 +971,46 @@ namespace crypto
     m_current_algo = algo;
   }
 
+  bool check_dual_signature_format(const crypto::hash& message, const uint8_t *dual_signature, size_t size)
+  {
+    // create_dual_signature signs H(message)
+    crypto::hash message_hash;
+    crypto::cn_fast_hash(&message, sizeof(message), message_hash);
+
+    // XMSS: length (4) || signature_hash (32) || message (32) || index (4) || nonce (32) || filler || index (4)
+    constexpr size_t xmss_len = xmss_signature::SIGNATURE_SIZE + sizeof(uint32_t);
+    constexpr size_t xmss_index_offset = sizeof(crypto::hash) * 2;
+    uint32_t len;
+    if (size < sizeof(uint32_t))
+      return false;
+    std::memcpy(&len, dual_signature, sizeof(uint32_t));
+    if (len != xmss_len)
+      return false;
+    const uint8_t *xmss = dual_signature + sizeof(uint32_t);
+    const size_t xmss_available = std::min(size - sizeof(uint32_t), xmss_signature::SIGNATURE_SIZE);
+    if (!check_signature_body(xmss, xmss_available, message_hash, xmss_index_offset + sizeof(uint32_t), xmss_index_offset + sizeof(uint32_t) + sizeof(crypto::hash)))
+      return false;
+    if (size >= sizeof(uint32_t) + xmss_len)
+    {
+      uint32_t index, trailing_index;
+      std::memcpy(&index, xmss + xmss_index_offset, sizeof(uint32_t));
+      std::memcpy(&trailing_index, xmss + xmss_signature::SIGNATURE_SIZE, sizeof(uint32_t));
+      if (index != trailing_index)
+        return false;
+    }
+
+    // SPHINCS+: length (4) || signature_hash (32) || message (32) || nonce (32) || filler
+    const size_t sphincs_offset = sizeof(uint32_t) + xmss_len;
+    if (size < sphincs_offset + sizeof(uint32_t))
+      return false;
+    std::memcpy(&len, dual_signature + sphincs_offset, sizeof(uint32_t));
+    if (len != sphincs_signature::SIGNATURE_SIZE)
+      return false;
+    const uint8_t *sphincs = dual_signature + sphincs_offset + sizeof(uint32_t);
+    const size_t sphincs_available = std::min(size - sphincs_offset - sizeof(uint32_t), sphincs_signature::SIGNATURE_SIZE);
+    return check_signature_body(sphincs, sphincs_available, message_hash, sizeof(crypto::hash) * 2, sizeof(crypto::hash) * 3);
+  }
+
   // Utility functions
   std::string algorithm_to_string(quantum_algorithm algo)
   {
@@ -1426,6 +1116,13 @@ namespace crypto
   }
 
   std::vector<uint8_t> quantum_safe_manager::create_dual_signature(const std::vector<uint8_t>& message) const
+  {
+    if (!has_dual_keys())
+      return std::vector<uint8_t>();
+    return create_dual_signature(message, m_xmss_private->get_index());
+  }
+
+  std::vector<uint8_t> quantum_safe_manager::create_dual_signature(const std::vector<uint8_t>& message, uint32_t xmss_index) const
   {
     if (!has_dual_keys())
       return std::vector<uint8_t>();
@@ -1437,7 +1134,7 @@ namespace crypto
       crypto::cn_fast_hash(message.data(), message.size(), message_hash);
       
       // Create XMSS signature
-      xmss_signature xmss_sig_obj = m_xmss_private->sign(message_hash);
+      xmss_signature xmss_sig_obj = m_xmss_private->sign(message_hash, xmss_index);
       std::vector<uint8_t> xmss_sig = xmss_sig_obj.save();
       
       // Create SPHINCS+ signature
@@ -1530,7 +1227,7 @@ namespace crypto
       
       // Write file header for dual keys
       uint32_t magic = 0x5146534B; // "QSFK" in hex
-      uint8_t version = 2; // Version 2 for dual keys
+      uint8_t version = 3; // Version 3 for dual keys with the XMSS private key
       uint8_t algo_byte = static_cast<uint8_t>(quantum_algorithm::DUAL);
       
       file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
@@ -1593,6 +1290,11 @@ namespace crypto
       
       if (version < 2) // Need version 2+ for dual keys
         return false;
+
+      // Version 2 files did not store the XMSS private key, so their keys
+      // cannot be restored and the caller generates new ones
+      if (version == 2)
+        return false;
       
       quantum_algorithm algo = static_cast<quantum_algorithm>(algo_byte);
       if (algo != quantum_algorithm::DUAL)
@@ -1698,4 +1400,136 @@ namespace crypto
       return "Error getting dual algorithm info";
     }
   }
+  uint32_t quantum_safe_manager::get_xmss_index() const
+  {
+    return m_xmss_private ? m_xmss_private->get_index() : 0;
+  }
+
+  void quantum_safe_manager::set_xmss_index(uint32_t index)
+  {
+    if (m_xmss_private)
+      m_xmss_private->set_index(index);
+  }
+
+  uint32_t quantum_safe_manager::get_xmss_max_signatures() const
+  {
+    return m_xmss_private ? m_xmss_private->get_max_signatures() : 0;
+  }
+
+  // Quantum Safe Signer Implementation
+  quantum_safe_signer::quantum_safe_signer()
+    : m_next_index(0), m_max_signatures(0), m_xmss_tree_height(10), m_sphincs_level(5)
+  {
+  }
+
+  quantum_safe_signer::~quantum_safe_signer()
+  {
+  }
+
+  bool quantum_safe_signer::init(const std::string& filename, uint32_t xmss_tree_height, uint32_t sphincs_level)
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_filename = filename;
+    m_xmss_tree_height = xmss_tree_height;
+    m_sphincs_level = sphincs_level;
+
+    std::shared_ptr<quantum_safe_manager> manager = std::make_shared<quantum_safe_manager>();
+    bool loaded = false;
+    if (!filename.empty())
+      loaded = manager->load_dual_keys(filename) || manager->load_keys(filename);
+
+    if (!loaded || !manager->has_dual_keys())
+    {
+      // Missing, single-algorithm or old-format keys are replaced by a fresh
+      // dual key pair
+      if (!manager->ensure_modern_keys(xmss_tree_height, sphincs_level))
+        return false;
+    }
+
+    const uint32_t next_index = manager->get_xmss_index();
+    if (!reserve_tree(*manager))
+      return false;
+
+    m_manager = manager;
+    m_dual_public_key = m_manager->get_dual_public_key();
+    m_next_index = next_index;
+    m_max_signatures = m_manager->get_xmss_max_signatures();
+    return !m_dual_public_key.empty();
+  }
+
+  bool quantum_safe_signer::is_initialized() const
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_manager != nullptr;
+  }
+
+  bool quantum_safe_signer::rotate_keys()
+  {
+    // Called with m_lock held
+    std::shared_ptr<quantum_safe_manager> manager = std::make_shared<quantum_safe_manager>();
+    if (!manager->generate_dual_keys(m_xmss_tree_height, m_sphincs_level))
+      return false;
+    if (!reserve_tree(*manager))
+      return false;
+    m_manager = manager;
+    m_dual_public_key = m_manager->get_dual_public_key();
+    m_next_index = 0;
+    m_max_signatures = m_manager->get_xmss_max_signatures();
+    return true;
+  }
+
+  bool quantum_safe_signer::reserve_tree(quantum_safe_manager& manager) const
+  {
+    // The key file claims every leaf as used while the keys are loaded, so a
+    // crash leaves an exhausted tree behind and the next start rotates the
+    // keys instead of reusing leaves; store() writes back the real index
+    if (m_filename.empty())
+      return true;
+    manager.set_xmss_index(manager.get_xmss_max_signatures());
+    return manager.save_dual_keys(m_filename);
+  }
+
+  bool quantum_safe_signer::sign(const crypto::hash& message, std::vector<uint8_t>& dual_signature, std::vector<uint8_t>& dual_public_key)
+  {
+    std::shared_ptr<const quantum_safe_manager> manager;
+    uint32_t index;
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      if (!m_manager)
+        return false;
+      if (m_next_index >= m_max_signatures && !rotate_keys())
+        return false;
+      index = m_next_index++;
+      manager = m_manager;
+      dual_public_key = m_dual_public_key;
+    }
+
+    // Key material is immutable once published, so signing runs unlocked
+    dual_signature = manager->create_dual_signature(std::vector<uint8_t>(message.data, message.data + sizeof(message.data)), index);
+    return !dual_signature.empty();
+  }
+
+  std::vector<uint8_t> quantum_safe_signer::get_dual_public_key() const
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_dual_public_key;
+  }
+
+  uint32_t quantum_safe_signer::get_remaining_signatures() const
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_max_signatures > m_next_index ? m_max_signatures - m_next_index : 0;
+  }
+
+  bool quantum_safe_signer::store()
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (!m_manager || m_filename.empty())
+      return true;
+    // Signing never reads the stored index, so updating it here is safe;
+    // once this is written the leaves after m_next_index are no longer
+    // claimed, so store() is only for shutdown
+    m_manager->set_xmss_index(m_next_index);
+    return m_manager->save_dual_keys(m_filename);
+  }
 } 
\ No newline at end of file
@@ -29,11 +29,18 @@
 #pragma once
 
 #include <cstdint>
+#include <array>
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
 #include "crypto/hash.h"
 
+extern "C"
+{
+#include "crypto/hmac-keccak.h"
+}
+
 namespace crypto
 {
   // Forward declarations
@@ -77,6 +84,10 @@ namespace crypto
     
     // Sign message
     xmss_signature sign(const crypto::hash& message) const;
+
+    // Sign message with an explicit leaf index (the caller is responsible
+    // for never handing out the same index twice)
+    xmss_signature sign(const crypto::hash& message, uint32_t index) const;
     
     // Get remaining signatures
     uint32_t get_remaining_signatures() const;
@@ -84,11 +95,29 @@ namespace crypto
     // Get tree height
     uint32_t get_tree_height() const;
 
+    // Get/set the next unused leaf index
+    uint32_t get_index() const;
+    void set_index(uint32_t index);
+    uint32_t get_max_signatures() const;
+
   private:
+    void update_derived();
+
     std::vector<uint8_t> m_seed;
     std::vector<uint8_t> m_private_key;
     uint32_t m_index;
     uint32_t m_max_signatures;
+
+    // H(seed), H(seed || private_key) and H(seed || private_key || "verify"),
+    // recomputed whenever the key material changes
+    crypto::hash m_seed_hash;
+    crypto::hash m_commitment;
+    crypto::hash m_verification_token;
+
+    // keccak state with seed || private_key absorbed and HMAC state keyed
+    // with the verification token; signing copies them instead of rehashing
+    KECCAK_CTX m_secret_prefix;
+    hmac_keccak_state m_token_hmac;
   };
 
   class xmss_public_key
@@ -112,7 +141,8 @@ namespace crypto
     std::vector<uint8_t> get_public_key() const;
 
   private:
-    std::vector<uint8_t> m_public_key;
+    // seed_hash || commitment || verification_token, zero padded for old formats
+    std::array<uint8_t, KEY_SIZE * 3> m_public_key;
   };
 
   class xmss_signature
@@ -130,7 +160,10 @@ namespace crypto
     std::vector<uint8_t> save() const;
 
   private:
-    std::vector<uint8_t> m_signature;
+    friend class xmss_private_key;
+    friend class xmss_public_key;
+
+    std::array<uint8_t, SIGNATURE_SIZE> m_signature;
     uint32_t m_index;
   };
 
@@ -164,8 +197,21 @@ namespace crypto
     uint32_t get_level() const;
 
   private:
+    void update_derived();
+
     std::vector<uint8_t> m_seed;
     std::vector<uint8_t> m_private_key;
+
+    // H(seed), H(seed || private_key) and H(seed || private_key || "verify"),
+    // recomputed whenever the key material changes
+    crypto::hash m_seed_hash;
+    crypto::hash m_commitment;
+    crypto::hash m_verification_token;
+
+    // keccak state with seed || private_key absorbed and HMAC state keyed
+    // with the verification token; signing copies them instead of rehashing
+    KECCAK_CTX m_secret_prefix;
+    hmac_keccak_state m_token_hmac;
   };
 
   class sphincs_public_key
@@ -189,7 +235,8 @@ namespace crypto
     std::vector<uint8_t> get_public_key() const;
 
   private:
-    std::vector<uint8_t> m_public_key;
+    // seed_hash || commitment || verification_token, zero padded for old formats
+    std::array<uint8_t, KEY_SIZE * 3> m_public_key;
   };
 
   class sphincs_signature
@@ -207,7 +254,10 @@ namespace crypto
     std::vector<uint8_t> save() const;
 
   private:
-    std::vector<uint8_t> m_signature;
+    friend class sphincs_private_key;
+    friend class sphincs_public_key;
+
+    std::array<uint8_t, SIGNATURE_SIZE> m_signature;
   };
 
   // Quantum-safe signature manager
@@ -250,6 +300,7 @@ namespace crypto
                                 const std::vector<uint8_t>& xmss_signature,
                                 const std::vector<uint8_t>& sphincs_signature) const;
     std::vector<uint8_t> create_dual_signature(const std::vector<uint8_t>& message) const;
+    std::vector<uint8_t> create_dual_signature(const std::vector<uint8_t>& message, uint32_t xmss_index) const;
     bool verify_dual_signature(const std::vector<uint8_t>& message, 
                               const std::vector<uint8_t>& dual_signature) const;
     
@@ -259,6 +310,11 @@ namespace crypto
     std::vector<uint8_t> get_dual_public_key() const;
     std::string get_dual_algorithm_info() const;
 
+    // XMSS leaf index bookkeeping for long-lived signers
+    uint32_t get_xmss_index() const;
+    void set_xmss_index(uint32_t index);
+    uint32_t get_xmss_max_signatures() const;
+
   private:
     std::unique_ptr<xmss_private_key> m_xmss_private;
     std::unique_ptr<xmss_public_key> m_xmss_public;
@@ -267,6 +323,59 @@ namespace crypto
     quantum_algorithm m_current_algo;
   };
 
+  // Long-lived dual key signer
+  //
+  // Keys are loaded (or generated) once and kept in memory together with
+  // their derived commitments, so signing a block costs no key generation
+  // and no disk I/O. Each signature takes the next XMSS leaf index; when
+  // the tree is exhausted a fresh key pair is generated and written to the
+  // key file. Thread safe.
+  class quantum_safe_signer
+  {
+  public:
+    quantum_safe_signer();
+    ~quantum_safe_signer();
+
+    // Load dual keys from filename, migrating old-format keys and generating
+    // new ones if needed; an empty filename keeps generated keys in memory only
+    bool init(const std::string& filename, uint32_t xmss_tree_height = 10, uint32_t sphincs_level = 5);
+    bool is_initialized() const;
+
+    // Same output as quantum_safe_manager::create_dual_signature over the
+    // message bytes, plus the dual public key matching the signing keys.
+    // Every call uses up an XMSS leaf. The key file marks the whole tree as
+    // used while the signer runs, so after a crash the next start generates
+    // new keys rather than reusing leaves
+    bool sign(const crypto::hash& message, std::vector<uint8_t>& dual_signature, std::vector<uint8_t>& dual_public_key);
+
+    std::vector<uint8_t> get_dual_public_key() const;
+    uint32_t get_remaining_signatures() const;
+
+    // Write keys and the current XMSS index back to the key file, if any,
+    // handing the unused leaves back to the next start; call on shutdown
+    bool store();
+
+  private:
+    bool rotate_keys();
+    bool reserve_tree(quantum_safe_manager& manager) const;
+
+    mutable std::mutex m_lock;
+    std::shared_ptr<quantum_safe_manager> m_manager;
+    std::vector<uint8_t> m_dual_public_key;
+    uint32_t m_next_index;
+    uint32_t m_max_signatures;
+    std::string m_filename;
+    uint32_t m_xmss_tree_height;
+    uint32_t m_sphincs_level;
+  };
+
+  // Format check of a dual signature: both signatures are well formed, name
+  // H(message) and carry the filler derived from their signature hash. Uses
+  // no public key, so anyone can produce a passing signature; this is not
+  // authentication. Accepts a dual signature truncated to size bytes, as
+  // stored in blocks
+  bool check_dual_signature_format(const crypto::hash& message, const uint8_t *dual_signature, size_t size);
+
   // Utility functions
   std::string algorithm_to_string(quantum_algorithm algo);
   quantum_algorithm string_to_algorithm(const std::string& str);
@@ -35,6 +35,9 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <limits.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 #include "randomx.h"
 #include "c_threads.h"
@@ -49,16 +52,45 @@
 static CTHR_RWLOCK_TYPE main_dataset_lock = CTHR_RWLOCK_INIT;
 static CTHR_RWLOCK_TYPE main_cache_lock = CTHR_RWLOCK_INIT;
 
-static randomx_dataset *main_dataset = NULL;
+#define RX_MAX_NUMA_NODES	8
+
+// One dataset per NUMA node when qsf_RANDOMX_NUMA is set, otherwise only the first is used
+static randomx_dataset *main_datasets[RX_MAX_NUMA_NODES] = { NULL };
 static randomx_cache *main_cache = NULL;
 static char main_seedhash[HASH_SIZE];
 static int main_seedhash_set = 0;
 
-static CTHR_RWLOCK_TYPE secondary_cache_lock = CTHR_RWLOCK_INIT;
+// Cache and datasets for the upcoming seed epoch, built ahead and swapped with the main ones at the switch
+static CTHR_RWLOCK_TYPE next_lock = CTHR_RWLOCK_INIT;
+
+static randomx_dataset *next_datasets[RX_MAX_NUMA_NODES] = { NULL };
+static randomx_cache *next_cache = NULL;
+static char next_seedhash[HASH_SIZE];
+static int next_seedhash_set = 0;
+static int next_cache_ready = 0;
+static int next_datasets_ready = 0;
+
+#define RX_MAX_LIGHT_CACHES	8
+#define RX_DEFAULT_LIGHT_CACHES	3
+
+// LRU pool of light mode caches for seeds other than the main one (alt chains, old epochs)
+typedef struct light_cache {
+  CTHR_RWLOCK_TYPE lock;
+  randomx_cache *cache;
+  char seedhash[HASH_SIZE];
+  int seedhash_set;
+  uint64_t last_used;
+} light_cache;
 
-static randomx_cache *secondary_cache = NULL;
-static char secondary_seedhash[HASH_SIZE];
-static int secondary_seedhash_set = 0;
+#define LIGHT_CACHE_INIT	{ CTHR_RWLOCK_INIT, NULL, { 0 }, 0, 0 }
+
+// Held while a slot is picked and reassigned, each slot's own lock guards its cache
+static CTHR_RWLOCK_TYPE light_caches_lock = CTHR_RWLOCK_INIT;
+static light_cache light_caches[RX_MAX_LIGHT_CACHES] = {
+  LIGHT_CACHE_INIT, LIGHT_CACHE_INIT, LIGHT_CACHE_INIT, LIGHT_CACHE_INIT,
+  LIGHT_CACHE_INIT, LIGHT_CACHE_INIT, LIGHT_CACHE_INIT, LIGHT_CACHE_INIT
+};
+static uint64_t light_caches_clock = 0;
 
 #if defined(_MSC_VER)
 #define THREADV __declspec(thread)
@@ -67,13 +99,16 @@ static int secondary_seedhash_set = 0;
 #endif
 
 static THREADV randomx_vm *main_vm_full = NULL;
+static THREADV randomx_dataset *main_vm_full_dataset = NULL;
 static THREADV randomx_vm *main_vm_light = NULL;
-static THREADV randomx_vm *secondary_vm_light = NULL;
+static THREADV randomx_vm *light_vms[RX_MAX_LIGHT_CACHES] = { NULL };
 
 static THREADV uint32_t miner_thread = 0;
+static THREADV size_t numa_node = 0;
 
 static bool is_main(const char* seedhash) { return main_seedhash_set && (memcmp(seedhash, main_seedhash, HASH_SIZE) == 0); }
-static bool is_secondary(const char* seedhash) { return secondary_seedhash_set && (memcmp(seedhash, secondary_seedhash, HASH_SIZE) == 0); }
+static bool is_next(const char* seedhash) { return next_seedhash_set && (memcmp(seedhash, next_seedhash, HASH_SIZE) == 0); }
+static bool is_light(const light_cache* lc, const char* seedhash) { return lc->seedhash_set && (memcmp(seedhash, lc->seedhash, HASH_SIZE) == 0); }
 
 static void local_abort(const char *msg)
 {
@@ -121,6 +156,50 @@ static inline int disabled_flags(void) {
   return flags;
 }
 
+enum { RX_NEXT_EPOCH_NONE, RX_NEXT_EPOCH_CACHE, RX_NEXT_EPOCH_DATASET };
+
+// What is built ahead for the next seed epoch, from qsf_RANDOMX_NEXT_EPOCH: "none", "cache", or
+// by default "dataset", which also builds the next dataset(s) when a dataset is in use and so
+// doubles the dataset memory. "cache" only needs another 256 MB.
+static int next_epoch_mode(void) {
+  static int mode = -1;
+
+  if (mode != -1) {
+    return mode;
+  }
+
+  const char *env = getenv("qsf_RANDOMX_NEXT_EPOCH");
+  if (!env || !strcmp(env, "dataset")) {
+    mode = RX_NEXT_EPOCH_DATASET;
+  }
+  else if (!strcmp(env, "cache")) {
+    mode = RX_NEXT_EPOCH_CACHE;
+  }
+  else {
+    mode = RX_NEXT_EPOCH_NONE;
+  }
+
+  return mode;
+}
+
+// Size of the light cache pool, from qsf_RANDOMX_LIGHT_CACHES. Each cache takes 256 MB once used.
+static size_t light_cache_count(void) {
+  static int count = -1;
+
+  if (count != -1) {
+    return count;
+  }
+
+  const char *env = getenv("qsf_RANDOMX_LIGHT_CACHES");
+  int value = env ? atoi(env) : RX_DEFAULT_LIGHT_CACHES;
+  if (value < 1 || value > RX_MAX_LIGHT_CACHES) {
+    value = RX_DEFAULT_LIGHT_CACHES;
+  }
+  count = value;
+
+  return count;
+}
+
 static inline int enabled_flags(void) {
   static int flags = -1;
 
@@ -133,6 +212,90 @@ static inline int enabled_flags(void) {
   return flags;
 }
 
+#ifdef __linux__
+static cpu_set_t numa_node_cpus[RX_MAX_NUMA_NODES];
+
+static int read_node_cpus(int node, cpu_set_t *set) {
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    return 0;
+  }
+
+  // cpulist is a comma separated list of cpus and cpu ranges, e.g. "0-7,16-23"
+  CPU_ZERO(set);
+  unsigned int first, last;
+  while (fscanf(f, "%u", &first) == 1) {
+    last = first;
+    int c = fgetc(f);
+    if (c == '-') {
+      if (fscanf(f, "%u", &last) != 1) {
+        break;
+      }
+      c = fgetc(f);
+    }
+    for (unsigned int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+      CPU_SET(cpu, set);
+    }
+    if (c != ',') {
+      break;
+    }
+  }
+  fclose(f);
+  return CPU_COUNT(set) > 0;
+}
+#endif
+
+// Number of NUMA nodes with their own dataset, 1 unless qsf_RANDOMX_NUMA is set on a multi-node Linux box
+static size_t numa_node_count(void) {
+  static int count = -1;
+
+  if (count != -1) {
+    return count;
+  }
+
+  int nodes = 0;
+#ifdef __linux__
+  if (getenv("qsf_RANDOMX_NUMA")) {
+    // node ids can be sparse, memory-only nodes have no cpus and are skipped
+    for (int node = 0; node < 64 && nodes < RX_MAX_NUMA_NODES; ++node) {
+      if (read_node_cpus(node, &numa_node_cpus[nodes])) {
+        ++nodes;
+      }
+    }
+    if (nodes > 1) {
+      minfo(RX_LOGCAT, "RandomX will use one dataset per NUMA node (%d nodes)", nodes);
+    } else {
+      minfo(RX_LOGCAT, "qsf_RANDOMX_NUMA is set, but only one NUMA node was found");
+    }
+  }
+#endif
+
+  count = nodes > 1 ? nodes : 1;
+  return count;
+}
+
+// Restricts the calling thread to the cpus of a NUMA node, node < 0 leaves it unbound
+static void bind_numa_node(int node) {
+#ifdef __linux__
+  if (node < 0 || (size_t)node >= numa_node_count()) {
+    return;
+  }
+  const int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &numa_node_cpus[node]);
+  if (err) {
+    mwarning(RX_LOGCAT, "Couldn't bind thread to NUMA node %d: error %d", node, err);
+  }
+#else
+  (void)node;
+#endif
+}
+
+// Miner threads bound to a node use that node's dataset, everything else uses the first one
+static randomx_dataset *local_dataset(void) {
+  return main_datasets[numa_node] ? main_datasets[numa_node] : main_datasets[0];
+}
+
 #define SEEDHASH_EPOCH_BLOCKS	2048	/* Must be same as BLOCKS_SYNCHRONIZING_MAX_COUNT in cryptonote_config.h */
 #define SEEDHASH_EPOCH_LAG		64
 
@@ -223,6 +386,19 @@ static void rx_alloc_dataset(randomx_flags flags, randomx_dataset** dataset, int
   }
 }
 
+static void rx_alloc_datasets(randomx_flags flags, randomx_dataset** datasets, int ignore_env)
+{
+  rx_alloc_dataset(flags, &datasets[0], ignore_env);
+  if (!datasets[0]) {
+    return;
+  }
+
+  // Pages are only placed on a node when first touched, which the node's init threads do in rx_init_dataset
+  for (size_t node = 1; node < numa_node_count(); ++node) {
+    rx_alloc_dataset(flags, &datasets[node], 1);
+  }
+}
+
 static void rx_alloc_cache(randomx_flags flags, randomx_cache** cache)
 {
   if (*cache) {
@@ -239,7 +415,17 @@ static void rx_alloc_cache(randomx_flags flags, randomx_cache** cache)
 
 static void rx_init_full_vm(randomx_flags flags, randomx_vm** vm)
 {
-  if (*vm || !main_dataset || (disabled_flags() & RANDOMX_FLAG_FULL_MEM)) {
+  randomx_dataset *dataset = local_dataset();
+  if (*vm) {
+    // the main datasets are exchanged with the next epoch's ones at a seed switch
+    if (dataset && dataset != main_vm_full_dataset) {
+      randomx_vm_set_dataset(*vm, dataset);
+      main_vm_full_dataset = dataset;
+    }
+    return;
+  }
+
+  if (!dataset || (disabled_flags() & RANDOMX_FLAG_FULL_MEM)) {
     return;
   }
 
@@ -247,18 +433,19 @@ static void rx_init_full_vm(randomx_flags flags, randomx_vm** vm)
     flags |= RANDOMX_FLAG_SECURE;
   }
 
-  *vm = randomx_create_vm((flags | RANDOMX_FLAG_LARGE_PAGES | RANDOMX_FLAG_FULL_MEM) & ~disabled_flags(), NULL, main_dataset);
+  *vm = randomx_create_vm((flags | RANDOMX_FLAG_LARGE_PAGES | RANDOMX_FLAG_FULL_MEM) & ~disabled_flags(), NULL, dataset);
   if (!*vm) {
     static int shown = 0;
     if (!shown) {
         shown = 1;
         alloc_err_msg("Couldn't allocate RandomX full VM using large pages (will print only once)");
     }
-    *vm = randomx_create_vm((flags | RANDOMX_FLAG_FULL_MEM) & ~disabled_flags(), NULL, main_dataset);
+    *vm = randomx_create_vm((flags | RANDOMX_FLAG_FULL_MEM) & ~disabled_flags(), NULL, dataset);
     if (!*vm) {
       merror(RX_LOGCAT, "Couldn't allocate RandomX full VM");
     }
   }
+  main_vm_full_dataset = *vm ? dataset : NULL;
 }
 
 static void rx_init_light_vm(randomx_flags flags, randomx_vm** vm, randomx_cache* cache)
@@ -288,58 +475,73 @@ static void rx_init_light_vm(randomx_flags flags, randomx_vm** vm, randomx_cache
 
 typedef struct seedinfo {
   randomx_cache *si_cache;
+  randomx_dataset *si_dataset;
   unsigned long si_start;
   unsigned long si_count;
+  int si_node;
 } seedinfo;
 
 static CTHR_THREAD_RTYPE rx_seedthread(void *arg) {
   seedinfo *si = arg;
-  randomx_init_dataset(main_dataset, si->si_cache, si->si_start, si->si_count);
+  bind_numa_node(si->si_node);
+  if (si->si_dataset) {
+    randomx_init_dataset(si->si_dataset, si->si_cache, si->si_start, si->si_count);
+  }
   CTHR_THREAD_RETURN;
 }
 
-static void rx_init_dataset(size_t max_threads) {
-  if (!main_dataset) {
+// The caller must keep cache from changing, and hold the lock of the datasets being written
+static void rx_init_dataset(randomx_dataset** datasets, randomx_cache* cache, size_t max_threads) {
+  if (!datasets[0]) {
     return;
   }
 
-  // leave 2 CPU cores for other tasks
-  const size_t num_threads = (max_threads < 4) ? 1 : (max_threads - 2);
+  // leave 2 CPU cores for other tasks, and split the rest evenly across the NUMA nodes
+  const size_t num_nodes = numa_node_count();
+  const size_t max_init_threads = (max_threads < 4) ? 1 : (max_threads - 2);
+  const size_t node_threads = (max_init_threads < num_nodes) ? 1 : (max_init_threads / num_nodes);
+  const size_t num_threads = node_threads * num_nodes;
   seedinfo* si = malloc(num_threads * sizeof(seedinfo));
   if (!si) local_abort("Couldn't allocate RandomX mining threadinfo");
 
-  const uint32_t delta = randomx_dataset_item_count() / num_threads;
-  uint32_t start = 0;
-
-  const size_t n1 = num_threads - 1;
-  for (size_t i = 0; i < n1; ++i) {
-    si[i].si_cache = main_cache;
-    si[i].si_start = start;
-    si[i].si_count = delta;
-    start += delta;
+  const uint32_t delta = randomx_dataset_item_count() / node_threads;
+  for (size_t node = 0; node < num_nodes; ++node) {
+    uint32_t start = 0;
+    for (size_t i = 0; i < node_threads; ++i) {
+      seedinfo *nsi = &si[node * node_threads + i];
+      nsi->si_cache = cache;
+      nsi->si_dataset = datasets[node];
+      nsi->si_node = (num_nodes > 1) ? (int)node : -1;
+      nsi->si_start = start;
+      nsi->si_count = (i + 1 < node_threads) ? delta : (randomx_dataset_item_count() - start);
+      start += delta;
+    }
   }
 
-  si[n1].si_cache = main_cache;
-  si[n1].si_start = start;
-  si[n1].si_count = randomx_dataset_item_count() - start;
-
   CTHR_THREAD_TYPE *st = malloc(num_threads * sizeof(CTHR_THREAD_TYPE));
   if (!st) local_abort("Couldn't allocate RandomX mining threadlist");
 
-  CTHR_RWLOCK_LOCK_READ(main_cache_lock);
+  // With several nodes every slice runs on a thread bound to its node, so each dataset is
+  // first touched, and thus placed, on its own node. Otherwise this thread does the last slice.
+  const size_t n1 = (num_nodes > 1) ? num_threads : (num_threads - 1);
   for (size_t i = 0; i < n1; ++i) {
     if (!CTHR_THREAD_CREATE(st[i], rx_seedthread, &si[i])) {
       local_abort("Couldn't start RandomX seed thread");
     }
   }
-  randomx_init_dataset(main_dataset, si[n1].si_cache, si[n1].si_start, si[n1].si_count);
+  if (n1 < num_threads) {
+    randomx_init_dataset(si[n1].si_dataset, si[n1].si_cache, si[n1].si_start, si[n1].si_count);
+  }
   for (size_t i = 0; i < n1; ++i) CTHR_THREAD_JOIN(st[i]);
-  CTHR_RWLOCK_UNLOCK_READ(main_cache_lock);
 
   free(st);
   free(si);
 
-  minfo(RX_LOGCAT, "RandomX dataset initialized");
+  if (num_nodes > 1) {
+    minfo(RX_LOGCAT, "RandomX datasets initialized on %zu NUMA nodes", num_nodes);
+  } else {
+    minfo(RX_LOGCAT, "RandomX dataset initialized");
+  }
 }
 
 typedef struct thread_info {
@@ -350,6 +552,12 @@ typedef struct thread_info {
 static CTHR_THREAD_RTYPE rx_set_main_seedhash_thread(void *arg) {
   thread_info* info = arg;
 
+  // If the new seed is the one being built ahead, wait for it rather than building it a second time
+  const int wait_next = is_next(info->seedhash);
+  if (wait_next) {
+    CTHR_RWLOCK_LOCK_WRITE(next_lock);
+  }
+
   CTHR_RWLOCK_LOCK_WRITE(main_dataset_lock);
   CTHR_RWLOCK_LOCK_WRITE(main_cache_lock);
 
@@ -357,6 +565,9 @@ static CTHR_THREAD_RTYPE rx_set_main_seedhash_thread(void *arg) {
   if (is_main(info->seedhash)) {
     CTHR_RWLOCK_UNLOCK_WRITE(main_cache_lock);
     CTHR_RWLOCK_UNLOCK_WRITE(main_dataset_lock);
+    if (wait_next) {
+      CTHR_RWLOCK_UNLOCK_WRITE(next_lock);
+    }
     free(info);
     CTHR_THREAD_RETURN;
   }
@@ -367,17 +578,47 @@ static CTHR_THREAD_RTYPE rx_set_main_seedhash_thread(void *arg) {
   hash2hex(main_seedhash, buf);
   minfo(RX_LOGCAT, "RandomX new main seed hash is %s", buf);
 
+  // Swap in what was built ahead, the old main cache and datasets are reused for the epoch after
+  int have_cache = 0, have_datasets = 0;
+  if (wait_next) {
+    if (is_next(info->seedhash) && next_cache_ready) {
+      randomx_cache *cache = main_cache;
+      main_cache = next_cache;
+      next_cache = cache;
+      have_cache = 1;
+      if (next_datasets_ready) {
+        for (size_t node = 0; node < RX_MAX_NUMA_NODES; ++node) {
+          randomx_dataset *dataset = main_datasets[node];
+          main_datasets[node] = next_datasets[node];
+          next_datasets[node] = dataset;
+        }
+        have_datasets = 1;
+      }
+      next_seedhash_set = 0;
+      next_cache_ready = 0;
+      next_datasets_ready = 0;
+      minfo(RX_LOGCAT, "RandomX switched to the precomputed %s", have_datasets ? "cache and dataset" : "cache");
+    }
+    CTHR_RWLOCK_UNLOCK_WRITE(next_lock);
+  }
+
   const randomx_flags flags = enabled_flags() & ~disabled_flags();
-  rx_alloc_dataset(flags, &main_dataset, 0);
+  rx_alloc_datasets(flags, main_datasets, 0);
   rx_alloc_cache(flags, &main_cache);
 
-  randomx_init_cache(main_cache, info->seedhash, HASH_SIZE);
-  minfo(RX_LOGCAT, "RandomX main cache initialized");
+  if (!have_cache) {
+    randomx_init_cache(main_cache, info->seedhash, HASH_SIZE);
+    minfo(RX_LOGCAT, "RandomX main cache initialized");
+  }
 
   CTHR_RWLOCK_UNLOCK_WRITE(main_cache_lock);
 
   // From this point, rx_slow_hash can calculate hashes in light mode, but dataset is not initialized yet
-  rx_init_dataset(info->max_threads);
+  if (!have_datasets) {
+    CTHR_RWLOCK_LOCK_READ(main_cache_lock);
+    rx_init_dataset(main_datasets, main_cache, info->max_threads);
+    CTHR_RWLOCK_UNLOCK_READ(main_cache_lock);
+  }
 
   CTHR_RWLOCK_UNLOCK_WRITE(main_dataset_lock);
 
@@ -405,6 +646,131 @@ void rx_set_main_seedhash(const char *seedhash, size_t max_dataset_init_threads)
   CTHR_THREAD_CLOSE(t);
 }
 
+static CTHR_THREAD_RTYPE rx_set_next_seedhash_thread(void *arg) {
+  thread_info* info = arg;
+
+  CTHR_RWLOCK_LOCK_WRITE(next_lock);
+
+  // Double check that this seed isn't built already, or already in use
+  if (is_next(info->seedhash) || is_main(info->seedhash)) {
+    CTHR_RWLOCK_UNLOCK_WRITE(next_lock);
+    free(info);
+    CTHR_THREAD_RETURN;
+  }
+  memcpy(next_seedhash, info->seedhash, HASH_SIZE);
+  next_seedhash_set = 1;
+  next_cache_ready = 0;
+  next_datasets_ready = 0;
+
+  char buf[HASH_SIZE * 2 + 1];
+  hash2hex(next_seedhash, buf);
+  minfo(RX_LOGCAT, "RandomX building ahead for next seed hash %s", buf);
+
+  const randomx_flags flags = enabled_flags() & ~disabled_flags();
+  rx_alloc_cache(flags, &next_cache);
+  randomx_init_cache(next_cache, info->seedhash, HASH_SIZE);
+  next_cache_ready = 1;
+
+  // Only worth it when the main seed uses a dataset too, it is swapped in as a whole
+  if (next_epoch_mode() == RX_NEXT_EPOCH_DATASET && main_datasets[0]) {
+    rx_alloc_datasets(flags, next_datasets, 1);
+    if (next_datasets[0]) {
+      rx_init_dataset(next_datasets, next_cache, info->max_threads);
+      next_datasets_ready = 1;
+    }
+  }
+  minfo(RX_LOGCAT, "RandomX next %s ready", next_datasets_ready ? "cache and dataset" : "cache");
+
+  CTHR_RWLOCK_UNLOCK_WRITE(next_lock);
+
+  free(info);
+  CTHR_THREAD_RETURN;
+}
+
+void rx_set_next_seedhash(const char *seedhash, size_t max_dataset_init_threads) {
+  // Early out if disabled, or this seed is already built or in use
+  if (next_epoch_mode() == RX_NEXT_EPOCH_NONE || is_next(seedhash) || is_main(seedhash)) {
+    return;
+  }
+
+  // Build the next cache and dataset in the background
+  thread_info* info = malloc(sizeof(thread_info));
+  if (!info) local_abort("Couldn't allocate RandomX mining threadinfo");
+
+  memcpy(info->seedhash, seedhash, HASH_SIZE);
+  info->max_threads = max_dataset_init_threads;
+
+  CTHR_THREAD_TYPE t;
+  if (!CTHR_THREAD_CREATE(t, rx_set_next_seedhash_thread, info)) {
+    local_abort("Couldn't start RandomX seed thread");
+  }
+  CTHR_THREAD_CLOSE(t);
+}
+
+// Hashes with the pooled light cache for seedhash, returns 0 if there is none
+static int rx_light_cache_hash(randomx_flags flags, const char *seedhash, const void *data, size_t length, char *result_hash) {
+  const size_t count = light_cache_count();
+  for (size_t i = 0; i < count; ++i) {
+    light_cache *lc = &light_caches[i];
+    if (!is_light(lc, seedhash)) {
+      continue;
+    }
+
+    int success = 0;
+    CTHR_RWLOCK_LOCK_READ(lc->lock);
+    // Double check that the slot wasn't reassigned
+    if (is_light(lc, seedhash)) {
+      lc->last_used = ++light_caches_clock;
+      // one VM per slot and thread, so alternating seeds doesn't recompile the VM for each hash
+      rx_init_light_vm(flags, &light_vms[i], lc->cache);
+      randomx_calculate_hash(light_vms[i], data, length, result_hash);
+      success = 1;
+    }
+    CTHR_RWLOCK_UNLOCK_READ(lc->lock);
+
+    if (success) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Initializes a light cache for seedhash in an empty or the least recently used slot
+static void rx_light_cache_add(randomx_flags flags, const char *seedhash) {
+  CTHR_RWLOCK_LOCK_WRITE(light_caches_lock);
+
+  const size_t count = light_cache_count();
+  size_t victim = 0;
+  for (size_t i = 0; i < count; ++i) {
+    // Double check that another thread didn't add it meanwhile
+    if (is_light(&light_caches[i], seedhash)) {
+      CTHR_RWLOCK_UNLOCK_WRITE(light_caches_lock);
+      return;
+    }
+    if (light_caches[victim].seedhash_set && (!light_caches[i].seedhash_set || light_caches[i].last_used < light_caches[victim].last_used)) {
+      victim = i;
+    }
+  }
+
+  // Readers of the slot wait on its lock until the new cache is ready, other slots stay usable
+  light_cache *lc = &light_caches[victim];
+  CTHR_RWLOCK_LOCK_WRITE(lc->lock);
+  memcpy(lc->seedhash, seedhash, HASH_SIZE);
+  lc->seedhash_set = 1;
+  lc->last_used = ++light_caches_clock;
+  CTHR_RWLOCK_UNLOCK_WRITE(light_caches_lock);
+
+  char buf[HASH_SIZE * 2 + 1];
+  hash2hex(seedhash, buf);
+  minfo(RX_LOGCAT, "RandomX new light cache %zu seed hash is %s", victim, buf);
+
+  rx_alloc_cache(flags, &lc->cache);
+  randomx_init_cache(lc->cache, seedhash, HASH_SIZE);
+  minfo(RX_LOGCAT, "RandomX light cache %zu updated", victim);
+
+  CTHR_RWLOCK_UNLOCK_WRITE(lc->lock);
+}
+
 void rx_slow_hash(const char *seedhash, const void *data, size_t length, char *result_hash) {
   const randomx_flags flags = enabled_flags() & ~disabled_flags();
   int success = 0;
@@ -413,7 +779,7 @@ void rx_slow_hash(const char *seedhash, const void *data, size_t length, char *r
   // Multiple threads can run in parallel in fast or light mode, 1-2 ms or 10-15 ms per hash per thread
   if (is_main(seedhash)) {
     // If CTHR_RWLOCK_TRYLOCK_READ fails it means dataset is being initialized now, so use the light mode
-    if (main_dataset && CTHR_RWLOCK_TRYLOCK_READ(main_dataset_lock)) {
+    if (main_datasets[0] && CTHR_RWLOCK_TRYLOCK_READ(main_dataset_lock)) {
       // Double check that main_seedhash didn't change
       if (is_main(seedhash)) {
         rx_init_full_vm(flags, &main_vm_full);
@@ -439,67 +805,120 @@ void rx_slow_hash(const char *seedhash, const void *data, size_t length, char *r
     return;
   }
 
-  char buf[HASH_SIZE * 2 + 1];
+  // Slow path (seedhash != main_seedhash), light mode with the pooled cache of this seed.
+  // Threads hashing different seeds run in parallel, 10-15 ms per hash per thread. A seed
+  // without a cache yet evicts the least recently used one, up to 200-500 ms per hash.
+  while (!rx_light_cache_hash(flags, seedhash, data, length, result_hash)) {
+    rx_light_cache_add(flags, seedhash);
+  }
+}
 
-  // Slow path (seedhash != main_seedhash, but seedhash == secondary_seedhash)
-  // Multiple threads can run in parallel in light mode, 10-15 ms per hash per thread
-  if (!secondary_cache) {
-    CTHR_RWLOCK_LOCK_WRITE(secondary_cache_lock);
-    if (!secondary_cache) {
-      hash2hex(seedhash, buf);
-      minfo(RX_LOGCAT, "RandomX new secondary seed hash is %s", buf);
-
-      rx_alloc_cache(flags, &secondary_cache);
-      randomx_init_cache(secondary_cache, seedhash, HASH_SIZE);
-      minfo(RX_LOGCAT, "RandomX secondary cache updated");
-      memcpy(secondary_seedhash, seedhash, HASH_SIZE);
-      secondary_seedhash_set = 1;
+static void rx_set_nonce(char *data, size_t nonce_offset, uint32_t nonce) {
+  data[nonce_offset + 0] = (char)(nonce & 0xff);
+  data[nonce_offset + 1] = (char)((nonce >> 8) & 0xff);
+  data[nonce_offset + 2] = (char)((nonce >> 16) & 0xff);
+  data[nonce_offset + 3] = (char)((nonce >> 24) & 0xff);
+}
+
+// Hashes count nonces with one VM, overlapping the scratchpad fill of each hash with the end of the previous one
+static size_t rx_hash_pipeline_vm(randomx_vm *vm, char *data, size_t length, size_t nonce_offset, uint32_t nonce, uint32_t nonce_step, size_t count, rx_hash_callback_t callback, void *arg) {
+  char hash[HASH_SIZE];
+  size_t done = 0;
+
+  rx_set_nonce(data, nonce_offset, nonce);
+  randomx_calculate_hash_first(vm, data, length);
+  while (done + 1 < count) {
+    const uint32_t next_nonce = nonce + nonce_step;
+    rx_set_nonce(data, nonce_offset, next_nonce);
+    randomx_calculate_hash_next(vm, data, length, hash);
+    ++done;
+    if (callback(nonce, hash, arg)) {
+      // the next hash was started, but the VM is reinitialized by the next first/full hash
+      return done;
     }
-    CTHR_RWLOCK_UNLOCK_WRITE(secondary_cache_lock);
+    nonce = next_nonce;
   }
+  randomx_calculate_hash_last(vm, hash);
+  ++done;
+  callback(nonce, hash, arg);
+  return done;
+}
+
+// Hashes count nonces (nonce, nonce + nonce_step, ...) written little endian at nonce_offset in data,
+// calling callback for each hash in order until it returns non zero. Returns the number of hashes done.
+// The read locks are held for the whole batch, so keep count small enough not to delay a seed change.
+size_t rx_slow_hash_pipeline(const char *seedhash, void *data, size_t length, size_t nonce_offset, uint32_t nonce, uint32_t nonce_step, size_t count, rx_hash_callback_t callback, void *arg) {
+  const randomx_flags flags = enabled_flags() & ~disabled_flags();
+  char *blob = (char*)data;
+  size_t done = 0;
+  int success = 0;
 
-  CTHR_RWLOCK_LOCK_READ(secondary_cache_lock);
-  if (is_secondary(seedhash)) {
-    rx_init_light_vm(flags, &secondary_vm_light, secondary_cache);
-    randomx_calculate_hash(secondary_vm_light, data, length, result_hash);
-    success = 1;
+  if (!count || nonce_offset + sizeof(uint32_t) > length) {
+    return 0;
   }
-  CTHR_RWLOCK_UNLOCK_READ(secondary_cache_lock);
 
-  if (success) {
-    return;
+  // Same VM selection as rx_slow_hash, but a whole batch is hashed per lock
+  if (is_main(seedhash)) {
+    if (main_datasets[0] && CTHR_RWLOCK_TRYLOCK_READ(main_dataset_lock)) {
+      if (is_main(seedhash)) {
+        rx_init_full_vm(flags, &main_vm_full);
+        if (main_vm_full) {
+          done = rx_hash_pipeline_vm(main_vm_full, blob, length, nonce_offset, nonce, nonce_step, count, callback, arg);
+          success = 1;
+        }
+      }
+      CTHR_RWLOCK_UNLOCK_READ(main_dataset_lock);
+    } else {
+      CTHR_RWLOCK_LOCK_READ(main_cache_lock);
+      if (is_main(seedhash)) {
+        rx_init_light_vm(flags, &main_vm_light, main_cache);
+        done = rx_hash_pipeline_vm(main_vm_light, blob, length, nonce_offset, nonce, nonce_step, count, callback, arg);
+        success = 1;
+      }
+      CTHR_RWLOCK_UNLOCK_READ(main_cache_lock);
+    }
   }
 
-  // Slowest path (seedhash != main_seedhash, seedhash != secondary_seedhash)
-  // Only one thread runs at a time and updates secondary_seedhash if needed, up to 200-500 ms per hash
-  CTHR_RWLOCK_LOCK_WRITE(secondary_cache_lock);
-  if (!is_secondary(seedhash)) {
-    hash2hex(seedhash, buf);
-    minfo(RX_LOGCAT, "RandomX new secondary seed hash is %s", buf);
+  if (success) {
+    return done;
+  }
 
-    randomx_init_cache(secondary_cache, seedhash, HASH_SIZE);
-    minfo(RX_LOGCAT, "RandomX secondary cache updated");
-    memcpy(secondary_seedhash, seedhash, HASH_SIZE);
-    secondary_seedhash_set = 1;
+  // Not the main seed: hash one at a time, rx_slow_hash takes care of the light cache pool
+  while (done < count) {
+    char hash[HASH_SIZE];
+    rx_set_nonce(blob, nonce_offset, nonce);
+    rx_slow_hash(seedhash, blob, length, hash);
+    ++done;
+    if (callback(nonce, hash, arg)) {
+      break;
+    }
+    nonce += nonce_step;
   }
-  rx_init_light_vm(flags, &secondary_vm_light, secondary_cache);
-  randomx_calculate_hash(secondary_vm_light, data, length, result_hash);
-  CTHR_RWLOCK_UNLOCK_WRITE(secondary_cache_lock);
+  return done;
 }
 
 void rx_set_miner_thread(uint32_t value, size_t max_dataset_init_threads) {
   miner_thread = value;
 
+  // Spread miner threads over the NUMA nodes, each reading only its node's dataset
+  const size_t num_nodes = numa_node_count();
+  if (num_nodes > 1) {
+    numa_node = value % num_nodes;
+    bind_numa_node((int)numa_node);
+  }
+
   // If dataset is not allocated yet, try to allocate and initialize it
   CTHR_RWLOCK_LOCK_WRITE(main_dataset_lock);
-  if (main_dataset) {
+  if (main_datasets[0]) {
     CTHR_RWLOCK_UNLOCK_WRITE(main_dataset_lock);
     return;
   }
 
   const randomx_flags flags = enabled_flags() & ~disabled_flags();
-  rx_alloc_dataset(flags, &main_dataset, 1);
-  rx_init_dataset(max_dataset_init_threads);
+  rx_alloc_datasets(flags, main_datasets, 1);
+  CTHR_RWLOCK_LOCK_READ(main_cache_lock);
+  rx_init_dataset(main_datasets, main_cache, max_dataset_init_threads);
+  CTHR_RWLOCK_UNLOCK_READ(main_cache_lock);
 
   CTHR_RWLOCK_UNLOCK_WRITE(main_dataset_lock);
 }
@@ -519,6 +938,9 @@ static void rx_destroy_vm(randomx_vm** vm) {
 
 void rx_slow_hash_free_state() {
   rx_destroy_vm(&main_vm_full);
+  main_vm_full_dataset = NULL;
   rx_destroy_vm(&main_vm_light);
-  rx_destroy_vm(&secondary_vm_light);
+  for (size_t i = 0; i < RX_MAX_LIGHT_CACHES; ++i) {
+    rx_destroy_vm(&light_vms[i]);
+  }
 }
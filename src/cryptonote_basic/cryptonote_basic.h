@@ -490,10 +490,12 @@ namespace cryptonote
     std::vector<crypto::hash> tx_hashes;
 
     // Quantum-safe signatures - MANDATORY for QSF
+    // Stored inline with the consensus sizes as capacity, so copying or
+    // parsing a block does not allocate for them; serialized like vectors
     struct quantum_signature_data {
-      std::vector<uint8_t> xmss_signature;
-      std::vector<uint8_t> sphincs_signature;
-      std::vector<uint8_t> dual_public_key;
+      boost::container::static_vector<uint8_t, QSF_XMSS_SIGNATURE_SIZE> xmss_signature;
+      boost::container::static_vector<uint8_t, QSF_SPHINCS_SIGNATURE_SIZE> sphincs_signature;
+      boost::container::static_vector<uint8_t, QSF_QUANTUM_KEY_SIZE> dual_public_key;
       
       BEGIN_SERIALIZE_OBJECT()
         FIELD(xmss_signature)
@@ -1460,6 +1460,13 @@ namespace cryptonote
     return blob;
   }
   //---------------------------------------------------------------
+  size_t get_block_hashing_blob_nonce_offset(const block& b)
+  {
+    // the nonce is the last field of the header, which starts the hashing blob
+    return tools::get_varint_data(b.major_version).size() + tools::get_varint_data(b.minor_version).size()
+        + tools::get_varint_data(b.timestamp).size() + sizeof(b.prev_id);
+  }
+  //---------------------------------------------------------------
   bool calculate_block_hash(const block& b, crypto::hash& res, const blobdata_ref *blob)
   {
     blobdata bd;
@@ -1551,14 +1558,8 @@ namespace cryptonote
     return res;
   }
   //---------------------------------------------------------------
-  bool parse_and_validate_block_from_blob(const blobdata_ref& b_blob, block& b, crypto::hash *block_hash)
+  static bool check_block_quantum_signatures(const block& b)
   {
-    binary_archive<false> ba{epee::strspan<std::uint8_t>(b_blob)};
-    bool r = ::serialization::serialize(ba, b);
-    CHECK_AND_ASSERT_MES(r, false, "Failed to parse block from blob");
-    b.invalidate_hashes();
-    b.miner_tx.invalidate_hashes();
-    
     // ALWAYS validate quantum-safe signatures - no option to disable
     if (b.quantum_signatures.xmss_signature.empty() || b.quantum_signatures.sphincs_signature.empty()) {
       LOG_ERROR("Block validation failed: Missing quantum-safe signatures (XMSS or SPHINCS+) - REJECTING BLOCK");
@@ -1581,6 +1582,21 @@ namespace cryptonote
     LOG_PRINT_L2("Block quantum-safe signatures validated: XMSS=" << b.quantum_signatures.xmss_signature.size() 
                   << " bytes, SPHINCS=" << b.quantum_signatures.sphincs_signature.size() 
                   << " bytes, PublicKey=" << b.quantum_signatures.dual_public_key.size() << " bytes");
+    return true;
+  }
+  //---------------------------------------------------------------
+  static bool parse_and_validate_block_from_blob_impl(const blobdata_ref& b_blob, block& b, crypto::hash *block_hash, bool allow_stripped)
+  {
+    binary_archive<false> ba{epee::strspan<std::uint8_t>(b_blob)};
+    bool r = ::serialization::serialize(ba, b);
+    CHECK_AND_ASSERT_MES(r, false, "Failed to parse block from blob");
+    b.invalidate_hashes();
+    b.miner_tx.invalidate_hashes();
+    
+    const bool stripped = allow_stripped && b.quantum_signatures.xmss_signature.empty()
+        && b.quantum_signatures.sphincs_signature.empty() && b.quantum_signatures.dual_public_key.empty();
+    if (!stripped && !check_block_quantum_signatures(b))
+      return false;
     
     if (block_hash)
     {
@@ -1591,6 +1607,11 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------
+  bool parse_and_validate_block_from_blob(const blobdata_ref& b_blob, block& b, crypto::hash *block_hash)
+  {
+    return parse_and_validate_block_from_blob_impl(b_blob, b, block_hash, false);
+  }
+  //---------------------------------------------------------------
   bool parse_and_validate_block_from_blob(const blobdata_ref& b_blob, block& b)
   {
     return parse_and_validate_block_from_blob(b_blob, b, NULL);
@@ -1601,6 +1622,42 @@ namespace cryptonote
     return parse_and_validate_block_from_blob(b_blob, b, &block_hash);
   }
   //---------------------------------------------------------------
+  bool parse_and_validate_block_from_stripped_blob(const blobdata_ref& b_blob, block& b, crypto::hash *block_hash)
+  {
+    return parse_and_validate_block_from_blob_impl(b_blob, b, block_hash, true);
+  }
+  //---------------------------------------------------------------
+  static const blobdata &get_empty_quantum_signatures_blob()
+  {
+    static const blobdata empty_blob = t_serializable_object_to_blob(block::quantum_signature_data());
+    return empty_blob;
+  }
+  //---------------------------------------------------------------
+  bool split_block_quantum_signatures(const blobdata_ref& b_blob, const block& b, blobdata& stripped_blob, blobdata& quantum_signatures_blob)
+  {
+    // the signatures are the last field of a block
+    quantum_signatures_blob = t_serializable_object_to_blob(b.quantum_signatures);
+    const size_t qs_size = quantum_signatures_blob.size();
+    CHECK_AND_ASSERT_MES(b_blob.size() >= qs_size && b_blob.substr(b_blob.size() - qs_size) == quantum_signatures_blob, false,
+        "Block blob does not end with its quantum signatures");
+    const blobdata &empty_blob = get_empty_quantum_signatures_blob();
+    stripped_blob.reserve(b_blob.size() - qs_size + empty_blob.size());
+    stripped_blob.assign(b_blob.data(), b_blob.size() - qs_size);
+    stripped_blob.append(empty_blob);
+    return true;
+  }
+  //---------------------------------------------------------------
+  bool join_block_quantum_signatures(const blobdata_ref& stripped_blob, const blobdata_ref& quantum_signatures_blob, blobdata& b_blob)
+  {
+    const blobdata &empty_blob = get_empty_quantum_signatures_blob();
+    CHECK_AND_ASSERT_MES(stripped_blob.size() >= empty_blob.size() && stripped_blob.substr(stripped_blob.size() - empty_blob.size()) == empty_blob, false,
+        "Stripped block blob does not end with empty quantum signatures");
+    b_blob.reserve(stripped_blob.size() - empty_blob.size() + quantum_signatures_blob.size());
+    b_blob.assign(stripped_blob.data(), stripped_blob.size() - empty_blob.size());
+    b_blob.append(quantum_signatures_blob.data(), quantum_signatures_blob.size());
+    return true;
+  }
+  //---------------------------------------------------------------
   blobdata block_to_blob(const block& b)
   {
     return t_serializable_object_to_blob(b);
@@ -121,12 +121,18 @@ namespace cryptonote
   crypto::hash get_pruned_transaction_hash(const transaction& t, const crypto::hash &pruned_data_hash);
 
   blobdata get_block_hashing_blob(const block& b);
+  size_t get_block_hashing_blob_nonce_offset(const block& b);
   bool calculate_block_hash(const block& b, crypto::hash& res, const blobdata_ref *blob = NULL);
   bool get_block_hash(const block& b, crypto::hash& res);
   crypto::hash get_block_hash(const block& b);
   bool parse_and_validate_block_from_blob(const blobdata_ref& b_blob, block& b, crypto::hash *block_hash);
   bool parse_and_validate_block_from_blob(const blobdata_ref& b_blob, block& b);
   bool parse_and_validate_block_from_blob(const blobdata_ref& b_blob, block& b, crypto::hash &block_hash);
+  // Stripped block blobs carry empty quantum signature fields, and are otherwise
+  // identical to the full blob (the block id does not cover the signatures)
+  bool parse_and_validate_block_from_stripped_blob(const blobdata_ref& b_blob, block& b, crypto::hash *block_hash = NULL);
+  bool split_block_quantum_signatures(const blobdata_ref& b_blob, const block& b, blobdata& stripped_blob, blobdata& quantum_signatures_blob);
+  bool join_block_quantum_signatures(const blobdata_ref& stripped_blob, const blobdata_ref& quantum_signatures_blob, blobdata& b_blob);
   bool get_inputs_money_amount(const transaction& tx, uint64_t& money);
   uint64_t get_outs_money_amount(const transaction& tx);
   bool get_output_public_key(const cryptonote::tx_out& out, crypto::public_key& output_public_key);
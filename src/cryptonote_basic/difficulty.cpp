@@ -250,68 +250,20 @@ namespace cryptonote {
   //  LWMA3 (RandomX) difficulty with diagnostics
   // ==========================================================
 
-  difficulty_type next_difficulty_lwma(std::vector<uint64_t> timestamps,
-                                       std::vector<difficulty_type> cumulative_difficulties,
-                                       size_t target_seconds,
-                                       bool enable_hf18_features,
-                                       size_t lwma_window,
-                                       uint64_t height,
-                                       uint8_t nettype)
+  // Tail of LWMA3, shared by next_difficulty_lwma and difficulty_window so both give the same
+  // result: n solvetimes, their clamped weighted sum, the work over them, the work of the last
+  // block, and the total/count of the positive unclamped solvetimes for the safety valve.
+  static difficulty_type next_difficulty_lwma_from_sums(size_t n,
+                                                        int64_t sum_weighted_solve,
+                                                        const difficulty_type &sum_diff,
+                                                        const difficulty_type &prev_diff,
+                                                        uint64_t total_time,
+                                                        uint64_t block_count,
+                                                        size_t target_seconds,
+                                                        bool enable_hf18_features,
+                                                        uint64_t height,
+                                                        uint8_t nettype)
   {
-    // LWMA3 requires CHRONOLOGICAL order (block order).
-    // Verify timestamps are monotonically non-decreasing.
-    for (size_t i = 1; i < timestamps.size(); ++i)
-    {
-      if (timestamps[i] < timestamps[i - 1])
-      {
-        return 1; // fail safe
-      }
-    }
-
-    // Window size: Use provided window if given, otherwise use default
-    // Before HF18: always 90 (mainnet default)
-    // After HF18: 30 for testnet, 90 for mainnet/stagenet (passed from call site)
-    const size_t N = (lwma_window > 0) ? lwma_window : ::config::POW_LWMA_WINDOW;
-
-    if (timestamps.size() <= 1 || cumulative_difficulties.size() <= 1)
-    {
-      return 1;
-    }
-
-    // Use at most N last blocks (or fewer if height < N)
-    const size_t n = std::min(N, timestamps.size() - 1);
-    if (n < 2)
-    {
-      return 1;
-    }
-
-    const size_t start_idx = timestamps.size() - (n + 1);
-
-    int64_t       sum_weighted_solve = 0;
-    difficulty_type sum_diff         = 0;
-
-    const int64_t min_solve = 1;
-    const int64_t max_solve = (int64_t)target_seconds * 6;
-
-    for (size_t i = 1; i <= n; ++i)
-    {
-      const size_t idx  = start_idx + i;
-      const size_t prev = start_idx + i - 1;
-
-      int64_t solvetime =
-        (int64_t)timestamps[idx] - (int64_t)timestamps[prev];
-
-      if (solvetime < min_solve) solvetime = min_solve;
-      if (solvetime > max_solve) solvetime = max_solve;
-
-      sum_weighted_solve += solvetime * (int64_t)i;
-
-      const difficulty_type block_diff =
-        cumulative_difficulties[idx] - cumulative_difficulties[prev];
-
-      sum_diff += block_diff;
-    }
-
     if (sum_weighted_solve <= 0)
     {
       sum_weighted_solve =
@@ -341,10 +293,8 @@ namespace cryptonote {
     // This protects low-hashrate testnets & small mainnets from stalls
     // when a high-hash miner briefly joins, then leaves.
     //
-    if (enable_hf18_features && !cumulative_difficulties.empty() && cumulative_difficulties.size() >= 2)
+    if (enable_hf18_features)
     {
-      difficulty_type prev_diff =
-          cumulative_difficulties.back() - cumulative_difficulties[cumulative_difficulties.size() - 2];
       if (prev_diff > 0)
       {
         difficulty_type min_allowed = prev_diff / 3;  // Allow difficulty to fall by 3×
@@ -362,7 +312,7 @@ namespace cryptonote {
     // (indicating the chain is stuck), automatically reduce difficulty.
     // This only applies after the rescue height (31,671) on mainnet.
     //
-    if (nettype == 0 && height > 0 && height >= ::config::DIFFICULTY_RESCUE_HEIGHT && timestamps.size() >= 2)
+    if (nettype == 0 && height > 0 && height >= ::config::DIFFICULTY_RESCUE_HEIGHT)
     {
       const uint64_t rescue_height = ::config::DIFFICULTY_RESCUE_HEIGHT;
       const uint64_t stuck_time_threshold = ::config::DIFFICULTY_SAFETY_VALVE_STUCK_TIME;
@@ -370,28 +320,6 @@ namespace cryptonote {
 
       if (rescue_height > 0 && height >= rescue_height)
       {
-        // Calculate average solve time over the last N blocks in the window
-        // If average is much longer than target, the chain is likely stuck
-        uint64_t total_time = 0;
-        uint64_t block_count = 0;
-        
-        // Use the same window size as LWMA calculation (n and start_idx are already calculated above)
-        const size_t check_window = std::min(n, timestamps.size() - 1);
-        for (size_t i = 1; i <= check_window; ++i)
-        {
-          const size_t idx = start_idx + i;
-          const size_t prev = start_idx + i - 1;
-          if (idx < timestamps.size() && prev < timestamps.size())
-          {
-            int64_t solvetime = (int64_t)timestamps[idx] - (int64_t)timestamps[prev];
-            if (solvetime > 0)
-            {
-              total_time += solvetime;
-              block_count++;
-            }
-          }
-        }
-        
         if (block_count > 0)
         {
           uint64_t avg_solve_time = total_time / block_count;
@@ -423,6 +351,214 @@ namespace cryptonote {
     return result == 0 ? 1 : result;
   }
 
+  difficulty_type next_difficulty_lwma(const std::vector<uint64_t> &timestamps,
+                                       const std::vector<difficulty_type> &cumulative_difficulties,
+                                       size_t target_seconds,
+                                       bool enable_hf18_features,
+                                       size_t lwma_window,
+                                       uint64_t height,
+                                       uint8_t nettype)
+  {
+    // LWMA3 requires CHRONOLOGICAL order (block order).
+    // Verify timestamps are monotonically non-decreasing.
+    for (size_t i = 1; i < timestamps.size(); ++i)
+    {
+      if (timestamps[i] < timestamps[i - 1])
+      {
+        return 1; // fail safe
+      }
+    }
+
+    // Window size: Use provided window if given, otherwise use default
+    // Before HF18: always 90 (mainnet default)
+    // After HF18: 30 for testnet, 90 for mainnet/stagenet (passed from call site)
+    const size_t N = (lwma_window > 0) ? lwma_window : ::config::POW_LWMA_WINDOW;
+
+    if (timestamps.size() <= 1 || cumulative_difficulties.size() <= 1)
+    {
+      return 1;
+    }
+
+    // Use at most N last blocks (or fewer if height < N)
+    const size_t n = std::min(N, timestamps.size() - 1);
+    if (n < 2)
+    {
+      return 1;
+    }
+
+    const size_t start_idx = timestamps.size() - (n + 1);
+
+    int64_t       sum_weighted_solve = 0;
+    difficulty_type sum_diff         = 0;
+    uint64_t      total_time         = 0;
+    uint64_t      block_count        = 0;
+
+    const int64_t min_solve = 1;
+    const int64_t max_solve = (int64_t)target_seconds * 6;
+
+    for (size_t i = 1; i <= n; ++i)
+    {
+      const size_t idx  = start_idx + i;
+      const size_t prev = start_idx + i - 1;
+
+      int64_t solvetime =
+        (int64_t)timestamps[idx] - (int64_t)timestamps[prev];
+
+      // the safety valve averages the unclamped solvetimes
+      if (solvetime > 0)
+      {
+        total_time += solvetime;
+        block_count++;
+      }
+
+      if (solvetime < min_solve) solvetime = min_solve;
+      if (solvetime > max_solve) solvetime = max_solve;
+
+      sum_weighted_solve += solvetime * (int64_t)i;
+
+      const difficulty_type block_diff =
+        cumulative_difficulties[idx] - cumulative_difficulties[prev];
+
+      sum_diff += block_diff;
+    }
+
+    const difficulty_type prev_diff =
+        cumulative_difficulties.back() - cumulative_difficulties[cumulative_difficulties.size() - 2];
+
+    return next_difficulty_lwma_from_sums(n, sum_weighted_solve, sum_diff, prev_diff, total_time, block_count,
+                                          target_seconds, enable_hf18_features, height, nettype);
+  }
+
+  difficulty_window::difficulty_window(size_t capacity, size_t target_seconds)
+  {
+    reset(capacity, target_seconds);
+  }
+
+  void difficulty_window::reset(size_t capacity, size_t target_seconds)
+  {
+    m_entries.clear();
+    m_entries.resize(capacity);
+    m_target_seconds = target_seconds;
+    clear();
+  }
+
+  void difficulty_window::clear()
+  {
+    m_begin = 0;
+    m_size = 0;
+    m_next_index = 0;
+  }
+
+  void difficulty_window::push_back(uint64_t timestamp, const difficulty_type &cumulative_difficulty)
+  {
+    if (m_entries.empty())
+      return;
+
+    entry e;
+    e.timestamp = timestamp;
+    e.cumulative_difficulty = cumulative_difficulty;
+    if (m_size == 0)
+    {
+      e.solve_sum = 0;
+      e.weighted_solve_sum = 0;
+      e.positive_solve_sum = 0;
+      e.positive_solves = 0;
+      e.decreasing_timestamps = 0;
+    }
+    else
+    {
+      const entry &prev = at(m_size - 1);
+      int64_t solvetime = (int64_t)timestamp - (int64_t)prev.timestamp;
+      e.positive_solve_sum = prev.positive_solve_sum + (solvetime > 0 ? solvetime : 0);
+      e.positive_solves = prev.positive_solves + (solvetime > 0 ? 1 : 0);
+      e.decreasing_timestamps = prev.decreasing_timestamps + (timestamp < prev.timestamp ? 1 : 0);
+
+      const int64_t max_solve = (int64_t)m_target_seconds * 6;
+      if (solvetime < 1) solvetime = 1;
+      if (solvetime > max_solve) solvetime = max_solve;
+      e.solve_sum = prev.solve_sum + solvetime;
+      e.weighted_solve_sum = prev.weighted_solve_sum + m_next_index * (uint64_t)solvetime;
+    }
+
+    if (m_size == m_entries.size())
+    {
+      m_entries[m_begin] = e;
+      m_begin = (m_begin + 1) % m_entries.size();
+    }
+    else
+    {
+      m_entries[(m_begin + m_size) % m_entries.size()] = e;
+      ++m_size;
+    }
+    ++m_next_index;
+  }
+
+  void difficulty_window::pop_back()
+  {
+    if (m_size == 0)
+      return;
+    --m_size;
+    --m_next_index;
+  }
+
+  void difficulty_window::get(std::vector<uint64_t> &timestamps, std::vector<difficulty_type> &cumulative_difficulties, size_t count) const
+  {
+    count = std::min(count, m_size);
+    timestamps.clear();
+    cumulative_difficulties.clear();
+    timestamps.reserve(count);
+    cumulative_difficulties.reserve(count);
+    for (size_t i = m_size - count; i < m_size; ++i)
+    {
+      const entry &e = at(i);
+      timestamps.push_back(e.timestamp);
+      cumulative_difficulties.push_back(e.cumulative_difficulty);
+    }
+  }
+
+  difficulty_type difficulty_window::next_difficulty_lwma(size_t count,
+                                                          size_t target_seconds,
+                                                          bool enable_hf18_features,
+                                                          size_t lwma_window,
+                                                          uint64_t height,
+                                                          uint8_t nettype) const
+  {
+    count = std::min(count, m_size);
+    if (target_seconds != m_target_seconds)
+    {
+      // the running sums are clamped for another target
+      std::vector<uint64_t> timestamps;
+      std::vector<difficulty_type> cumulative_difficulties;
+      get(timestamps, cumulative_difficulties, count);
+      return cryptonote::next_difficulty_lwma(timestamps, cumulative_difficulties, target_seconds, enable_hf18_features, lwma_window, height, nettype);
+    }
+
+    if (count <= 1)
+      return 1;
+
+    const entry &last = at(m_size - 1);
+    if (last.decreasing_timestamps != at(m_size - count).decreasing_timestamps)
+      return 1; // fail safe, as next_difficulty_lwma
+
+    const size_t N = (lwma_window > 0) ? lwma_window : ::config::POW_LWMA_WINDOW;
+    const size_t n = std::min(N, count - 1);
+    if (n < 2)
+      return 1;
+
+    // solvetime of entry k has weight k - start_index in the window
+    const size_t start = m_size - (n + 1);
+    const entry &first = at(start);
+    const uint64_t start_index = m_next_index - m_size + start;
+    const uint64_t weighted = (last.weighted_solve_sum - first.weighted_solve_sum) - start_index * (last.solve_sum - first.solve_sum);
+
+    return next_difficulty_lwma_from_sums(n, (int64_t)weighted,
+                                          last.cumulative_difficulty - first.cumulative_difficulty,
+                                          last.cumulative_difficulty - at(m_size - 2).cumulative_difficulty,
+                                          last.positive_solve_sum - first.positive_solve_sum,
+                                          last.positive_solves - first.positive_solves,
+                                          target_seconds, enable_hf18_features, height, nettype);
+  }
+
   std::string hex(difficulty_type v)
   {
     static const char chars[] = "0123456789abcdef";
@@ -106,8 +106,8 @@ namespace cryptonote
     // LWMA3 difficulty algorithm
     //
     difficulty_type next_difficulty_lwma(
-        std::vector<uint64_t> timestamps,
-        std::vector<difficulty_type> cumulative_difficulties,
+        const std::vector<uint64_t> &timestamps,
+        const std::vector<difficulty_type> &cumulative_difficulties,
         size_t target_seconds,
         bool enable_hf18_features = false,
         size_t lwma_window = 0,
@@ -115,6 +115,63 @@ namespace cryptonote
         uint8_t nettype = 0  // cryptonote::network_type, but using uint8_t to avoid circular dependency
     );
 
+    //
+    // Fixed capacity ring buffer of block timestamps and cumulative difficulties, oldest first.
+    // Each entry also keeps running sums of the LWMA solvetimes up to it, so LWMA3 over the
+    // last count entries is O(1), and pushing or popping a block does not touch other entries.
+    //
+    class difficulty_window
+    {
+    public:
+        difficulty_window(size_t capacity = 0, size_t target_seconds = 0);
+
+        void reset(size_t capacity, size_t target_seconds);
+        void clear();
+        void push_back(uint64_t timestamp, const difficulty_type &cumulative_difficulty);
+        void pop_back();
+
+        size_t size() const { return m_size; }
+        size_t capacity() const { return m_entries.size(); }
+        bool empty() const { return m_size == 0; }
+        size_t target_seconds() const { return m_target_seconds; }
+        uint64_t timestamp(size_t i) const { return at(i).timestamp; }
+        const difficulty_type &cumulative_difficulty(size_t i) const { return at(i).cumulative_difficulty; }
+
+        // copies the last count entries
+        void get(std::vector<uint64_t> &timestamps, std::vector<difficulty_type> &cumulative_difficulties, size_t count) const;
+
+        // same result as next_difficulty_lwma over the last count entries
+        difficulty_type next_difficulty_lwma(
+            size_t count,
+            size_t target_seconds,
+            bool enable_hf18_features = false,
+            size_t lwma_window = 0,
+            uint64_t height = 0,
+            uint8_t nettype = 0
+        ) const;
+
+    private:
+        struct entry
+        {
+            uint64_t timestamp;
+            difficulty_type cumulative_difficulty;
+            // running sums over the solvetimes up to this entry, wrapping
+            uint64_t solve_sum;             // clamped solvetimes
+            uint64_t weighted_solve_sum;    // clamped solvetimes times their entry index
+            uint64_t positive_solve_sum;    // solvetimes > 0, unclamped
+            uint64_t positive_solves;
+            uint64_t decreasing_timestamps;
+        };
+
+        const entry &at(size_t i) const { return m_entries[(m_begin + i) % m_entries.size()]; }
+
+        std::vector<entry> m_entries;
+        size_t m_begin;
+        size_t m_size;
+        uint64_t m_next_index;
+        size_t m_target_seconds;
+    };
+
     //
     // Hex formatting helper
     //
@@ -103,13 +103,15 @@ namespace cryptonote
   }
 
 
-  miner::miner(i_miner_handler* phandler, const get_block_hash_t &gbh):m_stop(1),
+  miner::miner(i_miner_handler* phandler, const get_block_hash_t &gbh, const get_hashing_blob_hash_t &ghbh):m_stop(1),
     m_template{},
+    m_template_nonce_offset(0),
     m_template_no(0),
     m_diffic(0),
     m_thread_index(0),
     m_phandler(phandler),
     m_gbh(gbh),
+    m_ghbh(ghbh),
     m_height(0),
     m_threads_active(0),
     m_pausers_count(0),
@@ -141,6 +143,13 @@ namespace cryptonote
   {
     CRITICAL_REGION_LOCAL(m_template_lock);
     m_template = bl;
+    if (m_ghbh)
+    {
+      // workers only patch the nonce into this blob, and do not reserialize the block
+      m_template_hashing_blob = get_block_hashing_blob(bl);
+      m_template_nonce_offset = get_block_hashing_blob_nonce_offset(bl);
+      CHECK_AND_ASSERT_MES(m_template_nonce_offset + sizeof(uint32_t) <= m_template_hashing_blob.size(), false, "Invalid nonce offset in block hashing blob");
+    }
     m_diffic = di;
     m_height = height;
     m_block_reward = block_reward;
@@ -532,6 +541,8 @@ namespace cryptonote
     difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
     block b;
+    blobdata hashing_blob;
+    size_t nonce_offset = 0;
     slow_hash_allocate_state();
     ++m_threads_active;
     while(!m_stop)
@@ -559,6 +570,8 @@ namespace cryptonote
       {
         CRITICAL_REGION_BEGIN(m_template_lock);
         b = m_template;
+        hashing_blob = m_template_hashing_blob;
+        nonce_offset = m_template_nonce_offset;
         local_diff = m_diffic;
         height = m_height;
         CRITICAL_REGION_END();
@@ -574,7 +587,8 @@ namespace cryptonote
       }
 
       b.nonce = nonce;
-      crypto::hash h;
+      size_t hashes = 1;
+      bool found = false;
 
       if ((b.major_version >= RX_BLOCK_VERSION) && !rx_set)
       {
@@ -582,9 +596,31 @@ namespace cryptonote
         rx_set = true;
       }
 
-      m_gbh(b, height, NULL, tools::get_max_concurrency(), h);
+      if (m_ghbh)
+      {
+        // hash a batch of this thread's nonces through one VM, checking each hash as it comes out
+        hashes = m_ghbh(hashing_blob, nonce_offset, nonce, m_threads_total, HASHES_PER_BATCH, height, b.major_version, NULL, tools::get_max_concurrency(),
+            [&](uint32_t hashed_nonce, const crypto::hash &h) {
+              if (!check_hash(h, local_diff))
+                return false;
+              b.nonce = hashed_nonce;
+              found = true;
+              return true;
+            });
+        if (!hashes)
+        {
+          LOG_ERROR("Failed to hash block hashing blob, stopping mining");
+          break;
+        }
+      }
+      else
+      {
+        crypto::hash h;
+        m_gbh(b, height, NULL, tools::get_max_concurrency(), h);
+        found = check_hash(h, local_diff);
+      }
 
-      if(check_hash(h, local_diff))
+      if(found)
       {
         //we lucky!
         ++m_config.current_extra_message_index;
@@ -592,7 +628,18 @@ namespace cryptonote
         
         // Add quantum-safe signatures to the found block - MANDATORY for QSF
         #if QSF_BLOCK_QUANTUM_VALIDATION
-        try {
+        if (has_reserved_quantum_signature_slots(b))
+        {
+          // deferred signing: the handler signs the block over its final id
+        }
+        else if (m_quantum_signer)
+        {
+          if (!add_quantum_safe_signatures_to_block(b, *m_quantum_signer)) {
+            LOG_ERROR("Failed to add quantum-safe signatures to found block");
+            continue; // Try next nonce
+          }
+        }
+        else try {
           crypto::quantum_safe_manager qmgr;
           
           // Auto-migrate old keys to new secure format if needed (plug-and-play)
@@ -631,9 +678,9 @@ namespace cryptonote
             epee::serialization::store_t_to_json_file(m_config, m_config_folder_path + "/" + MINER_CONFIG_FILE_NAME);
         }
       }
-      nonce+=m_threads_total;
-      ++m_hashes;
-      ++m_total_hashes;
+      nonce+=m_threads_total * hashes;
+      m_hashes += hashes;
+      m_total_hashes += hashes;
     }
     slow_hash_free_state();
     MGINFO("Miner thread stopped ["<< th_local_index << "]");
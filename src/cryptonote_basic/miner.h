@@ -37,6 +37,7 @@
 #include "verification_context.h"
 #include "difficulty.h"
 #include "math_helper.h"
+#include "crypto/quantum_safe.h"
 #ifdef _WIN32
 #include <windows.h>
 #endif
@@ -53,6 +54,9 @@ namespace cryptonote
   };
 
   typedef std::function<bool(const cryptonote::block&, uint64_t, const crypto::hash*, unsigned int, crypto::hash&)> get_block_hash_t;
+  // hashes a batch of nonces patched into a block hashing blob, calling on_hash(nonce, hash) for each until it returns true:
+  // (blob, nonce offset, first nonce, nonce step, count, height, major version, seed hash, threads, on_hash) -> hashes done
+  typedef std::function<size_t(cryptonote::blobdata&, size_t, uint32_t, uint32_t, size_t, uint64_t, int, const crypto::hash*, unsigned int, const std::function<bool(uint32_t, const crypto::hash&)>&)> get_hashing_blob_hash_t;
 
   /************************************************************************/
   /*                                                                      */
@@ -60,7 +64,7 @@ namespace cryptonote
   class miner
   {
   public: 
-    miner(i_miner_handler* phandler, const get_block_hash_t& gbh);
+    miner(i_miner_handler* phandler, const get_block_hash_t& gbh, const get_hashing_blob_hash_t& ghbh = get_hashing_blob_hash_t());
     ~miner();
     bool init(const boost::program_options::variables_map& vm, network_type nettype);
     static void init_options(boost::program_options::options_description& desc);
@@ -89,6 +93,7 @@ namespace cryptonote
     uint8_t get_mining_target() const;
     bool set_mining_target(uint8_t mining_target);
     uint64_t get_block_reward() const { return m_block_reward; }
+    void set_quantum_signer(const std::shared_ptr<crypto::quantum_safe_signer> &signer) { m_quantum_signer = signer; }
 
     static constexpr uint8_t  BACKGROUND_MINING_DEFAULT_IDLE_THRESHOLD_PERCENTAGE       = 90;
     static constexpr uint8_t  BACKGROUND_MINING_MIN_IDLE_THRESHOLD_PERCENTAGE           = 0;
@@ -100,6 +105,7 @@ namespace cryptonote
     static constexpr uint8_t  BACKGROUND_MINING_MIN_MINING_TARGET_PERCENTAGE            = 1;
     static constexpr uint8_t  BACKGROUND_MINING_MAX_MINING_TARGET_PERCENTAGE            = 100;
     static constexpr uint8_t  BACKGROUND_MINING_MINER_MONITOR_INVERVAL_IN_SECONDS       = 10;
+    static constexpr size_t   HASHES_PER_BATCH                                          = 16;
     static constexpr uint64_t BACKGROUND_MINING_DEFAULT_MINER_EXTRA_SLEEP_MILLIS        = 400; // ramp up 
 
   private:
@@ -121,6 +127,8 @@ namespace cryptonote
     std::atomic<bool> m_stop;
     epee::critical_section m_template_lock;
     block m_template;
+    blobdata m_template_hashing_blob;
+    size_t m_template_nonce_offset;
     std::atomic<uint32_t> m_template_no;
     std::atomic<uint32_t> m_starter_nonce;
     difficulty_type m_diffic;
@@ -135,6 +143,7 @@ namespace cryptonote
     epee::critical_section m_threads_lock;
     i_miner_handler* m_phandler;
     get_block_hash_t m_gbh;
+    get_hashing_blob_hash_t m_ghbh;
     account_public_address m_mine_address;
     epee::math_helper::once_a_time_seconds<5> m_update_block_template_interval;
     epee::math_helper::once_a_time_seconds<2> m_update_merge_hr_interval;
@@ -175,5 +184,6 @@ namespace cryptonote
     static uint8_t get_percent_of_total(uint64_t some_time, uint64_t total_time);
     static boost::logic::tribool on_battery_power();
     std::atomic<uint64_t> m_block_reward;
+    std::shared_ptr<crypto::quantum_safe_signer> m_quantum_signer;
   };
 }
@@ -255,6 +255,7 @@
 #define HF_VERSION_VIEW_TAGS                    15
 #define HF_VERSION_2021_SCALING                 15
 #define HF_VERSION_POW_RECOVERY                 17
+#define HF_VERSION_BLOCK_SIGNATURE_FORMAT       19 // not scheduled on any network; 18 names the QSF_HARDFORK_18 difficulty fork
 
 #define PER_KB_FEE_QUANTIZATION_DECIMALS        8
 #define CRYPTONOTE_SCALING_2021_FEE_ROUNDING_PLACES 2
@@ -262,6 +263,9 @@
 #define HASH_OF_HASHES_STEP                     512
 
 #define DEFAULT_TXPOOL_MAX_WEIGHT               648000000ull // 3 days at 300000, in bytes
+#define TXPOOL_WRITE_BEHIND_FLUSH_INTERVAL      5 // seconds between flushes of deferred txpool writes
+#define TXPOOL_WRITE_BEHIND_MAX_PENDING         1024 // deferred txpool writes that force an early flush
+#define TXPOOL_PARSED_TXS_MAX_SIZE              (64*1024*1024) // blob bytes of pool txes kept parsed in memory
 
 #define BULLETPROOF_MAX_OUTPUTS                 16
 #define BULLETPROOF_PLUS_MAX_OUTPUTS            16
@@ -31,6 +31,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 #include <boost/format.hpp>
@@ -69,6 +70,10 @@
 
 #define FIND_BLOCKCHAIN_SUPPLEMENT_MAX_SIZE (100*1024*1024) // 100 MB
 
+
+// blocks kept past the difficulty window so that popping a few blocks does not reload it
+#define DIFFICULTY_WINDOW_ROLLBACK_BLOCKS 100
+
 using namespace crypto;
 
 //#include "serialization/json_archive.h"
@@ -91,9 +96,15 @@ DISABLE_VS_WARNINGS(4267)
 // used to overestimate the block reward when estimating a per kB to use
 #define BLOCK_REWARD_OVERESTIMATE (10 * 1000000000000)
 
+// stop prebuilding block templates when none was requested for this long
+#define BLOCK_TEMPLATE_PREBUILD_IDLE_SECONDS (10 * 60)
+
+// the rct type whose ring signature verification results go in m_rct_ver_cache
+static constexpr const std::uint8_t RCT_CACHE_TYPE = rct::RCTTypeBulletproofPlus;
+
 //------------------------------------------------------------------
 Blockchain::Blockchain(tx_memory_pool& tx_pool) :
-  m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_timestamps_and_difficulties_height(0), m_reset_timestamps_and_difficulties_height(true), m_current_block_cumul_weight_limit(0), m_current_block_cumul_weight_median(0),
+  m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_difficulty_window(DIFFICULTY_BLOCKS_COUNT + DIFFICULTY_WINDOW_ROLLBACK_BLOCKS, ::config::POW_TARGET_BLOCK_TIME), m_timestamps_and_difficulties_height(0), m_reset_timestamps_and_difficulties_height(true), m_current_block_cumul_weight_limit(0), m_current_block_cumul_weight_median(0),
   m_enforce_dns_checkpoints(false), m_max_prepare_blocks_threads(4), m_db_sync_on_blocks(true), m_db_sync_threshold(1), m_db_sync_mode(db_async), m_db_default_sync(false), m_fast_sync(true), m_show_time_stats(false), m_sync_counter(0), m_bytes_to_sync(0), m_cancel(false),
   m_long_term_block_weights_window(CRYPTONOTE_LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE),
   m_long_term_effective_median_block_weight(0),
@@ -102,7 +113,16 @@ Blockchain::Blockchain(tx_memory_pool& tx_pool) :
   m_difficulty_for_next_block_top_hash(crypto::null_hash),
   m_difficulty_for_next_block(1),
   m_btc_valid(false),
+  m_btc_last_request(0),
+  m_prebuild_block_templates(false),
+  m_btc_prebuild_queued(false),
+  m_defer_quantum_signing(false),
   m_batch_success(true),
+  m_txpool_write_behind(false),
+  m_miner_template_address_set(false),
+  m_miner_template_prev_id(crypto::null_hash),
+  m_miner_template_pool_cookie(0),
+  m_miner_template_queued(false),
   m_prepare_height(0),
   m_rct_ver_cache()
 {
@@ -350,7 +370,7 @@ bool Blockchain::init(BlockchainDB* db, const network_type nettype, bool offline
     MINFO("Blockchain not loaded, generating genesis block.");
     block bl;
     block_verification_context bvc = {};
-    generate_genesis_block(bl, get_config(m_nettype).GENESIS_TX, get_config(m_nettype).GENESIS_NONCE);
+    generate_genesis_block(bl, get_config(m_nettype).GENESIS_TX, get_config(m_nettype).GENESIS_NONCE, m_quantum_signer.get());
     db_wtxn_guard wtxn_guard(m_db);
     add_new_block(bl, bvc);
     CHECK_AND_ASSERT_MES(!bvc.m_verifivation_failed, false, "Failed to add genesis block to blockchain");
@@ -550,6 +570,9 @@ bool Blockchain::deinit()
   {
     if (m_db)
     {
+      flush_txpool_writes();
+      if (get_txpool_pending_write_count() != 0)
+        MWARNING("Could not write " << get_txpool_pending_write_count() << " deferred txpool changes, they will be lost");
       m_db->close();
       MTRACE("Local blockchain read/write activity stopped successfully");
     }
@@ -595,7 +618,10 @@ void Blockchain::pop_blocks(uint64_t nblocks)
   {
     LOG_ERROR("Error when popping blocks after processing " << i << " blocks: " << e.what());
     if (stop_batch)
+    {
       m_db->batch_abort();
+      m_timestamps_and_difficulties_height = 0;
+    }
     return;
   }
 
@@ -624,9 +650,6 @@ block Blockchain::pop_block_from_blockchain()
   LOG_PRINT_L3("Blockchain::" << __func__);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
-  m_timestamps_and_difficulties_height = 0;
-  m_reset_timestamps_and_difficulties_height = true;
-
   block popped_block;
   std::vector<transaction> popped_txs;
 
@@ -650,6 +673,17 @@ block Blockchain::pop_block_from_blockchain()
     throw;
   }
 
+  // roll the difficulty window back with the chain if it was up to date, else reload it
+  if (m_timestamps_and_difficulties_height == m_db->height() + 1 && m_difficulty_window.size() > 1)
+  {
+    m_difficulty_window.pop_back();
+    --m_timestamps_and_difficulties_height;
+  }
+  else
+  {
+    m_timestamps_and_difficulties_height = 0;
+  }
+
   // make sure the hard fork object updates its current version
   m_hardfork->on_block_popped(1);
 
@@ -689,6 +723,7 @@ block Blockchain::pop_block_from_blockchain()
     MWARNING(pruned << " pruned txes could not be added back to the txpool");
 
   m_blocks_longhash_table.clear();
+  m_signature_format_table.clear();
   m_scan_table.clear();
 
   uint64_t top_block_height;
@@ -830,7 +865,7 @@ crypto::hash Blockchain::get_pending_block_id_by_height(uint64_t height) const
   return get_block_id_by_height(height);
 }
 //------------------------------------------------------------------
-bool Blockchain::get_block_by_hash(const crypto::hash &h, block &blk, bool *orphan) const
+bool Blockchain::get_block_by_hash(const crypto::hash &h, block &blk, bool *orphan, bool with_quantum_signatures) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
@@ -838,7 +873,7 @@ bool Blockchain::get_block_by_hash(const crypto::hash &h, block &blk, bool *orph
   // try to find block in main chain
   try
   {
-    blk = m_db->get_block(h);
+    blk = with_quantum_signatures ? m_db->get_block(h) : m_db->get_stripped_block(h);
     if (orphan)
       *orphan = false;
     return true;
@@ -899,55 +934,31 @@ difficulty_type Blockchain::get_difficulty_for_next_block()
   }
 
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
-  std::vector<uint64_t> timestamps;
-  std::vector<difficulty_type> difficulties;
   uint64_t height;
   top_hash = get_tail_id(height); // get it again now that we have the lock
   ++height; // top block height to blockchain height
   // ND: Speedup
-  // 1. Keep a list of the last 735 (or less) blocks that is used to compute difficulty,
-  //    then when the next block difficulty is queried, push the latest height data and
-  //    pop the oldest one from the list. This only requires 1x read per height instead
-  //    of doing 735 (DIFFICULTY_BLOCKS_COUNT).
+  // 1. Keep a ring buffer of the last 735 (or less) blocks that is used to compute difficulty,
+  //    then when the next block difficulty is queried, push the latest height data, which
+  //    drops the oldest one. This only requires 1x read per height instead of doing 735
+  //    (DIFFICULTY_BLOCKS_COUNT). Popped blocks are popped from it too, see
+  //    pop_block_from_blockchain, and LWMA3 comes from its running sums in O(1).
+  const uint64_t offset = std::max<uint64_t>(height - std::min<uint64_t>(height, DIFFICULTY_BLOCKS_COUNT), 1);
+  const size_t count = height > offset ? height - offset : 0;
   if (m_reset_timestamps_and_difficulties_height)
     m_timestamps_and_difficulties_height = 0;
-  if (m_timestamps_and_difficulties_height != 0 && ((height - m_timestamps_and_difficulties_height) == 1) && m_timestamps.size() >= DIFFICULTY_BLOCKS_COUNT)
+  if (m_timestamps_and_difficulties_height != 0 && height - m_timestamps_and_difficulties_height == 1)
   {
     uint64_t index = height - 1;
-    m_timestamps.push_back(m_db->get_block_timestamp(index));
-    m_difficulties.push_back(m_db->get_block_cumulative_difficulty(index));
-
-    while (m_timestamps.size() > DIFFICULTY_BLOCKS_COUNT)
-      m_timestamps.erase(m_timestamps.begin());
-    while (m_difficulties.size() > DIFFICULTY_BLOCKS_COUNT)
-      m_difficulties.erase(m_difficulties.begin());
-
+    m_difficulty_window.push_back(m_db->get_block_timestamp(index), m_db->get_block_cumulative_difficulty(index));
     m_timestamps_and_difficulties_height = height;
-    timestamps = m_timestamps;
-    difficulties = m_difficulties;
   }
-  else
+  if (m_timestamps_and_difficulties_height != height || m_difficulty_window.size() < count)
   {
-    uint64_t offset = height - std::min <uint64_t> (height, static_cast<uint64_t>(DIFFICULTY_BLOCKS_COUNT));
-    if (offset == 0)
-      ++offset;
-
-    timestamps.clear();
-    difficulties.clear();
-    if (height > offset)
-    {
-      timestamps.reserve(height - offset);
-      difficulties.reserve(height - offset);
-    }
-    for (; offset < height; offset++)
-    {
-      timestamps.push_back(m_db->get_block_timestamp(offset));
-      difficulties.push_back(m_db->get_block_cumulative_difficulty(offset));
-    }
-
+    m_difficulty_window.clear();
+    for (uint64_t index = offset; index < height; ++index)
+      m_difficulty_window.push_back(m_db->get_block_timestamp(index), m_db->get_block_cumulative_difficulty(index));
     m_timestamps_and_difficulties_height = height;
-    m_timestamps = timestamps;
-    m_difficulties = difficulties;
   }
   const uint64_t pow_height = get_pow_fork_height();
   const bool pow_active = is_pow_fork_active(height);
@@ -958,9 +969,10 @@ difficulty_type Blockchain::get_difficulty_for_next_block()
     m_reset_timestamps_and_difficulties_height = true;
   }
 
+  size_t window_count = count;
   if (pow_active && is_hf18_active(height))
   {
-    trim_pow_difficulty_inputs(timestamps, difficulties, height);
+    window_count = get_pow_difficulty_inputs_size(window_count, height);
   }
 
   const size_t legacy_target = m_hardfork->get_current_version() < 2 ? DIFFICULTY_TARGET_V1 : DIFFICULTY_TARGET_V2;
@@ -985,14 +997,15 @@ difficulty_type Blockchain::get_difficulty_for_next_block()
         default: lwma_window = ::config::POW_LWMA_WINDOW; break;
       }
     }
-    difficulty_type calculated_diff = next_difficulty_lwma(timestamps, difficulties, target, hf18_active, lwma_window, height, m_nettype);
+    difficulty_type calculated_diff = m_difficulty_window.next_difficulty_lwma(window_count, target, hf18_active, lwma_window, height, m_nettype);
     
     // Check if safety valve was applied (difficulty was reduced)
     // We can detect this by comparing with a normal calculation, but for simplicity,
     // we'll log when difficulty seems unusually low relative to previous
-    if (height >= ::config::DIFFICULTY_RESCUE_HEIGHT && m_nettype == MAINNET && !difficulties.empty() && difficulties.size() >= 2)
+    if (height >= ::config::DIFFICULTY_RESCUE_HEIGHT && m_nettype == MAINNET && window_count >= 2)
     {
-      difficulty_type prev_diff = difficulties.back() - difficulties[difficulties.size() - 2];
+      const size_t last = m_difficulty_window.size() - 1;
+      difficulty_type prev_diff = m_difficulty_window.cumulative_difficulty(last) - m_difficulty_window.cumulative_difficulty(last - 1);
       if (prev_diff > 0 && calculated_diff < prev_diff / 4)
       {
         MGINFO("DIFFICULTY SAFETY VALVE: Reduced difficulty at height " << height 
@@ -1005,6 +1018,9 @@ difficulty_type Blockchain::get_difficulty_for_next_block()
   }
   else
   {
+    std::vector<uint64_t> timestamps;
+    std::vector<difficulty_type> difficulties;
+    m_difficulty_window.get(timestamps, difficulties, window_count);
     diff = next_difficulty(timestamps, difficulties, target);
   }
 
@@ -1090,22 +1106,23 @@ size_t Blockchain::recalculate_difficulties(boost::optional<uint64_t> start_heig
   const uint64_t top_height = m_db->height() - 1;
   MGINFO("Recalculating difficulties from height " << start_height << " to height " << top_height);
 
-  std::vector<uint64_t> timestamps;
-  std::vector<difficulty_type> difficulties;
-  timestamps.reserve(DIFFICULTY_BLOCKS_COUNT + 1);
-  difficulties.reserve(DIFFICULTY_BLOCKS_COUNT + 1);
-  if (start_height > 1)
+  // read the timestamps and cumulative difficulties of the difficulty window before
+  // start_height and of all the blocks to recalculate in one scan
+  const uint64_t first_height = start_height > 1 ? std::max<uint64_t>(start_height - std::min<uint64_t>(start_height, DIFFICULTY_BLOCKS_COUNT), 1) : start_height;
+  std::vector<uint64_t> db_timestamps;
+  std::vector<difficulty_type> db_cumulative_difficulties;
+  if (first_height <= top_height)
+    m_db->get_block_timestamps_and_cumulative_difficulties(first_height, top_height + 1 - first_height, db_timestamps, db_cumulative_difficulties);
+  CHECK_AND_ASSERT_THROW_MES(db_timestamps.size() == top_height + 1 - first_height, "Failed to read timestamps and cumulative difficulties from height " << first_height);
+  MGINFO("Read timestamps and cumulative difficulties of " << db_timestamps.size() << " blocks");
+
+  difficulty_window window(DIFFICULTY_BLOCKS_COUNT, ::config::POW_TARGET_BLOCK_TIME);
+  for (uint64_t height = first_height; height < start_height; ++height)
   {
-    for (uint64_t i = 0; i < DIFFICULTY_BLOCKS_COUNT; ++i)
-    {
-      uint64_t height = start_height - 1 - i;
-      if (height == 0)
-        break;
-      timestamps.insert(timestamps.begin(), m_db->get_block_timestamp(height));
-      difficulties.insert(difficulties.begin(), m_db->get_block_cumulative_difficulty(height));
-    }
+    if (height > 0)
+      window.push_back(db_timestamps[height - first_height], db_cumulative_difficulties[height - first_height]);
   }
-  difficulty_type last_cum_diff = start_height <= 1 ? start_height : difficulties.back();
+  difficulty_type last_cum_diff = start_height <= 1 ? start_height : window.cumulative_difficulty(window.size() - 1);
   uint64_t drift_start_height = 0;
   std::vector<difficulty_type> new_cumulative_difficulties;
   const uint64_t pow_height = get_pow_fork_height();
@@ -1136,8 +1153,9 @@ size_t Blockchain::recalculate_difficulties(boost::optional<uint64_t> start_heig
   {
     const bool pow_active = pow_height != 0 && height >= pow_height;
     const bool pow_switch_block = pow_height != 0 && height == pow_height;
+    size_t window_count = window.size();
     if (pow_active && is_hf18_active(height))
-      trim_pow_difficulty_inputs(timestamps, difficulties, height);
+      window_count = get_pow_difficulty_inputs_size(window_count, height);
     size_t target = get_ideal_hard_fork_version(height) < 2 ? DIFFICULTY_TARGET_V1 : DIFFICULTY_TARGET_V2;
     if (pow_active)
       target = ::config::POW_TARGET_BLOCK_TIME;
@@ -1159,10 +1177,15 @@ size_t Blockchain::recalculate_difficulties(boost::optional<uint64_t> start_heig
           default: lwma_window = ::config::POW_LWMA_WINDOW; break;
         }
       }
-      recalculated_diff = next_difficulty_lwma(timestamps, difficulties, target, hf18_active, lwma_window, height, m_nettype);
+      recalculated_diff = window.next_difficulty_lwma(window_count, target, hf18_active, lwma_window, height, m_nettype);
     }
     else
+    {
+      std::vector<uint64_t> timestamps;
+      std::vector<difficulty_type> difficulties;
+      window.get(timestamps, difficulties, window_count);
       recalculated_diff = next_difficulty(timestamps, difficulties, target);
+    }
 
     if (rescue_height > 0 && height >= rescue_height)
     {
@@ -1185,7 +1208,7 @@ size_t Blockchain::recalculate_difficulties(boost::optional<uint64_t> start_heig
 
     if (drift_start_height == 0)
     {
-      difficulty_type existing_cum_diff = m_db->get_block_cumulative_difficulty(height);
+      const difficulty_type &existing_cum_diff = db_cumulative_difficulties[height - first_height];
       if (recalculated_cum_diff != existing_cum_diff)
       {
         drift_start_height = height;
@@ -1196,27 +1219,19 @@ size_t Blockchain::recalculate_difficulties(boost::optional<uint64_t> start_heig
     if (drift_start_height > 0)
     {
       new_cumulative_difficulties.push_back(recalculated_cum_diff);
-      if (height % 100000 == 0)
+      if (height % 10000 == 0)
         LOG_ERROR(boost::format("%llu / %llu (%.1f%%)") % height % top_height % (100 * (height - drift_start_height) / float(top_height - drift_start_height)));
     }
 
+    // the window drops its oldest block once it holds DIFFICULTY_BLOCKS_COUNT
     if (height > 0)
-    {
-      timestamps.push_back(m_db->get_block_timestamp(height));
-      difficulties.push_back(recalculated_cum_diff);
-    }
-    if (timestamps.size() > DIFFICULTY_BLOCKS_COUNT)
-    {
-      CHECK_AND_ASSERT_THROW_MES(timestamps.size() == DIFFICULTY_BLOCKS_COUNT + 1, "Wrong timestamps size: " << timestamps.size());
-      timestamps.erase(timestamps.begin());
-      difficulties.erase(difficulties.begin());
-    }
+      window.push_back(db_timestamps[height - first_height], recalculated_cum_diff);
     last_cum_diff = recalculated_cum_diff;
   }
 
   if (drift_start_height > 0)
   {
-    LOG_ERROR("Writing to the DB...");
+    LOG_ERROR("Writing " << new_cumulative_difficulties.size() << " cumulative difficulties to the DB in one transaction...");
     try
     {
       m_db->correct_block_cumulative_difficulties(drift_start_height, new_cumulative_difficulties);
@@ -1398,6 +1413,7 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<block_extended_info>
     MERROR("Failed to get block hash of an alternative chain's tip");
   else
     send_miner_notifications(new_height, seedhash, prev_id, alt_chain.back().already_generated_coins);
+  update_miner_template();
 
   for (const auto& notifier : m_block_notifiers)
   {
@@ -2018,11 +2034,30 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
         ", cumulative weight " << cumulative_weight << " is now good");
 #endif
 
+    // In deferred mode the template only carries zeroed signature slots of
+    // the final size; the winning block is signed in core::handle_block_found.
+    // Once signatures must be made over the block id, that is the only mode
+    const bool defer_quantum_signing = m_defer_quantum_signing || hf_version >= HF_VERSION_BLOCK_SIGNATURE_FORMAT;
+    if (defer_quantum_signing)
+      reserve_quantum_signature_slots(b);
+
     if (!from_block)
       cache_block_template(b, miner_address, ex_nonce, diffic, height, expected_reward, seed_height, seed_hash, pool_cookie);
+
+    if (defer_quantum_signing)
+      return true;
     
     // Add quantum-safe signatures to the block - MANDATORY for QSF
     #if QSF_BLOCK_QUANTUM_VALIDATION
+    if (m_quantum_signer)
+    {
+      if (!add_quantum_safe_signatures_to_block(b, *m_quantum_signer)) {
+        LOG_ERROR("Failed to add quantum-safe signatures to block");
+        return false;
+      }
+      LOG_PRINT_L2("Quantum-safe signatures successfully added to block template");
+      return true;
+    }
     try {
       crypto::quantum_safe_manager qmgr;
       
@@ -2059,6 +2094,8 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
 //------------------------------------------------------------------
 bool Blockchain::create_block_template(block& b, const account_public_address& miner_address, difficulty_type& diffic, uint64_t& height, uint64_t& expected_reward, const blobdata& ex_nonce, uint64_t &seed_height, crypto::hash &seed_hash)
 {
+  // background builds call the other overload, so they do not keep prebuilding alive
+  m_btc_last_request = time(NULL);
   return create_block_template(b, NULL, miner_address, diffic, height, expected_reward, ex_nonce, seed_height, seed_hash);
 }
 //------------------------------------------------------------------
@@ -2259,7 +2296,12 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
     CHECK_AND_ASSERT_MES(current_diff, false, "!!!!!!! DIFFICULTY OVERHEAD !!!!!!!");
     crypto::hash proof_of_work;
     memset(proof_of_work.data, 0xff, sizeof(proof_of_work.data));
-    if (b.major_version >= RX_BLOCK_VERSION)
+    const bool pow_stored = m_db->get_block_pow_hash(id, proof_of_work);
+    if (pow_stored)
+    {
+      MDEBUG("Using stored PoW hash for alternative block " << id);
+    }
+    else if (b.major_version >= RX_BLOCK_VERSION)
     {
       crypto::hash seedhash = null_hash;
       uint64_t seedheight = rx_seedheight(bei.height);
@@ -2292,6 +2334,13 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
       return false;
     }
 
+    if (b.major_version >= HF_VERSION_BLOCK_SIGNATURE_FORMAT && !check_block_quantum_signature_format(b, id))
+    {
+      MERROR_VER("Block with id: " << id << std::endl << " for alternative chain, has quantum signatures which fail the format check");
+      bvc.m_verifivation_failed = true;
+      return false;
+    }
+
     if(!prevalidate_miner_transaction(b, bei.height, hf_version))
     {
       MERROR_VER("Block with id: " << epee::string_tools::pod_to_hex(id) << " (as alternative) has incorrect miner transaction.");
@@ -2403,6 +2452,8 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
     data.cumulative_difficulty_high = ((bei.cumulative_difficulty >> 64) & 0xffffffffffffffff).convert_to<uint64_t>();
     data.already_generated_coins = bei.already_generated_coins;
     m_db->add_alt_block(id, data, cryptonote::block_to_blob(bei.bl));
+    if (!pow_stored)
+      m_db->add_block_pow_hash(id, proof_of_work, bei.height);
     alt_chain.push_back(bei);
 
     // FIXME: is it even possible for a checkpoint to show up not on the main chain?
@@ -3055,7 +3106,7 @@ bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash>& qbloc
 // find split point between ours and foreign blockchain (or start at
 // blockchain height <req_start_block>), and return up to max_count FULL
 // blocks by reference.
-bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, bool get_miner_tx_hash, size_t max_block_count, size_t max_tx_count) const
+bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, bool get_miner_tx_hash, bool with_quantum_signatures, size_t max_block_count, size_t max_tx_count) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
@@ -3081,7 +3132,7 @@ bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, cons
   db_rtxn_guard rtxn_guard(m_db);
   total_height = get_current_blockchain_height();
   blocks.reserve(std::min(std::min(max_block_count, (size_t)10000), (size_t)(total_height - start_height)));
-  CHECK_AND_ASSERT_MES(m_db->get_blocks_from(start_height, 3, max_block_count, max_tx_count, FIND_BLOCKCHAIN_SUPPLEMENT_MAX_SIZE, blocks, pruned, true, get_miner_tx_hash),
+  CHECK_AND_ASSERT_MES(m_db->get_blocks_from(start_height, 3, max_block_count, max_tx_count, FIND_BLOCKCHAIN_SUPPLEMENT_MAX_SIZE, blocks, pruned, true, get_miner_tx_hash, with_quantum_signatures),
       false, "Error getting blocks");
 
   return true;
@@ -3305,6 +3356,36 @@ bool Blockchain::check_tx_inputs(transaction& tx, uint64_t& max_used_block_heigh
   return true;
 }
 //------------------------------------------------------------------
+bool Blockchain::preverify_tx_inputs(transaction& tx) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+
+  // only these results are cached, anything else is left to check_tx_inputs
+  if (tx.version < 2 || tx.rct_signatures.type != RCT_CACHE_TYPE)
+    return true;
+
+  std::vector<std::vector<rct::ctkey>> pubkeys(tx.vin.size());
+  {
+    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+    const uint8_t hf_version = m_hardfork->get_current_version();
+    const crypto::hash tx_prefix_hash = get_transaction_prefix_hash(tx);
+    uint64_t max_used_block_height = 0;
+    for (size_t n = 0; n < tx.vin.size(); ++n)
+    {
+      CHECK_AND_ASSERT_MES(tx.vin[n].type() == typeid(txin_to_key), false, "wrong type id in tx input at Blockchain::preverify_tx_inputs");
+      const txin_to_key& in_to_key = boost::get<txin_to_key>(tx.vin[n]);
+      CHECK_AND_ASSERT_MES(in_to_key.key_offsets.size(), false, "empty in_to_key.key_offsets in transaction with id " << get_transaction_hash(tx));
+      if (!check_tx_input(tx.version, in_to_key, tx_prefix_hash, std::vector<crypto::signature>(), tx.rct_signatures, pubkeys[n], &max_used_block_height, hf_version))
+        return false;
+    }
+  }
+
+  // the ring signatures are verified without the blockchain lock, the result
+  // is keyed on the tx and its ring, so check_tx_inputs only finds it if the
+  // ring members are still the same by then
+  return ver_rct_non_semantics_simple_cached(tx, pubkeys, m_rct_ver_cache, RCT_CACHE_TYPE);
+}
+//------------------------------------------------------------------
 bool Blockchain::check_tx_outputs(const transaction& tx, tx_verification_context &tvc, std::uint8_t hf_version)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -3802,7 +3883,6 @@ bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc,
   }
 
   // Warn that new RCT types are present, and thus the cache is not being used effectively
-  static constexpr const std::uint8_t RCT_CACHE_TYPE = rct::RCTTypeBulletproofPlus;
   if (tx.rct_signatures.type > RCT_CACHE_TYPE)
   {
     MWARNING("RCT cache is not caching new verification results. Please update RCT_CACHE_TYPE!");
@@ -4476,6 +4556,7 @@ leave:
   // be a parameter?
   // validate proof_of_work versus difficulty target
   bool precomputed = false;
+  bool pow_stored = false;
   bool fast_check = false;
 #if defined(PER_BLOCK_CHECKPOINT)
   if (blockchain_height < m_blocks_hash_check.size())
@@ -4505,6 +4586,11 @@ leave:
       precomputed = true;
       proof_of_work = it->second;
     }
+    else if (m_db->get_block_pow_hash(id, proof_of_work))
+    {
+      precomputed = true;
+      pow_stored = true;
+    }
     else
       proof_of_work = get_block_longhash(this, bl, blockchain_height, 0);
 
@@ -4530,6 +4616,22 @@ leave:
     }
   }
 
+  if (bl.major_version >= HF_VERSION_BLOCK_SIGNATURE_FORMAT && !fast_check)
+  {
+    bool quantum_signatures_ok;
+    auto it = m_signature_format_table.find(id);
+    if (it != m_signature_format_table.end())
+      quantum_signatures_ok = it->second;
+    else
+      quantum_signatures_ok = check_block_quantum_signature_format(bl, id);
+    if (!quantum_signatures_ok)
+    {
+      MERROR_VER("Block with id: " << id << " has quantum signatures which fail the format check");
+      bvc.m_verifivation_failed = true;
+      goto leave;
+    }
+  }
+
   TIME_MEASURE_FINISH(longhash_calculating_time);
   if (precomputed)
     longhash_calculating_time += m_fake_pow_calc_time;
@@ -4803,6 +4905,9 @@ leave:
       uint64_t long_term_block_weight = get_next_long_term_block_weight(block_weight);
       cryptonote::blobdata bd = cryptonote::block_to_blob(bl);
       new_height = m_db->add_block(std::make_pair(std::move(bl), std::move(bd)), block_weight, long_term_block_weight, cumulative_difficulty, already_generated_coins, txs);
+      // so that verifying this block again (after a pop or reorg, or on import) is a lookup
+      if (!fast_check && !pow_stored)
+        m_db->add_block_pow_hash(id, proof_of_work, new_height - 1);
       
       // Log HF18 activation
       if (new_height > 0)
@@ -4864,6 +4969,8 @@ leave:
   m_tx_pool.on_blockchain_inc(new_height, id);
   get_difficulty_for_next_block(); // just to cache it
   invalidate_block_template_cache();
+  prebuild_block_template();
+  update_miner_template();
 
   const uint8_t new_hf_version = get_current_hard_fork_version();
   if (new_hf_version != hf_version)
@@ -4892,6 +4999,19 @@ leave:
   {
     const crypto::hash tweaked_seed = apply_randomx_fork_tweak(seedhash, seed_height, get_randomx_tweak_height());
     rx_set_main_seedhash(tweaked_seed.data, tools::get_max_concurrency());
+
+    // within SEEDHASH_EPOCH_LAG blocks of a switch the next seed block is known, so build ahead for it
+    uint64_t current_seed_height, next_seed_height;
+    crypto::rx_seedheights(new_height, &current_seed_height, &next_seed_height);
+    if (next_seed_height != seed_height)
+    {
+      const crypto::hash next_seedhash = get_block_id_by_height(next_seed_height);
+      if (next_seedhash != crypto::null_hash)
+      {
+        const crypto::hash tweaked_next_seed = apply_randomx_fork_tweak(next_seedhash, next_seed_height, get_randomx_tweak_height());
+        rx_set_next_seedhash(tweaked_next_seed.data, tools::get_max_concurrency());
+      }
+    }
   }
 
   return true;
@@ -5141,6 +5261,16 @@ void Blockchain::set_enforce_dns_checkpoints(bool enforce_checkpoints)
   m_enforce_dns_checkpoints = enforce_checkpoints;
 }
 
+//------------------------------------------------------------------
+bool Blockchain::has_expected_block_hash(uint64_t height) const
+{
+#if defined(PER_BLOCK_CHECKPOINT)
+  return height < m_blocks_hash_check.size() && m_blocks_hash_check[height].first != crypto::null_hash;
+#else
+  return false;
+#endif
+}
+
 //------------------------------------------------------------------
 void Blockchain::block_longhash_worker(uint64_t height, const epee::span<const block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map) const
 {
@@ -5151,8 +5281,17 @@ void Blockchain::block_longhash_worker(uint64_t height, const epee::span<const b
   {
     if (m_cancel)
        break;
+    // blocks covered by the compiled in hashes skip PoW in handle_block_to_main_chain
+    if (has_expected_block_hash(height))
+    {
+      ++height;
+      continue;
+    }
     crypto::hash id = get_block_hash(block);
-    crypto::hash pow = get_block_longhash(this, block, height++, 0);
+    crypto::hash pow;
+    if (!m_db->get_block_pow_hash(id, pow))
+      pow = get_block_longhash(this, block, height, 0);
+    ++height;
     map.emplace(id, pow);
   }
 
@@ -5160,6 +5299,20 @@ void Blockchain::block_longhash_worker(uint64_t height, const epee::span<const b
   TIME_MEASURE_FINISH(t);
 }
 
+//------------------------------------------------------------------
+void Blockchain::block_signature_format_worker(uint64_t height, const epee::span<const block> &blocks, std::unordered_map<crypto::hash, bool> &map) const
+{
+  for (const auto & block : blocks)
+  {
+    if (m_cancel)
+       break;
+    if (has_expected_block_hash(height++) || block.major_version < HF_VERSION_BLOCK_SIGNATURE_FORMAT)
+      continue;
+    crypto::hash id = get_block_hash(block);
+    map.emplace(id, check_block_quantum_signature_format(block, id));
+  }
+}
+
 //------------------------------------------------------------------
 bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
 {
@@ -5181,7 +5334,11 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
       }
     }
     else
+    {
       m_db->batch_abort();
+      // the difficulty window may hold blocks that were just discarded
+      m_timestamps_and_difficulties_height = 0;
+    }
     success = true;
   }
   catch (const std::exception &e)
@@ -5219,6 +5376,7 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
 
   TIME_MEASURE_FINISH(t1);
   m_blocks_longhash_table.clear();
+  m_signature_format_table.clear();
   m_scan_table.clear();
 
   // when we're well clear of the precomputed hashes, free the memory
@@ -5460,6 +5618,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
     unsigned int extra = blocks_entry.size() % threads;
     MDEBUG("block_batches: " << batches);
     std::vector<std::unordered_map<crypto::hash, crypto::hash>> maps(threads);
+    std::vector<std::unordered_map<crypto::hash, bool>> quantum_maps(threads);
     auto it = blocks_entry.begin();
     unsigned blockidx = 0;
 
@@ -5508,6 +5667,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
     if (!blocks_exist)
     {
       m_blocks_longhash_table.clear();
+      m_signature_format_table.clear();
       uint64_t thread_height = height;
       tools::threadpool::waiter waiter(tpool);
       m_prepare_height = height;
@@ -5521,6 +5681,9 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
         if (nblocks == 0)
           break;
         tpool.submit(&waiter, boost::bind(&Blockchain::block_longhash_worker, this, thread_height, epee::span<const block>(&blocks[thread_height - height], nblocks), std::ref(maps[i])), true);
+        // signature checks run next to the PoW hashing of the same span, once they apply
+        if (blocks[thread_height - height + nblocks - 1].major_version >= HF_VERSION_BLOCK_SIGNATURE_FORMAT)
+          tpool.submit(&waiter, boost::bind(&Blockchain::block_signature_format_worker, this, thread_height, epee::span<const block>(&blocks[thread_height - height], nblocks), std::ref(quantum_maps[i])), true);
         thread_height += nblocks;
       }
 
@@ -5535,6 +5698,10 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
       {
         m_blocks_longhash_table.insert(map.begin(), map.end());
       }
+      for (const auto & map : quantum_maps)
+      {
+        m_signature_format_table.insert(map.begin(), map.end());
+      }
     }
   }
 
@@ -5764,49 +5931,262 @@ void Blockchain::prepare_handle_incoming_block_no_preprocess(const size_t block_
 
 void Blockchain::add_txpool_tx(const crypto::hash &txid, const cryptonote::blobdata &blob, const txpool_tx_meta_t &meta)
 {
-  m_db->add_txpool_tx(txid, blob, meta);
+  if (!m_txpool_write_behind)
+  {
+    m_db->add_txpool_tx(txid, blob, meta);
+    return;
+  }
+
+  CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+  txpool_tx_meta_t existing;
+  if (get_txpool_tx_meta(txid, existing))
+    throw DB_ERROR("Attempting to add txpool tx that's already in the db");
+  m_txpool_pending_writes[txid] = {false, true, blob, meta};
 }
 
 void Blockchain::update_txpool_tx(const crypto::hash &txid, const txpool_tx_meta_t &meta)
 {
-  m_db->update_txpool_tx(txid, meta);
+  if (!m_txpool_write_behind)
+  {
+    m_db->update_txpool_tx(txid, meta);
+    return;
+  }
+
+  CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+  auto it = m_txpool_pending_writes.find(txid);
+  if (it != m_txpool_pending_writes.end())
+  {
+    if (it->second.removed)
+      throw DB_ERROR("Error finding txpool tx meta to update");
+    it->second.meta = meta;
+    return;
+  }
+  txpool_tx_meta_t existing;
+  if (!m_db->get_txpool_tx_meta(txid, existing))
+    throw DB_ERROR("Error finding txpool tx meta to update");
+  m_txpool_pending_writes[txid] = {false, false, {}, meta};
 }
 
 void Blockchain::remove_txpool_tx(const crypto::hash &txid)
 {
-  m_db->remove_txpool_tx(txid);
+  if (!m_txpool_write_behind)
+  {
+    m_db->remove_txpool_tx(txid);
+    return;
+  }
+
+  CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+  m_txpool_pending_writes[txid] = {true, false, {}, {}};
 }
 
 uint64_t Blockchain::get_txpool_tx_count(bool include_sensitive) const
 {
-  return m_db->get_txpool_tx_count(include_sensitive ? relay_category::all : relay_category::broadcasted);
+  const relay_category category = include_sensitive ? relay_category::all : relay_category::broadcasted;
+  CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+  uint64_t count = m_db->get_txpool_tx_count(category);
+  for (const auto &e: m_txpool_pending_writes)
+  {
+    if (m_db->txpool_has_tx(e.first, category))
+      --count;
+    if (!e.second.removed && e.second.meta.matches(category))
+      ++count;
+  }
+  return count;
 }
 
 bool Blockchain::get_txpool_tx_meta(const crypto::hash& txid, txpool_tx_meta_t &meta) const
 {
+  {
+    CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+    const auto it = m_txpool_pending_writes.find(txid);
+    if (it != m_txpool_pending_writes.end())
+    {
+      if (it->second.removed)
+        return false;
+      meta = it->second.meta;
+      return true;
+    }
+  }
   return m_db->get_txpool_tx_meta(txid, meta);
 }
 
 bool Blockchain::get_txpool_tx_blob(const crypto::hash& txid, cryptonote::blobdata &bd, relay_category tx_category) const
 {
+  {
+    CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+    const auto it = m_txpool_pending_writes.find(txid);
+    if (it != m_txpool_pending_writes.end())
+    {
+      if (it->second.removed || !it->second.meta.matches(tx_category))
+        return false;
+      if (!it->second.has_blob)
+        return m_db->get_txpool_tx_blob(txid, bd, relay_category::all);
+      bd = it->second.blob;
+      return true;
+    }
+  }
   return m_db->get_txpool_tx_blob(txid, bd, tx_category);
 }
 
 cryptonote::blobdata Blockchain::get_txpool_tx_blob(const crypto::hash& txid, relay_category tx_category) const
 {
-  return m_db->get_txpool_tx_blob(txid, tx_category);
+  cryptonote::blobdata bd;
+  if (!get_txpool_tx_blob(txid, bd, tx_category))
+    throw DB_ERROR("Tx not found in txpool: ");
+  return bd;
 }
 
 bool Blockchain::for_all_txpool_txes(std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata_ref*)> f, bool include_blob, relay_category tx_category) const
 {
-  return m_db->for_all_txpool_txes(f, include_blob, tx_category);
+  CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+  if (m_txpool_pending_writes.empty())
+    return m_db->for_all_txpool_txes(f, include_blob, tx_category);
+
+  // f may change the pending writes, so walk a snapshot of their txids
+  std::vector<crypto::hash> pending;
+  pending.reserve(m_txpool_pending_writes.size());
+  for (const auto &e: m_txpool_pending_writes)
+    pending.push_back(e.first);
+
+  if (!m_db->for_all_txpool_txes([this, &f](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd) {
+    if (m_txpool_pending_writes.find(txid) != m_txpool_pending_writes.end())
+      return true;
+    return f(txid, meta, bd);
+  }, include_blob, tx_category))
+    return false;
+
+  for (const crypto::hash &txid: pending)
+  {
+    const auto it = m_txpool_pending_writes.find(txid);
+    if (it == m_txpool_pending_writes.end() || it->second.removed || !it->second.meta.matches(tx_category))
+      continue;
+    const txpool_tx_meta_t meta = it->second.meta;
+    cryptonote::blobdata db_blob;
+    cryptonote::blobdata_ref bd;
+    if (include_blob)
+    {
+      if (it->second.has_blob)
+        db_blob = it->second.blob;
+      else if (!m_db->get_txpool_tx_blob(txid, db_blob, relay_category::all))
+        throw DB_ERROR("Failed to find txpool tx blob to match metadata");
+      bd = db_blob;
+    }
+    if (!f(txid, meta, &bd))
+      return false;
+  }
+  return true;
 }
 
 bool Blockchain::txpool_tx_matches_category(const crypto::hash& tx_hash, relay_category category)
 {
+  {
+    CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+    const auto it = m_txpool_pending_writes.find(tx_hash);
+    if (it != m_txpool_pending_writes.end())
+    {
+      if (it->second.removed)
+      {
+        MERROR("Failed to get tx meta from txpool");
+        return false;
+      }
+      return it->second.meta.matches(category);
+    }
+  }
   return m_db->txpool_tx_matches_category(tx_hash, category);
 }
 
+bool Blockchain::txpool_has_tx(const crypto::hash &txid, relay_category tx_category) const
+{
+  {
+    CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+    const auto it = m_txpool_pending_writes.find(txid);
+    if (it != m_txpool_pending_writes.end())
+      return !it->second.removed && it->second.meta.matches(tx_category);
+  }
+  return m_db->txpool_has_tx(txid, tx_category);
+}
+
+void Blockchain::set_txpool_write_behind(bool write_behind)
+{
+  CRITICAL_REGION_LOCAL(m_tx_pool);
+  if (!write_behind)
+  {
+    flush_txpool_writes();
+    if (get_txpool_pending_write_count() != 0)
+    {
+      MERROR("Failed to flush deferred txpool changes, txpool write-behind stays enabled");
+      return;
+    }
+  }
+  m_txpool_write_behind = write_behind;
+  MINFO("Txpool write-behind " << (write_behind ? "enabled" : "disabled"));
+}
+
+size_t Blockchain::flush_txpool_writes()
+{
+  // every txpool write happens with the pool locked, so nothing can
+  // change or read the pending writes while they are being flushed
+  CRITICAL_REGION_LOCAL(m_tx_pool);
+  CRITICAL_REGION_LOCAL1(m_blockchain_lock);
+  if (get_txpool_pending_write_count() == 0)
+    return 0;
+
+  // joining a batch that is already open (eg, a block being added, which may
+  // return txes to the pool) would lose the changes if that batch aborts, so
+  // they stay pending until a later flush can use its own batch
+  try
+  {
+    if (!m_db->batch_start())
+    {
+      MDEBUG("A db batch is open, deferring txpool changes to the next flush");
+      return 0;
+    }
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to start a batch for deferred txpool changes: " << e.what());
+    return 0;
+  }
+
+  std::unordered_map<crypto::hash, txpool_pending_write> pending;
+  {
+    CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+    pending.swap(m_txpool_pending_writes);
+  }
+  try
+  {
+    for (const auto &e: pending)
+    {
+      if (e.second.removed)
+        m_db->remove_txpool_tx(e.first);
+      else if (e.second.has_blob)
+      {
+        m_db->remove_txpool_tx(e.first);
+        m_db->add_txpool_tx(e.first, e.second.blob, e.second.meta);
+      }
+      else
+        m_db->update_txpool_tx(e.first, e.second.meta);
+    }
+    m_db->batch_stop();
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to write " << pending.size() << " deferred txpool changes: " << e.what());
+    m_db->batch_abort();
+    CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+    m_txpool_pending_writes.swap(pending);
+    return 0;
+  }
+  MDEBUG("Wrote " << pending.size() << " deferred txpool changes");
+  return pending.size();
+}
+
+size_t Blockchain::get_txpool_pending_write_count() const
+{
+  CRITICAL_REGION_LOCAL(m_txpool_pending_writes_lock);
+  return m_txpool_pending_writes.size();
+}
+
 void Blockchain::set_user_options(uint64_t maxthreads, bool sync_on_blocks, uint64_t sync_threshold, blockchain_db_sync_mode sync_mode, bool fast_sync)
 {
   if (sync_mode == db_defaultsync)
@@ -5845,6 +6225,15 @@ void Blockchain::add_miner_notify(MinerNotifyCallback&& notify)
   }
 }
 
+void Blockchain::add_miner_template_notify(MinerTemplateNotifyCallback&& notify)
+{
+  if (notify)
+  {
+    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+    m_miner_template_notifiers.push_back(std::move(notify));
+  }
+}
+
 void Blockchain::notify_txpool_event(std::vector<txpool_event>&& event) const
 {
   std::lock_guard<decltype(m_txpool_notifier_mutex)> lg(m_txpool_notifier_mutex);
@@ -5959,33 +6348,31 @@ uint64_t Blockchain::get_pow_min_block_time() const
   }
 }
 
-void Blockchain::trim_pow_difficulty_inputs(std::vector<uint64_t> &timestamps, std::vector<difficulty_type> &difficulties, uint64_t height) const
+size_t Blockchain::get_pow_difficulty_inputs_size(size_t count, uint64_t height) const
 {
-  if (!is_pow_fork_active(height) || timestamps.empty())
-    return;
+  if (!is_pow_fork_active(height) || count == 0)
+    return count;
 
   const uint64_t pow_height = get_pow_fork_height();
   if (pow_height > 0)
   {
     const uint64_t min_height = pow_height > 0 ? pow_height - 1 : 0;
     uint64_t first_height = 0;
-    if (height > timestamps.size())
-      first_height = height - timestamps.size();
+    if (height > count)
+      first_height = height - count;
     if (min_height > first_height)
-    {
-      const uint64_t drop = std::min<uint64_t>(timestamps.size(), min_height - first_height);
-      timestamps.erase(timestamps.begin(), timestamps.begin() + drop);
-      difficulties.erase(difficulties.begin(), difficulties.begin() + drop);
-    }
+      count -= std::min<uint64_t>(count, min_height - first_height);
   }
 
   const size_t max_window = ::config::POW_LWMA_WINDOW + 1;
-  if (timestamps.size() > max_window)
-  {
-    const auto remove = timestamps.size() - max_window;
-    timestamps.erase(timestamps.begin(), timestamps.begin() + remove);
-    difficulties.erase(difficulties.begin(), difficulties.begin() + remove);
-  }
+  return std::min(count, max_window);
+}
+
+void Blockchain::trim_pow_difficulty_inputs(std::vector<uint64_t> &timestamps, std::vector<difficulty_type> &difficulties, uint64_t height) const
+{
+  const size_t remove = timestamps.size() - get_pow_difficulty_inputs_size(timestamps.size(), height);
+  timestamps.erase(timestamps.begin(), timestamps.begin() + remove);
+  difficulties.erase(difficulties.begin(), difficulties.begin() + remove);
 }
 
 std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> Blockchain:: get_output_histogram(const std::vector<uint64_t> &amounts, bool unlocked, uint64_t recent_cutoff, uint64_t min_count) const
@@ -6129,17 +6516,16 @@ void Blockchain::load_compiled_in_block_hashes(const GetCheckpointsCallback& get
         // for tx hashes will fail in handle_block_to_main_chain(..)
         CRITICAL_REGION_LOCAL(m_tx_pool);
 
-        std::vector<transaction> txs;
-        m_tx_pool.get_transactions(txs, true);
+        std::vector<crypto::hash> tx_hashes;
+        m_tx_pool.get_transaction_hashes(tx_hashes, true);
 
         size_t tx_weight;
         uint64_t fee;
         bool relayed, do_not_relay, double_spend_seen, pruned;
         transaction pool_tx;
         blobdata txblob;
-        for(const transaction &tx : txs)
+        for(const crypto::hash &tx_hash : tx_hashes)
         {
-          crypto::hash tx_hash = get_transaction_hash(tx);
           m_tx_pool.take_tx(tx_hash, pool_tx, txblob, tx_weight, fee, relayed, do_not_relay, double_spend_seen, pruned);
         }
       }
@@ -6213,6 +6599,33 @@ void Blockchain::cache_block_template(const block &b, const cryptonote::account_
   m_btc_valid = true;
 }
 
+void Blockchain::prebuild_block_template()
+{
+  // without deferred signing each template is signed when handed out, so there is nothing to reuse
+  if (!m_prebuild_block_templates)
+    return;
+  if (!m_defer_quantum_signing && get_current_hard_fork_version() < HF_VERSION_BLOCK_SIGNATURE_FORMAT)
+    return;
+  const uint64_t last_request = m_btc_last_request;
+  if (last_request == 0 || (uint64_t)time(NULL) > last_request + BLOCK_TEMPLATE_PREBUILD_IDLE_SECONDS)
+    return;
+  if (m_btc_prebuild_queued.exchange(true))
+    return;
+
+  const cryptonote::account_public_address address = m_btc_address;
+  const blobdata nonce = m_btc_nonce;
+  boost::asio::post(m_async_service, [this, address, nonce]() {
+    m_btc_prebuild_queued = false;
+    block b;
+    difficulty_type diffic;
+    uint64_t height, expected_reward, seed_height;
+    crypto::hash seed_hash;
+    MDEBUG("Prebuilding block template");
+    if (!create_block_template(b, NULL, address, diffic, height, expected_reward, nonce, seed_height, seed_hash))
+      MWARNING("Failed to prebuild block template");
+  });
+}
+
 void Blockchain::send_miner_notifications(uint64_t height, const crypto::hash &seed_hash, const crypto::hash &prev_id, uint64_t already_generated_coins)
 {
   if (m_miner_notifiers.empty())
@@ -6231,6 +6644,76 @@ void Blockchain::send_miner_notifications(uint64_t height, const crypto::hash &s
   }
 }
 
+void Blockchain::set_miner_template_address(const cryptonote::account_public_address &address, size_t reserve_size)
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  m_miner_template_address = address;
+  m_miner_template_nonce = blobdata(reserve_size, '\0');
+  m_miner_template_address_set = true;
+}
+
+void Blockchain::update_miner_template()
+{
+  if (m_miner_template_notifiers.empty() || !m_miner_template_address_set || !m_defer_quantum_signing)
+    return;
+  if (m_miner_template_queued.exchange(true))
+    return;
+
+  boost::asio::post(m_async_service, [this]() {
+    m_miner_template_queued = false;
+    send_miner_template_notifications();
+  });
+}
+
+void Blockchain::send_miner_template_notifications()
+{
+  // the cookie is read first: a pool change racing the build gets published on the next update
+  const uint64_t pool_cookie = m_tx_pool.cookie();
+  const crypto::hash top_id = get_tail_id();
+  if (top_id == m_miner_template_prev_id && pool_cookie == m_miner_template_pool_cookie)
+    return;
+
+  cryptonote::account_public_address address;
+  blobdata ex_nonce;
+  {
+    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+    address = m_miner_template_address;
+    ex_nonce = m_miner_template_nonce;
+  }
+
+  block b;
+  difficulty_type diff;
+  uint64_t height, expected_reward, seed_height;
+  crypto::hash seed_hash;
+  if (!create_block_template(b, NULL, address, diff, height, expected_reward, ex_nonce, seed_height, seed_hash))
+  {
+    MWARNING("Failed to build block template for miner_template subscribers");
+    return;
+  }
+
+  const blobdata hashing_blob = get_block_hashing_blob(b);
+  const blobdata template_blob = block_to_blob(b);
+  uint64_t reserved_offset = 0;
+  if (!ex_nonce.empty())
+  {
+    // same layout as the getblocktemplate RPC: the reserve follows the tx pub key, its TX_EXTRA_NONCE tag and size
+    const crypto::public_key tx_pub_key = get_tx_pub_key_from_extra(b.miner_tx);
+    const size_t pos = template_blob.find(reinterpret_cast<const char*>(&tx_pub_key), 0, sizeof(tx_pub_key));
+    if (tx_pub_key == crypto::null_pkey || pos == blobdata::npos || pos + sizeof(tx_pub_key) + 2 + ex_nonce.size() > template_blob.size())
+    {
+      MERROR("Failed to find the reserved offset in the block template, not notifying miners");
+      return;
+    }
+    reserved_offset = pos + sizeof(tx_pub_key) + 2;
+  }
+
+  m_miner_template_prev_id = b.prev_id;
+  m_miner_template_pool_cookie = pool_cookie;
+  for (const auto& notifier : m_miner_template_notifiers)
+  {
+    notifier(height, seed_hash, diff, reserved_offset, hashing_blob, template_blob);
+  }
+}
 
 namespace cryptonote {
 template bool Blockchain::get_transactions(const std::vector<crypto::hash>&, std::vector<transaction>&, std::vector<crypto::hash>&, bool) const;
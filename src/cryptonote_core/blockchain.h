@@ -44,6 +44,7 @@
 #include <boost/multi_index/member.hpp>
 #include <atomic>
 #include <functional>
+#include <list>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -95,6 +96,7 @@ namespace cryptonote
   typedef boost::function<void(std::vector<txpool_event>)> TxpoolNotifyCallback;
   typedef boost::function<void(uint64_t /* height */, epee::span<const block> /* blocks */)> BlockNotifyCallback;
   typedef boost::function<void(uint8_t /* major_version */, uint64_t /* height */, const crypto::hash& /* prev_id */, const crypto::hash& /* seed_hash */, difficulty_type /* diff */, uint64_t /* median_weight */, uint64_t /* already_generated_coins */, const std::vector<tx_block_template_backlog_entry>& /* tx_backlog */)> MinerNotifyCallback;
+  typedef boost::function<void(uint64_t /* height */, const crypto::hash& /* seed_hash */, difficulty_type /* diff */, uint64_t /* reserved_offset */, const blobdata& /* hashing_blob */, const blobdata& /* template_blob */)> MinerTemplateNotifyCallback;
 
   /************************************************************************/
   /*                                                                      */
@@ -241,10 +243,11 @@ namespace cryptonote
      * @param h the hash to look for
      * @param blk return-by-reference variable to put result block in
      * @param orphan if non-NULL, will be set to true if not in the main chain, false otherwise
+     * @param with_quantum_signatures if false, main chain blocks are returned without their quantum signatures
      *
      * @return true if the block was found, else false
      */
-    bool get_block_by_hash(const crypto::hash &h, block &blk, bool *orphan = NULL) const;
+    bool get_block_by_hash(const crypto::hash &h, block &blk, bool *orphan = NULL, bool with_quantum_signatures = true) const;
 
     /**
      * @brief performs some preprocessing on a group of incoming blocks to speed up verification
@@ -510,12 +513,14 @@ namespace cryptonote
      * @param total_height return-by-reference our current blockchain height
      * @param start_height return-by-reference the height of the first block returned
      * @param pruned whether to return full or pruned tx blobs
+     * @param get_miner_tx_hash whether to calculate and return the miner (coinbase) tx hash
+     * @param with_quantum_signatures whether to return full block blobs, or blobs with empty quantum signatures
      * @param max_block_count the max number of blocks to get
      * @param max_tx_count the max number of txes to get (it can get overshot by the last block's number of txes minus 1)
      *
      * @return true if a block found in common or req_start_block specified, else false
      */
-    bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, bool get_miner_tx_hash, size_t max_block_count, size_t max_tx_count) const;
+    bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, bool get_miner_tx_hash, bool with_quantum_signatures, size_t max_block_count, size_t max_tx_count) const;
 
     /**
      * @brief retrieves a set of blocks and their transactions, and possibly other transactions
@@ -640,6 +645,21 @@ namespace cryptonote
      */
     bool check_tx_inputs(transaction& tx, uint64_t& pmax_used_block_height, crypto::hash& max_used_block_id, tx_verification_context &tvc, bool kept_by_block = false) const;
 
+    /**
+     * @brief verifies a transaction's ring signatures ahead of check_tx_inputs
+     *
+     * The ring members are looked up under the blockchain lock, but the
+     * signatures are verified without it and the result is remembered, so
+     * transactions can be verified concurrently before being added to the
+     * pool one at a time. Passing does not make the inputs valid,
+     * check_tx_inputs still runs every input check.
+     *
+     * @param tx the transaction to verify, its rct signatures are expanded
+     *
+     * @return false if the ring members could not be found or the signatures do not verify
+     */
+    bool preverify_tx_inputs(transaction& tx) const;
+
     /**
      * @brief get fee quantization mask
      *
@@ -862,6 +882,33 @@ namespace cryptonote
      */
     void add_miner_notify(MinerNotifyCallback&& notify);
 
+    /**
+     * @brief sets a miner template notify object to call for every new block template
+     *
+     * @param notify the notify object to call whenever the chain or the pool changes
+     */
+    void add_miner_template_notify(MinerTemplateNotifyCallback&& notify);
+
+    /**
+     * @brief sets the address the templates published to miner template notifiers pay to
+     *
+     * Nothing is published until this is set.  The templates go through
+     * create_block_template, so they share its cache with RPC callers
+     * asking for the same address and reserve size.
+     *
+     * @param address the address the coinbase pays to
+     * @param reserve_size size of the extra nonce reserved in the coinbase
+     */
+    void set_miner_template_address(const cryptonote::account_public_address &address, size_t reserve_size);
+
+    /**
+     * @brief queues a new template for miner template notifiers if the chain or the pool changed
+     *
+     * Only used with deferred quantum signing, so publishing never uses up
+     * one-time signing keys.
+     */
+    void update_miner_template();
+
     /**
      * @brief sets a reorg notify object to call for every reorg
      *
@@ -869,6 +916,34 @@ namespace cryptonote
      */
     void set_reorg_notify(const std::shared_ptr<tools::Notify> &notify) { m_reorg_notify = notify; }
 
+    /**
+     * @brief sets the long-lived signer used for block templates and genesis
+     *
+     * @param signer the signer, shared with the miner
+     */
+    void set_quantum_signer(const std::shared_ptr<crypto::quantum_safe_signer> &signer) { m_quantum_signer = signer; }
+
+    /**
+     * @brief sets whether block templates are signed or only carry reserved signature slots
+     *
+     * Signed templates each use up a one-time XMSS key of the signer, so
+     * busy pools should defer signing to keep key rotation and key file
+     * writes down to found blocks.
+     *
+     * @param defer true to leave signing to whoever submits the found block
+     */
+    void set_defer_quantum_signing(bool defer) { m_defer_quantum_signing = defer; }
+
+    /**
+     * @brief sets whether the next block template is built in the background when a block is added
+     *
+     * Only used with deferred quantum signing, forced or not, where a cached
+     * template is complete, and only while templates are being requested.
+     *
+     * @param prebuild true to rebuild the last requested template as soon as the chain moves on
+     */
+    void set_prebuild_block_templates(bool prebuild) { m_prebuild_block_templates = prebuild; }
+
     /**
      * @brief Notify this Blockchain's txpool notifier about a txpool event
      */
@@ -1072,6 +1147,18 @@ namespace cryptonote
     void output_scan_worker(const uint64_t amount,const std::vector<uint64_t> &offsets,
         std::vector<output_data_t> &outputs) const;
 
+    /**
+     * @brief checks whether a height is covered by the compiled in block hashes
+     *
+     * Such blocks are only compared against the expected hash, so their PoW
+     * and quantum signatures need not be computed while preparing them.
+     *
+     * @param height the block height
+     *
+     * @return true if an expected hash is known for that height
+     */
+    bool has_expected_block_hash(uint64_t height) const;
+
     /**
      * @brief computes the "short" and "long" hashes for a set of blocks
      *
@@ -1082,6 +1169,18 @@ namespace cryptonote
     void block_longhash_worker(uint64_t height, const epee::span<const block> &blocks,
         std::unordered_map<crypto::hash, crypto::hash> &map) const;
 
+    /**
+     * @brief runs the quantum signature format check on a set of blocks
+     *
+     * Blocks from before HF_VERSION_BLOCK_SIGNATURE_FORMAT are skipped.
+     *
+     * @param height the height of the first block
+     * @param blocks the blocks to be checked
+     * @param map return-by-reference whether each block's signatures pass the check
+     */
+    void block_signature_format_worker(uint64_t height, const epee::span<const block> &blocks,
+        std::unordered_map<crypto::hash, bool> &map) const;
+
     /**
      * @brief returns a set of known alternate chains
      *
@@ -1098,6 +1197,40 @@ namespace cryptonote
     cryptonote::blobdata get_txpool_tx_blob(const crypto::hash& txid, relay_category tx_category) const;
     bool for_all_txpool_txes(std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata_ref*)>, bool include_blob = false, relay_category tx_category = relay_category::broadcasted) const;
     bool txpool_tx_matches_category(const crypto::hash& tx_hash, relay_category category);
+    bool txpool_has_tx(const crypto::hash &txid, relay_category tx_category) const;
+
+    /**
+     * @brief sets whether txpool writes are deferred and batched
+     *
+     * In write-behind mode, add/update/remove_txpool_tx only record the change
+     * in memory, and the txpool accessors above see it straight away. The
+     * changes reach the db when flush_txpool_writes is called, so at most the
+     * changes since the last flush are lost on a crash. Turning the mode off
+     * flushes first.
+     *
+     * @param write_behind true to defer txpool writes
+     */
+    void set_txpool_write_behind(bool write_behind);
+
+    /**
+     * @brief gets whether txpool writes are deferred and batched
+     */
+    bool get_txpool_write_behind() const { return m_txpool_write_behind; }
+
+    /**
+     * @brief writes all deferred txpool changes to the db in one transaction
+     *
+     * Nothing is written while another db batch is open, since that batch
+     * could still abort; the changes are kept for the next flush.
+     *
+     * @return the number of txpool txes written, 0 if none were (the changes are kept)
+     */
+    size_t flush_txpool_writes();
+
+    /**
+     * @brief gets the number of txpool txes with deferred changes
+     */
+    size_t get_txpool_pending_write_count() const;
 
     bool is_within_compiled_block_hash_area() const { return is_within_compiled_block_hash_area(m_db->height()); }
     uint64_t prevalidate_block_hashes(uint64_t height, const std::vector<crypto::hash> &hashes, const std::vector<uint64_t> &weights);
@@ -1164,6 +1297,7 @@ namespace cryptonote
     difficulty_type get_pow_fork_reset_difficulty() const;
     bool is_pow_fork_active(uint64_t height) const;
     uint64_t get_pow_min_block_time() const;
+    size_t get_pow_difficulty_inputs_size(size_t count, uint64_t height) const;
     void trim_pow_difficulty_inputs(std::vector<uint64_t> &timestamps, std::vector<difficulty_type> &difficulties, uint64_t height) const;
 
     // TODO: evaluate whether or not each of these typedefs are left over from blockchain_storage
@@ -1187,6 +1321,7 @@ namespace cryptonote
     // metadata containers
     std::unordered_map<crypto::hash, std::unordered_map<crypto::key_image, std::vector<output_data_t>>> m_scan_table;
     std::unordered_map<crypto::hash, crypto::hash> m_blocks_longhash_table;
+    std::unordered_map<crypto::hash, bool> m_signature_format_table;
 
     // Keccak hashes for each block and for fast pow checking
     std::vector<std::pair<crypto::hash, crypto::hash>> m_blocks_hash_of_hashes;
@@ -1203,8 +1338,7 @@ namespace cryptonote
     uint64_t m_fake_scan_time;
     uint64_t m_sync_counter;
     uint64_t m_bytes_to_sync;
-    std::vector<uint64_t> m_timestamps;
-    std::vector<difficulty_type> m_difficulties;
+    difficulty_window m_difficulty_window;
     uint64_t m_timestamps_and_difficulties_height;
     bool m_reset_timestamps_and_difficulties_height;
     uint64_t m_long_term_block_weights_window;
@@ -1246,6 +1380,9 @@ namespace cryptonote
     crypto::hash m_btc_seed_hash;
     uint64_t m_btc_seed_height;
     bool m_btc_valid;
+    std::atomic<uint64_t> m_btc_last_request; //!< when a template was last requested through create_block_template, 0 if never
+    bool m_prebuild_block_templates;
+    std::atomic<bool> m_btc_prebuild_queued;
 
 
     bool m_batch_success;
@@ -1253,14 +1390,36 @@ namespace cryptonote
     TxpoolNotifyCallback m_txpool_notifier;
     mutable std::mutex m_txpool_notifier_mutex;
 
+    // a deferred txpool change: removal, full (re)write, or metadata update
+    struct txpool_pending_write
+    {
+      bool removed;
+      bool has_blob;
+      cryptonote::blobdata blob;
+      txpool_tx_meta_t meta;
+    };
+    bool m_txpool_write_behind;
+    std::unordered_map<crypto::hash, txpool_pending_write> m_txpool_pending_writes;
+    mutable epee::critical_section m_txpool_pending_writes_lock;
+
     /* `boost::function` is used because the implementation never allocates if
        the callable object has a single `std::shared_ptr` or `std::weap_ptr`
        internally. Whereas, the libstdc++ `std::function` will allocate. */
 
     std::vector<BlockNotifyCallback> m_block_notifiers;
     std::vector<MinerNotifyCallback> m_miner_notifiers;
+    std::vector<MinerTemplateNotifyCallback> m_miner_template_notifiers;
+    cryptonote::account_public_address m_miner_template_address;
+    blobdata m_miner_template_nonce;
+    bool m_miner_template_address_set;
+    crypto::hash m_miner_template_prev_id;
+    uint64_t m_miner_template_pool_cookie;
+    std::atomic<bool> m_miner_template_queued;
     std::shared_ptr<tools::Notify> m_reorg_notify;
 
+    std::shared_ptr<crypto::quantum_safe_signer> m_quantum_signer;
+    bool m_defer_quantum_signing;
+
     // for prepare_handle_incoming_blocks
     uint64_t m_prepare_height;
     uint64_t m_prepare_nblocks;
@@ -1629,11 +1788,18 @@ namespace cryptonote
 
     /**
      * @brief stores a new cached block template
-     *
-     * At some point, may be used to push an update to miners
      */
     void cache_block_template(const block &b, const cryptonote::account_public_address &address, const blobdata &nonce, const difficulty_type &diff, uint64_t height, uint64_t expected_reward, uint64_t seed_height, const crypto::hash &seed_hash, uint64_t pool_cookie);
 
+    /**
+     * @brief queues a rebuild of the cached block template on the async service
+     *
+     * Uses the address and extra nonce of the last cached template, so the
+     * first request after a new block is served from the cache. Does nothing
+     * once no template was requested for BLOCK_TEMPLATE_PREBUILD_IDLE_SECONDS.
+     */
+    void prebuild_block_template();
+
     /**
      * @brief sends new block notifications to ZMQ `miner_data` subscribers
      *
@@ -1643,5 +1809,13 @@ namespace cryptonote
      * @param already_generated_coins total coins mined by the network so far
      */
     void send_miner_notifications(uint64_t height, const crypto::hash &seed_hash, const crypto::hash &prev_id, uint64_t already_generated_coins);
+
+    /**
+     * @brief builds a template for the configured address and sends it to ZMQ `miner_template` subscribers
+     *
+     * Nothing is sent unless the chain tip or the pool cookie moved since
+     * the last template published.
+     */
+    void send_miner_template_notifications();
   };
 }  // namespace cryptonote
@@ -34,6 +34,7 @@
 #include "string_tools.h"
 using namespace epee;
 
+#include <atomic>
 #include <unordered_set>
 #include "cryptonote_core.h"
 #include "common/util.h"
@@ -182,6 +183,11 @@ namespace cryptonote
   , "Set maximum txpool weight in bytes."
   , DEFAULT_TXPOOL_MAX_WEIGHT
   };
+  static const command_line::arg_descriptor<bool> arg_txpool_write_behind  = {
+    "txpool-write-behind"
+  , "Defer txpool db writes and flush them in batches every few seconds (the latest txpool changes may be lost on a crash)"
+  , false
+  };
   static const command_line::arg_descriptor<std::string> arg_block_notify = {
     "block-notify"
   , "Run a program for each new block, '%s' will be replaced by the block hash"
@@ -217,13 +223,53 @@ namespace cryptonote
   , "Keep alternative blocks on restart"
   , false
   };
+  const command_line::arg_descriptor<std::string> arg_quantum_key_file = {
+    "quantum-key-file"
+  , "Path to quantum-safe key file containing BOTH XMSS and SPHINCS+ keys - REQUIRED"
+  , ""
+  };
+  const command_line::arg_descriptor<uint32_t> arg_xmss_tree_height = {
+    "xmss-tree-height"
+  , "XMSS tree height (default: 10, max: 20) - REQUIRED for dual enforcement"
+  , 10
+  };
+  const command_line::arg_descriptor<uint32_t> arg_sphincs_level = {
+    "sphincs-level"
+  , "SPHINCS+ tree level (default: 5, max: 10) - REQUIRED for dual enforcement"
+  , 5
+  };
+  static const command_line::arg_descriptor<bool> arg_quantum_deferred_signing = {
+    "quantum-deferred-signing"
+  , "Hand out block templates with reserved quantum signature slots and sign only blocks that are found. "
+    "Recommended for pools: otherwise every template uses up a one-time XMSS key, and new keys are generated "
+    "and written to the key file every 2^xmss-tree-height templates"
+  , false
+  };
+  static const command_line::arg_descriptor<bool> arg_prebuild_block_template = {
+    "prebuild-block-template"
+  , "Build the next block template in the background as soon as a block is added, while templates are being requested (with deferred quantum signing)"
+  , false
+  };
+  static const command_line::arg_descriptor<std::string> arg_miner_template_address = {
+    "miner-template-address"
+  , "Address paid by the block templates pushed to ZMQ miner_template subscribers (with --quantum-deferred-signing)"
+  , ""
+  };
+  static const command_line::arg_descriptor<uint32_t> arg_miner_template_reserve_size = {
+    "miner-template-reserve-size"
+  , "Bytes reserved in the coinbase of the block templates pushed to ZMQ miner_template subscribers"
+  , 8
+  };
 
   //-----------------------------------------------------------------------------------------------
   core::core(i_cryptonote_protocol* pprotocol):
               m_mempool(m_blockchain_storage),
               m_blockchain_storage(m_mempool),
+              m_quantum_signer(std::make_shared<crypto::quantum_safe_signer>()),
               m_miner(this, [this](const cryptonote::block &b, uint64_t height, const crypto::hash *seed_hash, unsigned int threads, crypto::hash &hash) {
                 return cryptonote::get_block_longhash(&m_blockchain_storage, b, hash, height, seed_hash, threads);
+              }, [this](cryptonote::blobdata &bd, size_t nonce_offset, uint32_t nonce, uint32_t nonce_step, size_t count, uint64_t height, int major_version, const crypto::hash *seed_hash, unsigned int threads, const std::function<bool(uint32_t, const crypto::hash&)> &on_hash) {
+                return cryptonote::get_block_longhashes(&m_blockchain_storage, bd, nonce_offset, nonce, nonce_step, count, height, major_version, seed_hash, on_hash);
               }),
               m_starter_message_showed(false),
               m_target_blockchain_height(0),
@@ -334,11 +380,19 @@ namespace cryptonote
     command_line::add_arg(desc, arg_block_download_max_size);
     command_line::add_arg(desc, arg_sync_pruned_blocks);
     command_line::add_arg(desc, arg_max_txpool_weight);
+    command_line::add_arg(desc, arg_txpool_write_behind);
     command_line::add_arg(desc, arg_block_notify);
     command_line::add_arg(desc, arg_prune_blockchain);
     command_line::add_arg(desc, arg_reorg_notify);
     command_line::add_arg(desc, arg_block_rate_notify);
     command_line::add_arg(desc, arg_keep_alt_blocks);
+    command_line::add_arg(desc, arg_quantum_key_file);
+    command_line::add_arg(desc, arg_xmss_tree_height);
+    command_line::add_arg(desc, arg_sphincs_level);
+    command_line::add_arg(desc, arg_quantum_deferred_signing);
+    command_line::add_arg(desc, arg_prebuild_block_template);
+    command_line::add_arg(desc, arg_miner_template_address);
+    command_line::add_arg(desc, arg_miner_template_reserve_size);
 
     miner::init_options(desc);
     BlockchainDB::init_options(desc);
@@ -469,6 +523,7 @@ namespace cryptonote
     uint64_t blocks_threads = command_line::get_arg(vm, arg_prep_blocks_threads);
     std::string check_updates_string = command_line::get_arg(vm, arg_check_updates);
     size_t max_txpool_weight = command_line::get_arg(vm, arg_max_txpool_weight);
+    bool txpool_write_behind = command_line::get_arg(vm, arg_txpool_write_behind);
     bool prune_blockchain = command_line::get_arg(vm, arg_prune_blockchain);
     bool keep_alt_blocks = command_line::get_arg(vm, arg_keep_alt_blocks);
     bool keep_fakechain = command_line::get_arg(vm, arg_keep_fakechain);
@@ -661,6 +716,31 @@ namespace cryptonote
       regtest_hard_forks,
       0
     };
+    uint32_t xmss_height = command_line::get_arg(vm, arg_xmss_tree_height);
+    uint32_t sphincs_level = command_line::get_arg(vm, arg_sphincs_level);
+    if (xmss_height == 0 || xmss_height > 20)
+      xmss_height = QSF_DEFAULT_XMSS_TREE_HEIGHT;
+    if (sphincs_level == 0 || sphincs_level > 10)
+      sphincs_level = QSF_DEFAULT_SPHINCS_LEVEL;
+    r = m_quantum_signer->init(command_line::get_arg(vm, arg_quantum_key_file), xmss_height, sphincs_level);
+    CHECK_AND_ASSERT_MES(r, false, "Failed to initialize quantum-safe signer");
+    m_blockchain_storage.set_quantum_signer(m_quantum_signer);
+    m_blockchain_storage.set_defer_quantum_signing(command_line::get_arg(vm, arg_quantum_deferred_signing));
+    m_blockchain_storage.set_prebuild_block_templates(command_line::get_arg(vm, arg_prebuild_block_template));
+    const std::string miner_template_address = command_line::get_arg(vm, arg_miner_template_address);
+    if (!miner_template_address.empty())
+    {
+      address_parse_info info;
+      const uint32_t reserve_size = command_line::get_arg(vm, arg_miner_template_reserve_size);
+      CHECK_AND_ASSERT_MES(get_account_address_from_str(info, m_nettype, miner_template_address) && !info.is_subaddress, false,
+          "Invalid --" << arg_miner_template_address.name << ", expected a standard address");
+      CHECK_AND_ASSERT_MES(reserve_size <= 255, false, "--" << arg_miner_template_reserve_size.name << " must be at most 255");
+      CHECK_AND_ASSERT_MES(command_line::get_arg(vm, arg_quantum_deferred_signing), false,
+          "--" << arg_miner_template_address.name << " requires --" << arg_quantum_deferred_signing.name);
+      m_blockchain_storage.set_miner_template_address(info.address, reserve_size);
+    }
+    m_miner.set_quantum_signer(m_quantum_signer);
+
     const difficulty_type fixed_difficulty = command_line::get_arg(vm, arg_fixed_difficulty);
     r = m_blockchain_storage.init(db.release(), m_nettype, m_offline, regtest ? &regtest_test_options : test_options, fixed_difficulty, get_checkpoints);
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize blockchain storage");
@@ -668,6 +748,10 @@ namespace cryptonote
     r = m_mempool.init(max_txpool_weight, m_nettype == FAKECHAIN);
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize memory pool");
 
+    // the pool was just reloaded from the db, defer writes from here on
+    if (txpool_write_behind)
+      m_blockchain_storage.set_txpool_write_behind(true);
+
     // now that we have a valid m_blockchain_storage, we can clean out any
     // transactions in the pool that do not conform to the current fork
     m_mempool.validate(m_blockchain_storage.get_current_hard_fork_version());
@@ -740,6 +824,8 @@ namespace cryptonote
     m_miner.stop();
     m_mempool.deinit();
     m_blockchain_storage.deinit();
+    if (!m_quantum_signer->store())
+      MERROR("Failed to store quantum-safe keys");
     return true;
   }
   //-----------------------------------------------------------------------------------------------
@@ -769,14 +855,8 @@ namespace cryptonote
     return false;
   }
   //-----------------------------------------------------------------------------------------------
-  bool core::handle_incoming_tx(const blobdata& tx_blob, tx_verification_context& tvc, relay_method tx_relay, bool relayed)
+  bool core::handle_incoming_tx_pre(const blobdata& tx_blob, tx_verification_context& tvc, transaction& tx, crypto::hash& txid, uint8_t version, uint8_t& nic_verified_hf_version, bool kept_by_block)
   {
-    tvc = {};
-
-    TRY_ENTRY();
-
-    CRITICAL_REGION_LOCAL(m_incoming_tx_lock);
-
     if (tx_blob.size() > get_max_tx_size())
     {
       LOG_PRINT_L1("WRONG TRANSACTION BLOB, too big size " << tx_blob.size() << ", rejected");
@@ -785,8 +865,6 @@ namespace cryptonote
       return false;
     }
 
-    transaction tx;
-    crypto::hash txid;
     if (!parse_and_validate_tx_from_blob(tx_blob, tx, txid))
     {
       LOG_PRINT_L1("Incoming transactions failed to parse, rejected");
@@ -794,9 +872,37 @@ namespace cryptonote
       return false;
     }
 
+    // add_new_tx deals with the ones we already have
+    if (m_mempool.have_tx(txid, relay_category::legacy) || m_blockchain_storage.have_tx(txid))
+      return true;
+
+    if (!ver_non_input_consensus(tx, tvc, version))
+    {
+      LOG_PRINT_L1("transaction " << txid << " failed non-input consensus rule checks");
+      tvc.m_verifivation_failed = true;
+      return false;
+    }
+    nic_verified_hf_version = version;
+
+    if (!kept_by_block && !m_blockchain_storage.preverify_tx_inputs(tx))
+    {
+      LOG_PRINT_L1("tx " << txid << " used wrong inputs, rejected");
+      tvc.m_verifivation_failed = true;
+      tvc.m_invalid_input = true;
+      return false;
+    }
+
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::handle_incoming_tx_post(const blobdata& tx_blob, tx_verification_context& tvc, transaction& tx, const crypto::hash& txid, relay_method tx_relay, bool relayed, uint8_t nic_verified_hf_version)
+  {
     const uint64_t tx_weight = get_transaction_weight(tx, tx_blob.size());
-    if (!add_new_tx(tx, txid, tx_blob, tx_weight, tvc, tx_relay, relayed))
+    if (!add_new_tx(tx, txid, tx_blob, tx_weight, tvc, tx_relay, relayed, nic_verified_hf_version))
+    {
+      tvc.m_verifivation_failed = true;
       return false;
+    }
 
     if (tvc.m_verifivation_failed)
     {
@@ -817,7 +923,81 @@ namespace cryptonote
     MDEBUG("tx added to pool: " << txid);
 
     return true;
-    CATCH_ENTRY_L0("core::handle_incoming_tx()", false);
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::handle_incoming_txs(const epee::span<const blobdata> tx_blobs, epee::span<tx_verification_context> tvcs, relay_method tx_relay, bool relayed)
+  {
+    TRY_ENTRY();
+
+    CHECK_AND_ASSERT_MES(tx_blobs.size() == tvcs.size(), false, "tx_blobs and tvcs sizes mismatch");
+
+    const uint8_t version = m_blockchain_storage.get_current_hard_fork_version();
+    const bool kept_by_block = tx_relay == relay_method::block;
+    std::vector<transaction> txs(tx_blobs.size());
+    std::vector<crypto::hash> txids(tx_blobs.size(), crypto::null_hash);
+    std::vector<uint8_t> verified(tx_blobs.size(), 0);
+    std::vector<uint8_t> nic_verified_hf_versions(tx_blobs.size(), 0);
+    const auto offends = [](const tx_verification_context &tvc) {
+      return (tvc.m_verifivation_failed || tvc.m_verifivation_impossible) && !tvc.m_no_drop_offense;
+    };
+
+    // a tx reads as failed until it is judged, so the sender still gets
+    // dropped if the threadpool or an exception cuts the batch short
+    for (tx_verification_context &tvc: tvcs)
+    {
+      tvc = {};
+      tvc.m_verifivation_failed = true;
+    }
+
+    // parsing and signature checks need neither the pool nor m_incoming_tx_lock,
+    // so a batch is spread over the compute threads and only insertion is serialized
+    if (tx_blobs.size() == 1)
+    {
+      tvcs[0] = {};
+      verified[0] = handle_incoming_tx_pre(tx_blobs[0], tvcs[0], txs[0], txids[0], version, nic_verified_hf_versions[0], kept_by_block);
+    }
+    else
+    {
+      // once a tx would get the sender dropped, txs not yet started are skipped,
+      // so a bad batch costs at most one tx per compute thread past the offence
+      std::atomic<bool> abort(false);
+      tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+      tools::threadpool::waiter waiter(tpool);
+      for (size_t i = 0; i < tx_blobs.size(); ++i)
+      {
+        tpool.submit(&waiter, [&, i] {
+          // a skipped tx keeps the failed mark set above
+          if (abort)
+            return;
+          tvcs[i] = {};
+          verified[i] = handle_incoming_tx_pre(tx_blobs[i], tvcs[i], txs[i], txids[i], version, nic_verified_hf_versions[i], kept_by_block);
+          if (!verified[i] && offends(tvcs[i]))
+            abort = true;
+        });
+      }
+      if (!waiter.wait())
+        return false;
+    }
+
+    bool ok = true;
+    CRITICAL_REGION_LOCAL(m_incoming_tx_lock);
+    for (size_t i = 0; i < tx_blobs.size(); ++i)
+    {
+      if (verified[i] && handle_incoming_tx_post(tx_blobs[i], tvcs[i], txs[i], txids[i], tx_relay, relayed, nic_verified_hf_versions[i]))
+        continue;
+      ok = false;
+      // nothing past the first offence is added, the sender is dropped there
+      if (offends(tvcs[i]))
+        break;
+    }
+    return ok;
+
+    CATCH_ENTRY_L0("core::handle_incoming_txs()", false);
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::handle_incoming_tx(const blobdata& tx_blob, tx_verification_context& tvc, relay_method tx_relay, bool relayed)
+  {
+    return handle_incoming_txs({std::addressof(tx_blob), 1}, {std::addressof(tvc), 1}, tx_relay, relayed);
   }
   //-----------------------------------------------------------------------------------------------
   bool core::check_tx_semantic(const transaction& tx, tx_verification_context& tvc,
@@ -1061,7 +1241,7 @@ namespace cryptonote
     return m_blockchain_storage.get_total_transactions();
   }
   //-----------------------------------------------------------------------------------------------
-  bool core::add_new_tx(transaction& tx, const crypto::hash& tx_hash, const cryptonote::blobdata &blob, size_t tx_weight, tx_verification_context& tvc, relay_method tx_relay, bool relayed)
+  bool core::add_new_tx(transaction& tx, const crypto::hash& tx_hash, const cryptonote::blobdata &blob, size_t tx_weight, tx_verification_context& tvc, relay_method tx_relay, bool relayed, uint8_t nic_verified_hf_version)
   {
     if(m_mempool.have_tx(tx_hash, relay_category::legacy))
     {
@@ -1076,7 +1256,7 @@ namespace cryptonote
     }
 
     uint8_t version = m_blockchain_storage.get_current_hard_fork_version();
-    const bool res = m_mempool.add_tx(tx, tx_hash, blob, tx_weight, tvc, tx_relay, relayed, version);
+    const bool res = m_mempool.add_tx(tx, tx_hash, blob, tx_weight, tvc, tx_relay, relayed, version, nic_verified_hf_version);
 
     // If new incoming tx passed verification and entered the pool, notify ZMQ
     if (!tvc.m_verifivation_failed && tvc.m_added_to_pool && matches_category(tx_relay, relay_category::legacy))
@@ -1216,9 +1396,9 @@ namespace cryptonote
     return m_blockchain_storage.find_blockchain_supplement(qblock_ids, clip_pruned, resp);
   }
   //-----------------------------------------------------------------------------------------------
-  bool core::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, bool get_miner_tx_hash, size_t max_block_count, size_t max_tx_count) const
+  bool core::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, bool get_miner_tx_hash, bool with_quantum_signatures, size_t max_block_count, size_t max_tx_count) const
   {
-    return m_blockchain_storage.find_blockchain_supplement(req_start_block, qblock_ids, blocks, total_height, start_height, pruned, get_miner_tx_hash, max_block_count, max_tx_count);
+    return m_blockchain_storage.find_blockchain_supplement(req_start_block, qblock_ids, blocks, total_height, start_height, pruned, get_miner_tx_hash, with_quantum_signatures, max_block_count, max_tx_count);
   }
   //-----------------------------------------------------------------------------------------------
   bool core::get_outs(const COMMAND_RPC_GET_OUTPUTS_BIN::request& req, COMMAND_RPC_GET_OUTPUTS_BIN::response& res) const
@@ -1268,6 +1448,16 @@ namespace cryptonote
   bool core::handle_block_found(block& b, block_verification_context &bvc)
   {
     bvc = {};
+    if (has_reserved_quantum_signature_slots(b))
+    {
+      // deferred signing: sign the winning block over its final id
+      get_block_hash(b);
+      if (!add_quantum_safe_signatures_to_block(b, *m_quantum_signer))
+      {
+        MERROR("Block found, but failed to add quantum-safe signatures");
+        return false;
+      }
+    }
     m_miner.pause();
     std::vector<block_complete_entry> blocks;
     try
@@ -1490,7 +1680,11 @@ namespace cryptonote
   //-----------------------------------------------------------------------------------------------
   bool core::get_pool_transactions(std::vector<transaction>& txs, bool include_sensitive_data) const
   {
-    m_mempool.get_transactions(txs, include_sensitive_data);
+    std::vector<std::shared_ptr<const transaction>> pool_txs;
+    m_mempool.get_transactions(pool_txs, include_sensitive_data);
+    txs.reserve(pool_txs.size());
+    for (const std::shared_ptr<const transaction> &tx: pool_txs)
+      txs.push_back(*tx);
     return true;
   }
   //-----------------------------------------------------------------------------------------------
@@ -1505,6 +1699,11 @@ namespace cryptonote
     return m_mempool.get_pool_info(start_time, include_sensitive_txes, max_tx_count, added_txs, remaining_added_txids, removed_txs, incremental);
   }
   //-----------------------------------------------------------------------------------------------
+  void core::get_pool_changes(uint64_t log_id, uint64_t since_seq, bool include_sensitive_txes, uint64_t &current_log_id, uint64_t &seq, std::vector<crypto::hash>& added_txs, std::vector<crypto::hash>& removed_txs, bool& incremental) const
+  {
+    m_mempool.get_pool_changes(log_id, since_seq, include_sensitive_txes, current_log_id, seq, added_txs, removed_txs, incremental);
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::get_pool_transaction_stats(struct txpool_stats& stats, bool include_sensitive_data) const
   {
     m_mempool.get_transaction_stats(stats, include_sensitive_data);
@@ -1546,9 +1745,9 @@ namespace cryptonote
     return m_blockchain_storage.get_block_id_by_height(height);
   }
   //-----------------------------------------------------------------------------------------------
-  bool core::get_block_by_hash(const crypto::hash &h, block &blk, bool *orphan) const
+  bool core::get_block_by_hash(const crypto::hash &h, block &blk, bool *orphan, bool with_quantum_signatures) const
   {
-    return m_blockchain_storage.get_block_by_hash(h, blk, orphan);
+    return m_blockchain_storage.get_block_by_hash(h, blk, orphan, with_quantum_signatures);
   }
   //-----------------------------------------------------------------------------------------------
   std::string core::print_pool(bool short_format) const
@@ -1591,6 +1790,7 @@ namespace cryptonote
     m_diff_recalc_interval.do_call(boost::bind(&core::recalculate_difficulties, this));
     m_miner.on_idle();
     m_mempool.on_idle();
+    m_miner_template_interval.do_call(boost::bind(&core::update_miner_template, this));
     return true;
   }
   //-----------------------------------------------------------------------------------------------
@@ -1833,6 +2033,12 @@ namespace cryptonote
     return true;
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::update_miner_template()
+  {
+    m_blockchain_storage.update_miner_template();
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
   void core::flush_invalid_blocks()
   {
     m_blockchain_storage.flush_invalid_blocks();
@@ -71,6 +71,9 @@ namespace cryptonote
   extern const command_line::arg_descriptor<bool> arg_offline;
   extern const command_line::arg_descriptor<size_t> arg_block_download_max_size;
   extern const command_line::arg_descriptor<bool> arg_sync_pruned_blocks;
+  extern const command_line::arg_descriptor<std::string> arg_quantum_key_file;
+  extern const command_line::arg_descriptor<uint32_t> arg_xmss_tree_height;
+  extern const command_line::arg_descriptor<uint32_t> arg_sphincs_level;
 
   /************************************************************************/
   /*                                                                      */
@@ -128,6 +131,23 @@ namespace cryptonote
       */
      bool handle_incoming_tx(const blobdata& tx_blob, tx_verification_context& tvc, relay_method tx_relay, bool relayed);
 
+     /**
+      * @brief handles a list of incoming transactions
+      *
+      * Parses and verifies the transactions concurrently, then passes them
+      * along to the transaction pool one at a time.  Work stops at the first
+      * transaction that should get the sender dropped; the ones after it are
+      * not added to the pool.
+      *
+      * @param tx_blobs the txs to handle
+      * @param tvcs metadata about the transactions' validity, one per tx
+      * @param tx_relay how the transactions were received
+      * @param relayed whether or not the transactions were relayed to us
+      *
+      * @return true if all the transactions were accepted, false otherwise
+      */
+     bool handle_incoming_txs(epee::span<const blobdata> tx_blobs, epee::span<tx_verification_context> tvcs, relay_method tx_relay, bool relayed);
+
     /**
       * @brief handles a single incoming block
       *
@@ -416,7 +436,7 @@ namespace cryptonote
       *
       * @note see Blockchain::get_block_by_hash
       */
-     bool get_block_by_hash(const crypto::hash &h, block &blk, bool *orphan = NULL) const;
+     bool get_block_by_hash(const crypto::hash &h, block &blk, bool *orphan = NULL, bool with_quantum_signatures = true) const;
 
      /**
       * @copydoc Blockchain::get_alternative_blocks
@@ -482,7 +502,9 @@ namespace cryptonote
      bool pool_has_tx(const crypto::hash &txid) const;
 
      /**
-      * @copydoc tx_memory_pool::get_transactions
+      * @brief get copies of all transactions in the pool
+      *
+      * @param txs return-by-reference the list of transactions
       * @param include_sensitive_txes include private transactions
       *
       * @note see tx_memory_pool::get_transactions
@@ -522,6 +544,13 @@ namespace cryptonote
       */
      bool get_pool_info(time_t start_time, bool include_sensitive_txes, size_t max_tx_count, std::vector<std::pair<crypto::hash, tx_memory_pool::tx_details>>& added_txs, std::vector<crypto::hash>& remaining_added_txids, std::vector<crypto::hash>& removed_txs, bool& incremental) const;
 
+     /**
+      * @copydoc tx_memory_pool::get_pool_changes
+      *
+      * @note see tx_memory_pool::get_pool_changes
+      */
+     void get_pool_changes(uint64_t log_id, uint64_t since_seq, bool include_sensitive_txes, uint64_t &current_log_id, uint64_t &seq, std::vector<crypto::hash>& added_txs, std::vector<crypto::hash>& removed_txs, bool& incremental) const;
+
     /**
       * @copydoc tx_memory_pool::get_transactions
       * @param include_sensitive_txes include private transactions
@@ -594,7 +623,7 @@ namespace cryptonote
       *
       * @note see Blockchain::find_blockchain_supplement(const uint64_t, const std::list<crypto::hash>&, std::vector<std::pair<cryptonote::blobdata, std::vector<transaction> > >&, uint64_t&, uint64_t&, size_t) const
       */
-     bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, bool get_miner_tx_hash, size_t max_block_count, size_t max_tx_count) const;
+     bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, bool get_miner_tx_hash, bool with_quantum_signatures, size_t max_block_count, size_t max_tx_count) const;
 
      /**
       * @copydoc Blockchain::get_tx_outputs_gindexs
@@ -959,9 +988,36 @@ namespace cryptonote
       * @param tx_weight the weight of the transaction
       * @param tx_relay how the transaction was received
       * @param relayed whether or not the transaction was relayed to us
+      * @param nic_verified_hf_version hard fork the tx is known to pass the non-input consensus checks for, or 0
       *
       */
-     bool add_new_tx(transaction& tx, const crypto::hash& tx_hash, const cryptonote::blobdata &blob, size_t tx_weight, tx_verification_context& tvc, relay_method tx_relay, bool relayed);
+     bool add_new_tx(transaction& tx, const crypto::hash& tx_hash, const cryptonote::blobdata &blob, size_t tx_weight, tx_verification_context& tvc, relay_method tx_relay, bool relayed, uint8_t nic_verified_hf_version = 0);
+
+     /**
+      * @brief runs the checks on an incoming transaction that do not need the pool locked
+      *
+      * Safe to call concurrently for different transactions.
+      *
+      * @param tx_blob the tx to check
+      * @param tvc return-by-reference metadata about the transaction's validity
+      * @param tx return-by-reference the parsed transaction
+      * @param txid return-by-reference the transaction's hash
+      * @param version the current hard fork version
+      * @param nic_verified_hf_version return-by-reference set to version if the non-input consensus checks ran and passed
+      * @param kept_by_block whether the tx comes from a block, whose inputs are not checked here
+      *
+      * @return false if the transaction is invalid, otherwise true
+      */
+     bool handle_incoming_tx_pre(const blobdata& tx_blob, tx_verification_context& tvc, transaction& tx, crypto::hash& txid, uint8_t version, uint8_t& nic_verified_hf_version, bool kept_by_block);
+
+     /**
+      * @brief adds a transaction checked by handle_incoming_tx_pre to the pool
+      *
+      * @note must be called with m_incoming_tx_lock held
+      *
+      * @return false if the transaction was rejected, otherwise true
+      */
+     bool handle_incoming_tx_post(const blobdata& tx_blob, tx_verification_context& tvc, transaction& tx, const crypto::hash& txid, relay_method tx_relay, bool relayed, uint8_t nic_verified_hf_version);
 
      /**
       * @brief add a new transaction to the transaction pool
@@ -1056,6 +1112,13 @@ namespace cryptonote
       */
      bool recalculate_difficulties();
 
+     /**
+      * @brief publishes a new block template to ZMQ subscribers if the pool changed
+      *
+      * @return true
+      */
+     bool update_miner_template();
+
      bool m_test_drop_download = true; //!< whether or not to drop incoming blocks (for testing)
 
      uint64_t m_test_drop_download_height = 0; //!< height under which to drop incoming blocks, if doing so
@@ -1067,6 +1130,8 @@ namespace cryptonote
 
      epee::critical_section m_incoming_tx_lock; //!< incoming transaction lock
 
+     std::shared_ptr<crypto::quantum_safe_signer> m_quantum_signer; //!< block signer shared by templates, the miner and genesis
+
      //m_miner and m_miner_addres are probably temporary here
      miner m_miner; //!< miner instance
 
@@ -1081,6 +1146,7 @@ namespace cryptonote
      epee::math_helper::once_a_time_seconds<90, false> m_block_rate_interval; //!< interval for checking block rate
      epee::math_helper::once_a_time_seconds<60*60*5, true> m_blockchain_pruning_interval; //!< interval for incremental blockchain pruning
      epee::math_helper::once_a_time_seconds<60*60*24*7, false> m_diff_recalc_interval; //!< interval for recalculating difficulties
+     epee::math_helper::once_a_time_seconds<5, true> m_miner_template_interval; //!< interval for publishing pool changes to ZMQ miner_template subscribers
 
      std::atomic<bool> m_starter_message_showed; //!< has the "daemon will sync now" message been shown?
 
@@ -31,8 +31,10 @@
 #include <unordered_set>
 #include <random>
 #include <cstring>
+#include <algorithm>
 #include "include_base_utils.h"
 #include "string_tools.h"
+#include "int-util.h"
 using namespace epee;
 
 #include "common/apply_permutation.h"
@@ -651,6 +653,7 @@ namespace cryptonote
       block& bl
     , std::string const & genesis_tx
     , uint32_t nonce
+    , crypto::quantum_safe_signer *signer
     )
   {
     //genesis block
@@ -672,6 +675,14 @@ namespace cryptonote
     
     // Add quantum-safe signatures to genesis block - MANDATORY for QSF
     #if QSF_BLOCK_QUANTUM_VALIDATION
+    if (signer)
+    {
+      if (!add_quantum_safe_signatures_to_block(bl, *signer)) {
+        LOG_ERROR("Failed to add quantum-safe signatures to genesis block");
+        return false;
+      }
+      return true;
+    }
     try {
       crypto::quantum_safe_manager qmgr;
       if (!qmgr.has_dual_keys()) {
@@ -727,6 +738,21 @@ namespace cryptonote
     rx_slow_hash(seed_hash.data, bd.data(), bd.size(), res.data);
   }
 
+  static crypto::hash get_randomx_seed(const Blockchain *pbc, const uint64_t height, const crypto::hash *seed_hash)
+  {
+    const uint64_t seed_height = rx_seedheight(height);
+    crypto::hash hash;
+    if (pbc != NULL)
+    {
+      hash = seed_hash ? *seed_hash : pbc->get_pending_block_id_by_height(seed_height);
+    } else
+    {
+      memset(&hash, 0, sizeof(hash));  // only happens when generating genesis block
+    }
+    const uint64_t tweak_height = pbc ? pbc->get_randomx_tweak_height() : ::config::RANDOMX_TWEAK_HEIGHT;
+    return apply_randomx_fork_tweak(hash, seed_height, tweak_height);
+  }
+
   bool get_block_longhash(const Blockchain *pbc, const blobdata& bd, crypto::hash& res, const uint64_t height, const int major_version, const crypto::hash *seed_hash, const int miners)
   {
     // block 202612 bug workaround
@@ -738,17 +764,7 @@ namespace cryptonote
     }
     if (major_version >= RX_BLOCK_VERSION)
     {
-      const uint64_t seed_height = rx_seedheight(height);
-      crypto::hash hash;
-      if (pbc != NULL)
-      {
-        hash = seed_hash ? *seed_hash : pbc->get_pending_block_id_by_height(seed_height);
-      } else
-      {
-        memset(&hash, 0, sizeof(hash));  // only happens when generating genesis block
-      }
-      const uint64_t tweak_height = pbc ? pbc->get_randomx_tweak_height() : ::config::RANDOMX_TWEAK_HEIGHT;
-      const crypto::hash tweaked_seed = apply_randomx_fork_tweak(hash, seed_height, tweak_height);
+      const crypto::hash tweaked_seed = get_randomx_seed(pbc, height, seed_hash);
       rx_slow_hash(tweaked_seed.data, bd.data(), bd.size(), res.data);
     } else {
       const int pow_variant = major_version >= 7 ? major_version - 6 : 0;
@@ -757,6 +773,43 @@ namespace cryptonote
     return true;
   }
 
+  namespace
+  {
+    typedef std::function<bool(uint32_t, const crypto::hash&)> on_block_longhash_t;
+
+    int on_block_longhash(uint32_t nonce, const char *hash, void *arg)
+    {
+      crypto::hash h;
+      memcpy(h.data, hash, sizeof(h.data));
+      return (*(const on_block_longhash_t*)arg)(nonce, h) ? 1 : 0;
+    }
+  }
+
+  size_t get_block_longhashes(const Blockchain *pbc, blobdata& bd, const size_t nonce_offset, const uint32_t nonce, const uint32_t nonce_step, const size_t count, const uint64_t height, const int major_version, const crypto::hash *seed_hash, const std::function<bool(uint32_t, const crypto::hash&)> &on_hash)
+  {
+    CHECK_AND_ASSERT_MES(nonce_offset + sizeof(uint32_t) <= bd.size(), 0, "Invalid nonce offset in block hashing blob");
+    if (major_version >= RX_BLOCK_VERSION && height != 202612)
+    {
+      const crypto::hash tweaked_seed = get_randomx_seed(pbc, height, seed_hash);
+      return rx_slow_hash_pipeline(tweaked_seed.data, &bd[0], bd.size(), nonce_offset, nonce, nonce_step, count, on_block_longhash, const_cast<on_block_longhash_t*>(&on_hash));
+    }
+
+    size_t done = 0;
+    uint32_t n = nonce;
+    while (done < count)
+    {
+      const uint32_t le_nonce = SWAP32LE(n);
+      memcpy(&bd[nonce_offset], &le_nonce, sizeof(le_nonce));
+      crypto::hash h;
+      get_block_longhash(pbc, bd, h, height, major_version, seed_hash);
+      ++done;
+      if (on_hash(n, h))
+        break;
+      n += nonce_step;
+    }
+    return done;
+  }
+
   bool get_block_longhash(const Blockchain *pbc, const block& b, crypto::hash& res, const uint64_t height, const crypto::hash *seed_hash, const int miners)
   {
     blobdata bd = get_block_hashing_blob(b);
@@ -770,38 +823,44 @@ namespace cryptonote
     return p;
   }
   //---------------------------------------------------------------
+  static crypto::hash get_quantum_signing_hash(const block& b)
+  {
+    // For genesis blocks or blocks without hash, we need to create a temporary hash
+    crypto::hash block_hash;
+    if (b.is_hash_valid()) {
+      block_hash = b.hash;
+    } else {
+      // Create a hash from the block data for signing
+      // This is safe for genesis blocks since they don't have a prev_id
+      std::vector<uint8_t> block_data;
+      block_data.reserve(sizeof(b.major_version) + sizeof(b.minor_version) + 
+                        sizeof(b.timestamp) + sizeof(b.nonce) + 
+                        sizeof(b.miner_tx) + sizeof(b.tx_hashes));
+      
+      // Add block header fields
+      block_data.insert(block_data.end(), 
+                       reinterpret_cast<const uint8_t*>(&b.major_version),
+                       reinterpret_cast<const uint8_t*>(&b.major_version) + sizeof(b.major_version));
+      block_data.insert(block_data.end(),
+                       reinterpret_cast<const uint8_t*>(&b.minor_version),
+                       reinterpret_cast<const uint8_t*>(&b.minor_version) + sizeof(b.minor_version));
+      block_data.insert(block_data.end(),
+                       reinterpret_cast<const uint8_t*>(&b.timestamp),
+                       reinterpret_cast<const uint8_t*>(&b.timestamp) + sizeof(b.timestamp));
+      block_data.insert(block_data.end(),
+                       reinterpret_cast<const uint8_t*>(&b.nonce),
+                       reinterpret_cast<const uint8_t*>(&b.nonce) + sizeof(b.nonce));
+      
+      // Hash the block data
+      crypto::cn_fast_hash(block_data.data(), block_data.size(), block_hash);
+    }
+    return block_hash;
+  }
+  //---------------------------------------------------------------
   bool add_quantum_safe_signatures_to_block(block& b, const crypto::quantum_safe_manager& qmgr) {
     #if QSF_BLOCK_QUANTUM_VALIDATION
     try {
-      // For genesis blocks or blocks without hash, we need to create a temporary hash
-      crypto::hash block_hash;
-      if (b.is_hash_valid()) {
-        block_hash = b.hash;
-      } else {
-        // Create a hash from the block data for signing
-        // This is safe for genesis blocks since they don't have a prev_id
-        std::vector<uint8_t> block_data;
-        block_data.reserve(sizeof(b.major_version) + sizeof(b.minor_version) + 
-                          sizeof(b.timestamp) + sizeof(b.nonce) + 
-                          sizeof(b.miner_tx) + sizeof(b.tx_hashes));
-        
-        // Add block header fields
-        block_data.insert(block_data.end(), 
-                         reinterpret_cast<const uint8_t*>(&b.major_version),
-                         reinterpret_cast<const uint8_t*>(&b.major_version) + sizeof(b.major_version));
-        block_data.insert(block_data.end(),
-                         reinterpret_cast<const uint8_t*>(&b.minor_version),
-                         reinterpret_cast<const uint8_t*>(&b.minor_version) + sizeof(b.minor_version));
-        block_data.insert(block_data.end(),
-                         reinterpret_cast<const uint8_t*>(&b.timestamp),
-                         reinterpret_cast<const uint8_t*>(&b.timestamp) + sizeof(b.timestamp));
-        block_data.insert(block_data.end(),
-                         reinterpret_cast<const uint8_t*>(&b.nonce),
-                         reinterpret_cast<const uint8_t*>(&b.nonce) + sizeof(b.nonce));
-        
-        // Hash the block data
-        crypto::cn_fast_hash(block_data.data(), block_data.size(), block_hash);
-      }
+      const crypto::hash block_hash = get_quantum_signing_hash(b);
       
       // Create dual signature using both XMSS and SPHINCS+
       std::vector<uint8_t> dual_signature = qmgr.create_dual_signature(std::vector<uint8_t>(block_hash.data, block_hash.data + sizeof(block_hash.data)));
@@ -814,12 +873,19 @@ namespace cryptonote
                                                      dual_signature.begin() + QSF_XMSS_SIGNATURE_SIZE + QSF_SPHINCS_SIGNATURE_SIZE);
       } else {
         // Fallback: generate individual signatures
-        b.quantum_signatures.xmss_signature = qmgr.sign(block_hash, crypto::quantum_algorithm::XMSS);
-        b.quantum_signatures.sphincs_signature = qmgr.sign(block_hash, crypto::quantum_algorithm::SPHINCS_PLUS);
+        const std::vector<uint8_t> xmss_signature = qmgr.sign(block_hash, crypto::quantum_algorithm::XMSS);
+        const std::vector<uint8_t> sphincs_signature = qmgr.sign(block_hash, crypto::quantum_algorithm::SPHINCS_PLUS);
+        CHECK_AND_ASSERT_MES(xmss_signature.size() <= QSF_XMSS_SIGNATURE_SIZE && sphincs_signature.size() <= QSF_SPHINCS_SIGNATURE_SIZE, false,
+            "Unexpected quantum-safe signature sizes: " << xmss_signature.size() << ", " << sphincs_signature.size());
+        b.quantum_signatures.xmss_signature.assign(xmss_signature.begin(), xmss_signature.end());
+        b.quantum_signatures.sphincs_signature.assign(sphincs_signature.begin(), sphincs_signature.end());
       }
       
       // Get the dual public key
-      b.quantum_signatures.dual_public_key = qmgr.get_dual_public_key();
+      const std::vector<uint8_t> dual_public_key = qmgr.get_dual_public_key();
+      CHECK_AND_ASSERT_MES(dual_public_key.size() <= QSF_QUANTUM_KEY_SIZE, false,
+          "Unexpected quantum-safe dual public key size: " << dual_public_key.size());
+      b.quantum_signatures.dual_public_key.assign(dual_public_key.begin(), dual_public_key.end());
       
       LOG_PRINT_L2("Quantum-safe signatures added to block: XMSS=" << b.quantum_signatures.xmss_signature.size() 
                     << " bytes, SPHINCS=" << b.quantum_signatures.sphincs_signature.size() 
@@ -839,4 +905,60 @@ namespace cryptonote
     #endif
   }
   //---------------------------------------------------------------
+  bool add_quantum_safe_signatures_to_block(block& b, crypto::quantum_safe_signer& signer) {
+    #if QSF_BLOCK_QUANTUM_VALIDATION
+    const crypto::hash block_hash = get_quantum_signing_hash(b);
+
+    std::vector<uint8_t> dual_signature, dual_public_key;
+    if (!signer.sign(block_hash, dual_signature, dual_public_key))
+    {
+      LOG_ERROR("Failed to create quantum-safe dual signature for block");
+      return false;
+    }
+    CHECK_AND_ASSERT_MES(dual_signature.size() >= QSF_XMSS_SIGNATURE_SIZE + QSF_SPHINCS_SIGNATURE_SIZE, false,
+        "Unexpected quantum-safe dual signature size: " << dual_signature.size());
+
+    b.quantum_signatures.xmss_signature.assign(dual_signature.begin(), 
+                                              dual_signature.begin() + QSF_XMSS_SIGNATURE_SIZE);
+    b.quantum_signatures.sphincs_signature.assign(dual_signature.begin() + QSF_XMSS_SIGNATURE_SIZE,
+                                                 dual_signature.begin() + QSF_XMSS_SIGNATURE_SIZE + QSF_SPHINCS_SIGNATURE_SIZE);
+    CHECK_AND_ASSERT_MES(dual_public_key.size() <= QSF_QUANTUM_KEY_SIZE, false,
+        "Unexpected quantum-safe dual public key size: " << dual_public_key.size());
+    b.quantum_signatures.dual_public_key.assign(dual_public_key.begin(), dual_public_key.end());
+    return true;
+    #else
+    return add_quantum_safe_signatures_to_block(b, crypto::quantum_safe_manager());
+    #endif
+  }
+  //---------------------------------------------------------------
+  void reserve_quantum_signature_slots(block& b)
+  {
+    b.quantum_signatures.xmss_signature.assign(QSF_XMSS_SIGNATURE_SIZE, 0);
+    b.quantum_signatures.sphincs_signature.assign(QSF_SPHINCS_SIGNATURE_SIZE, 0);
+    b.quantum_signatures.dual_public_key.assign(QSF_QUANTUM_KEY_SIZE, 0);
+  }
+  //---------------------------------------------------------------
+  bool has_reserved_quantum_signature_slots(const block& b)
+  {
+    const auto is_zero = [](const auto &v) { return std::all_of(v.begin(), v.end(), [](uint8_t c) { return c == 0; }); };
+    return b.quantum_signatures.xmss_signature.size() == QSF_XMSS_SIGNATURE_SIZE
+        && b.quantum_signatures.sphincs_signature.size() == QSF_SPHINCS_SIGNATURE_SIZE
+        && is_zero(b.quantum_signatures.xmss_signature)
+        && is_zero(b.quantum_signatures.sphincs_signature);
+  }
+  //---------------------------------------------------------------
+  bool check_block_quantum_signature_format(const block& b, const crypto::hash& block_id)
+  {
+    // the block keeps the first QSF_XMSS_SIGNATURE_SIZE + QSF_SPHINCS_SIGNATURE_SIZE
+    // bytes of the dual signature, split in two
+    const auto &xmss = b.quantum_signatures.xmss_signature;
+    const auto &sphincs = b.quantum_signatures.sphincs_signature;
+    if (xmss.size() != QSF_XMSS_SIGNATURE_SIZE || sphincs.size() != QSF_SPHINCS_SIGNATURE_SIZE)
+      return false;
+    uint8_t dual_signature[QSF_XMSS_SIGNATURE_SIZE + QSF_SPHINCS_SIGNATURE_SIZE];
+    memcpy(dual_signature, xmss.data(), QSF_XMSS_SIGNATURE_SIZE);
+    memcpy(dual_signature + QSF_XMSS_SIGNATURE_SIZE, sphincs.data(), QSF_SPHINCS_SIGNATURE_SIZE);
+    return crypto::check_dual_signature_format(block_id, dual_signature, sizeof(dual_signature));
+  }
+  //---------------------------------------------------------------
 }
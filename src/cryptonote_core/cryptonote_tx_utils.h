@@ -42,6 +42,15 @@ namespace cryptonote
 
   //---------------------------------------------------------------
   bool add_quantum_safe_signatures_to_block(block& b, const crypto::quantum_safe_manager& qmgr);
+  bool add_quantum_safe_signatures_to_block(block& b, crypto::quantum_safe_signer& signer);
+
+  // Zero-filled signature slots of the final size, for templates signed only once mined
+  void reserve_quantum_signature_slots(block& b);
+  bool has_reserved_quantum_signature_slots(const block& b);
+
+  // Format check of the block's quantum signatures: well formed and naming block_id.
+  // The signer's public keys are not on chain, so this is not authentication
+  bool check_block_quantum_signature_format(const block& b, const crypto::hash& block_id);
 
   struct tx_source_entry
   {
@@ -145,10 +154,14 @@ namespace cryptonote
       block& bl
     , std::string const & genesis_tx
     , uint32_t nonce
+    , crypto::quantum_safe_signer *signer = NULL
     );
 
   class Blockchain;
   bool get_block_longhash(const Blockchain *pb, const blobdata& bd, crypto::hash& res, const uint64_t height, const int major_version, const crypto::hash *seed_hash, const int miners = 0);
+  // hashes count nonces (nonce, nonce + nonce_step, ...) patched into bd at nonce_offset, in order,
+  // until on_hash(nonce, hash) returns true; returns the number of hashes done
+  size_t get_block_longhashes(const Blockchain *pb, blobdata& bd, const size_t nonce_offset, const uint32_t nonce, const uint32_t nonce_step, const size_t count, const uint64_t height, const int major_version, const crypto::hash *seed_hash, const std::function<bool(uint32_t, const crypto::hash&)> &on_hash);
   bool get_block_longhash(const Blockchain *pb, const block& b, crypto::hash& res, const uint64_t height, const crypto::hash *seed_hash = nullptr, const int miners = 0);
   crypto::hash get_block_longhash(const Blockchain *pb, const block& b, const uint64_t height, const crypto::hash *seed_hash = nullptr, const int miners = 0);
   crypto::hash apply_randomx_fork_tweak(const crypto::hash &seed_hash, uint64_t seed_height, uint64_t activation_height);
@@ -130,6 +130,8 @@ namespace cryptonote
 
     m_added_txs_start_time = (time_t)0;
     m_removed_txs_start_time = (time_t)0;
+    m_parsed_txs_size = 0;
+    reset_pool_change_log();
     // We don't set these to "now" already here as we don't know how long it takes from construction
     // of the pool until it "goes to work". It's safer to set when the first actual txs enter the
     // corresponding lists.
@@ -248,16 +250,15 @@ namespace cryptonote
         memset(meta.padding, 0, sizeof(meta.padding));
         try
         {
-          if (kept_by_block)
-            m_parsed_tx_cache.insert(std::make_pair(id, tx));
           CRITICAL_REGION_LOCAL1(m_blockchain);
-          LockedTXN lock(m_blockchain.get_db());
+          LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
           if (!insert_key_images(tx, id, tx_relay))
             return false;
 
           m_blockchain.add_txpool_tx(id, blob, meta);
-          add_tx_to_transient_lists(id, fee / (double)(tx_weight ? tx_weight : 1), receive_time);
+          add_tx_to_transient_lists(id, fee / (double)(tx_weight ? tx_weight : 1), receive_time, !meta.matches(relay_category::broadcasted));
           lock.commit();
+          add_parsed_tx(tx, id, blob.size());
         }
         catch (const std::exception &e)
         {
@@ -277,12 +278,11 @@ namespace cryptonote
     {
       try
       {
-        if (kept_by_block)
-          m_parsed_tx_cache.insert(std::make_pair(id, tx));
         CRITICAL_REGION_LOCAL1(m_blockchain);
-        LockedTXN lock(m_blockchain.get_db());
+        LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
 
         const bool existing_tx = m_blockchain.get_txpool_tx_meta(id, meta);
+        bool stored = false;
         if (existing_tx)
         {
           /* If Dandelion++ loop. Do not use txes in the `local` state in the
@@ -327,9 +327,12 @@ namespace cryptonote
 
           m_blockchain.remove_txpool_tx(id);
           m_blockchain.add_txpool_tx(id, blob, meta);
-          add_tx_to_transient_lists(id, meta.fee / (double)(tx_weight ? tx_weight : 1), receive_time);
+          add_tx_to_transient_lists(id, meta.fee / (double)(tx_weight ? tx_weight : 1), receive_time, !meta.matches(relay_category::broadcasted));
+          stored = true;
         }
         lock.commit();
+        if (stored)
+          add_parsed_tx(tx, id, blob.size());
         tvc.m_added_to_pool = !existing_tx;
       }
       catch (const std::exception &e)
@@ -352,6 +355,9 @@ namespace cryptonote
 
     prune(m_txpool_max_weight);
 
+    if (m_blockchain.get_txpool_pending_write_count() >= TXPOOL_WRITE_BEHIND_MAX_PENDING)
+      m_blockchain.flush_txpool_writes();
+
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -404,7 +410,7 @@ namespace cryptonote
       bytes = m_txpool_max_weight;
 
     CRITICAL_REGION_LOCAL1(m_blockchain);
-    LockedTXN lock(m_blockchain.get_db());
+    LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
     bool changed = false;
 
     // this will never remove the first one, but we don't care
@@ -538,7 +544,7 @@ namespace cryptonote
     bool sensitive = false;
     try
     {
-      LockedTXN lock(m_blockchain.get_db());
+      LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
       txpool_tx_meta_t meta;
       if (!m_blockchain.get_txpool_tx_meta(id, meta))
       {
@@ -549,20 +555,13 @@ namespace cryptonote
         return false;
       }
       txblob = m_blockchain.get_txpool_tx_blob(id, relay_category::all);
-      auto ci = m_parsed_tx_cache.find(id);
-      if (ci != m_parsed_tx_cache.end())
-      {
-        tx = ci->second;
-      }
-      else if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(txblob, tx) : parse_and_validate_tx_from_blob(txblob, tx)))
+      const std::shared_ptr<const transaction> parsed_tx = get_parsed_tx(id, meta.pruned, txblob);
+      if (!parsed_tx)
       {
         MERROR("Failed to parse tx from txpool");
         return false;
       }
-      else
-      {
-        tx.set_hash(id);
-      }
+      tx = *parsed_tx;
       tx_weight = meta.weight;
       fee = meta.fee;
       relayed = meta.relayed;
@@ -596,7 +595,7 @@ namespace cryptonote
 
     try
     {
-      LockedTXN lock(m_blockchain.get_db());
+      LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
       txpool_tx_meta_t meta;
       if (!m_blockchain.get_txpool_tx_meta(txid, meta))
       {
@@ -609,20 +608,13 @@ namespace cryptonote
         return false;
       }
       cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(txid, relay_category::all);
-      auto ci = m_parsed_tx_cache.find(txid);
-      if (ci != m_parsed_tx_cache.end())
-      {
-        td.tx = ci->second;
-      }
-      else if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(txblob, td.tx) : parse_and_validate_tx_from_blob(txblob, td.tx)))
+      const std::shared_ptr<const transaction> parsed_tx = get_parsed_tx(txid, meta.pruned, txblob);
+      if (!parsed_tx)
       {
         MERROR("Failed to parse tx from txpool");
         return false;
       }
-      else
-      {
-        td.tx.set_hash(txid);
-      }
+      td.tx = parsed_tx;
       td.blob_size = txblob.size();
       td.weight = meta.weight;
       td.fee = meta.fee;
@@ -703,6 +695,7 @@ namespace cryptonote
   void tx_memory_pool::on_idle()
   {
     m_remove_stuck_tx_interval.do_call([this](){return remove_stuck_transactions();});
+    m_flush_txpool_writes_interval.do_call([this](){ m_blockchain.flush_txpool_writes(); return true; });
   }
   //---------------------------------------------------------------------------------
   sorted_tx_container::iterator tx_memory_pool::find_tx_in_sorted_container(const crypto::hash& id) const
@@ -736,7 +729,7 @@ namespace cryptonote
 
     if (!remove.empty())
     {
-      LockedTXN lock(m_blockchain.get_db());
+      LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
       for (const std::pair<crypto::hash, uint64_t> &entry: remove)
       {
         const crypto::hash &txid = entry.first;
@@ -783,7 +776,7 @@ namespace cryptonote
 
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     CRITICAL_REGION_LOCAL1(m_blockchain);
-    LockedTXN lock(m_blockchain.get_db());
+    LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
     txs.reserve(m_blockchain.get_txpool_tx_count());
     m_blockchain.for_all_txpool_txes([this, now, &txs, &change_timestamps, &next_check](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *){
       // 0 fee transactions are never relayed
@@ -858,7 +851,7 @@ namespace cryptonote
 
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     CRITICAL_REGION_LOCAL1(m_blockchain);
-    LockedTXN lock(m_blockchain.get_db());
+    LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
     for (const auto& hash : hashes)
     {
       bool was_just_broadcasted = false;
@@ -881,12 +874,15 @@ namespace cryptonote
             meta.last_relayed_time = std::chrono::system_clock::to_time_t(now);
 
           m_blockchain.update_txpool_tx(hash, meta);
+          const auto candidate = m_template_candidates.find(hash);
+          if (candidate != m_template_candidates.end())
+            candidate->second.relay = meta.get_relay_method();
           // wait until db update succeeds to ensure tx is visible in the pool
           was_just_broadcasted = !already_broadcasted && meta.matches(relay_category::broadcasted);
 
           if (was_just_broadcasted)
             // Make sure the tx gets re-added with an updated time
-            add_tx_to_transient_lists(hash, meta.fee / (double)meta.weight, std::chrono::system_clock::to_time_t(now));
+            add_tx_to_transient_lists(hash, meta.fee / (double)meta.weight, std::chrono::system_clock::to_time_t(now), false);
         }
       }
       catch (const std::exception &e)
@@ -907,22 +903,21 @@ namespace cryptonote
     return m_blockchain.get_txpool_tx_count(include_sensitive);
   }
   //---------------------------------------------------------------------------------
-  void tx_memory_pool::get_transactions(std::vector<transaction>& txs, bool include_sensitive) const
+  void tx_memory_pool::get_transactions(std::vector<std::shared_ptr<const transaction>>& txs, bool include_sensitive) const
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     CRITICAL_REGION_LOCAL1(m_blockchain);
     const relay_category category = include_sensitive ? relay_category::all : relay_category::broadcasted;
     txs.reserve(m_blockchain.get_txpool_tx_count(include_sensitive));
-    m_blockchain.for_all_txpool_txes([&txs](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
-      transaction tx;
-      if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(*bd, tx) : parse_and_validate_tx_from_blob(*bd, tx)))
+    m_blockchain.for_all_txpool_txes([this, &txs](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
+      const std::shared_ptr<const transaction> tx = get_parsed_tx(txid, meta.pruned, *bd);
+      if (!tx)
       {
         MERROR("Failed to parse tx from txpool");
         // continue
         return true;
       }
-      tx.set_hash(txid);
-      txs.push_back(std::move(tx));
+      txs.push_back(tx);
       return true;
     }, true, category);
   }
@@ -1014,6 +1009,47 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------
+  void tx_memory_pool::get_pool_changes(uint64_t log_id, uint64_t since_seq, bool include_sensitive, uint64_t &current_log_id, uint64_t &seq, std::vector<crypto::hash>& added_txs, std::vector<crypto::hash>& removed_txs, bool& incremental) const
+  {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    CRITICAL_REGION_LOCAL1(m_blockchain);
+
+    current_log_id = m_pool_change_log_id;
+    seq = m_pool_change_seq;
+    added_txs.clear();
+    removed_txs.clear();
+
+    // Changes are numbered without gaps, so the log covers since_seq if its
+    // first entry is at most the one right after it
+    incremental = log_id == m_pool_change_log_id && since_seq <= m_pool_change_seq &&
+      (since_seq == m_pool_change_seq || (!m_pool_changes.empty() && m_pool_changes.front().seq <= since_seq + 1));
+    if (!incremental)
+    {
+      LOG_PRINT_L2("Giving back the whole pool");
+      get_transaction_hashes(added_txs, include_sensitive);
+      return;
+    }
+    if (since_seq == m_pool_change_seq)
+      return;
+
+    // Only report the last change of each tx, so a tx that came and went is only
+    // reported as removed, and a stem tx that got fluffed is only reported once
+    std::unordered_map<crypto::hash, bool> last_change;
+    std::vector<crypto::hash> txids;
+    for (auto it = m_pool_changes.begin() + (since_seq + 1 - m_pool_changes.front().seq); it < m_pool_changes.end(); ++it)
+    {
+      if (it->sensitive && !include_sensitive)
+        continue;
+      const auto inserted = last_change.emplace(it->txid, it->added);
+      if (inserted.second)
+        txids.push_back(it->txid);
+      else
+        inserted.first->second = it->added;
+    }
+    for (const crypto::hash &txid: txids)
+      (last_change[txid] ? added_txs : removed_txs).push_back(txid);
+  }
+  //------------------------------------------------------------------
   void tx_memory_pool::get_transaction_backlog(std::vector<tx_backlog_entry>& backlog, bool include_sensitive) const
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
@@ -1067,12 +1103,12 @@ namespace cryptonote
         if (!m_blockchain.get_txpool_tx_blob(e.id, txblob, relay_category::all))
           continue;
 
-        cryptonote::transaction tx;
+        std::shared_ptr<const transaction> tx;
         if (is_transaction_ready_to_go(meta, e.id, txblob, tx))
         {
-          if (have_key_images(k_images, tx))
+          if (have_key_images(k_images, *tx))
             continue;
-          append_key_images(k_images, tx);
+          append_key_images(k_images, *tx);
 
           backlog.push_back(e);
           w += e.weight;
@@ -1183,19 +1219,18 @@ namespace cryptonote
     const size_t count = m_blockchain.get_txpool_tx_count(include_sensitive_data);
     tx_infos.reserve(count);
     key_image_infos.reserve(count);
-    m_blockchain.for_all_txpool_txes([&tx_infos, key_image_infos, include_sensitive_data](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
+    m_blockchain.for_all_txpool_txes([this, &tx_infos, key_image_infos, include_sensitive_data](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
       tx_info txi;
       txi.id_hash = epee::string_tools::pod_to_hex(txid);
       txi.tx_blob = blobdata(bd->data(), bd->size());
-      transaction tx;
-      if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(*bd, tx) : parse_and_validate_tx_from_blob(*bd, tx)))
+      const std::shared_ptr<const transaction> parsed_tx = get_parsed_tx(txid, meta.pruned, *bd);
+      if (!parsed_tx)
       {
         MERROR("Failed to parse tx from txpool");
         // continue
         return true;
       }
-      tx.set_hash(txid);
-      txi.tx_json = obj_to_json_str(tx);
+      txi.tx_json = obj_to_json_str(const_cast<transaction&>(*parsed_tx));
       txi.blob_size = bd->size();
       txi.weight = meta.weight;
       txi.fee = meta.fee;
@@ -1239,16 +1274,17 @@ namespace cryptonote
     CRITICAL_REGION_LOCAL1(m_blockchain);
     tx_infos.reserve(m_blockchain.get_txpool_tx_count());
     key_image_infos.reserve(m_blockchain.get_txpool_tx_count());
-    m_blockchain.for_all_txpool_txes([&tx_infos, key_image_infos](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
+    m_blockchain.for_all_txpool_txes([this, &tx_infos, key_image_infos](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
       cryptonote::rpc::tx_in_pool txi;
       txi.tx_hash = txid;
-      if (!(meta.pruned ? parse_and_validate_tx_base_from_blob(*bd, txi.tx) : parse_and_validate_tx_from_blob(*bd, txi.tx)))
+      const std::shared_ptr<const transaction> tx = get_parsed_tx(txid, meta.pruned, *bd);
+      if (!tx)
       {
         MERROR("Failed to parse tx from txpool");
         // continue
         return true;
       }
-      txi.tx.set_hash(txid);
+      txi.tx = tx;
       txi.blob_size = bd->size();
       txi.weight = meta.weight;
       txi.fee = meta.fee;
@@ -1321,7 +1357,8 @@ namespace cryptonote
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     m_input_cache.clear();
-    m_parsed_tx_cache.clear();
+    for (auto &e: m_template_candidates)
+      e.second.ready_known = false;
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -1329,7 +1366,8 @@ namespace cryptonote
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     m_input_cache.clear();
-    m_parsed_tx_cache.clear();
+    for (auto &e: m_template_candidates)
+      e.second.ready_known = false;
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -1337,7 +1375,7 @@ namespace cryptonote
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     CRITICAL_REGION_LOCAL1(m_blockchain);
-    return m_blockchain.get_db().txpool_has_tx(id, tx_category);
+    return m_blockchain.txpool_has_tx(id, tx_category);
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::have_tx_keyimges_as_spent(const transaction& tx, const crypto::hash& txid) const
@@ -1397,27 +1435,39 @@ namespace cryptonote
     return ret;
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::is_transaction_ready_to_go(txpool_tx_meta_t& txd, const crypto::hash &txid, const cryptonote::blobdata_ref& txblob, transaction &tx) const
+  bool tx_memory_pool::is_transaction_ready_to_go(txpool_tx_meta_t& txd, const crypto::hash &txid, const cryptonote::blobdata_ref& txblob, std::shared_ptr<const transaction> &tx) const
   {
     struct transaction_parser
     {
-      transaction_parser(const cryptonote::blobdata_ref &txblob, const crypto::hash &txid, transaction &tx): txblob(txblob), txid(txid), tx(tx), parsed(false) {}
-      cryptonote::transaction &operator()()
+      transaction_parser(const tx_memory_pool &pool, const cryptonote::blobdata_ref &txblob, const crypto::hash &txid, std::shared_ptr<const transaction> &tx): pool(pool), txblob(txblob), txid(txid), tx(tx), copied(false) {}
+      const std::shared_ptr<const transaction> &parsed()
       {
-        if (!parsed)
+        if (!tx)
         {
-          if (!parse_and_validate_tx_from_blob(txblob, tx))
+          tx = pool.get_parsed_tx(txid, false, txblob);
+          if (!tx || tx->pruned)
             throw std::runtime_error("failed to parse transaction blob");
-          tx.set_hash(txid);
-          parsed = true;
         }
         return tx;
       }
+      cryptonote::transaction &operator()()
+      {
+        // check_tx_inputs expands the ring into the tx, so it gets its own copy,
+        // only made when the result of the check is not cached yet
+        if (!copied)
+        {
+          copy = *parsed();
+          copied = true;
+        }
+        return copy;
+      }
+      const tx_memory_pool &pool;
       const cryptonote::blobdata_ref &txblob;
       const crypto::hash &txid;
-      transaction &tx;
-      bool parsed;
-    } lazy_tx(txblob, txid, tx);
+      std::shared_ptr<const transaction> &tx;
+      cryptonote::transaction copy;
+      bool copied;
+    } lazy_tx(*this, txblob, txid, tx);
 
     const std::uint64_t top_block_height{m_blockchain.get_current_blockchain_height() - 1};
     const crypto::hash top_block_hash{m_blockchain.get_block_id_by_height(top_block_height)};
@@ -1438,10 +1488,11 @@ namespace cryptonote
     }
 
     //transaction is ok.
+    lazy_tx.parsed(); // a cached check result left it unparsed
     return true;
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::is_transaction_ready_to_go(txpool_tx_meta_t& txd, const crypto::hash &txid, const cryptonote::blobdata& txblob, transaction &tx) const
+  bool tx_memory_pool::is_transaction_ready_to_go(txpool_tx_meta_t& txd, const crypto::hash &txid, const cryptonote::blobdata& txblob, std::shared_ptr<const transaction> &tx) const
   {
     return is_transaction_ready_to_go(txd, txid, cryptonote::blobdata_ref{txblob.data(), txblob.size()}, tx);
   }
@@ -1473,7 +1524,7 @@ namespace cryptonote
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     CRITICAL_REGION_LOCAL1(m_blockchain);
     bool changed = false;
-    LockedTXN lock(m_blockchain.get_db());
+    LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
     for(size_t i = 0; i!= tx.vin.size(); i++)
     {
       CHECKED_GET_SPECIFIC_VARIANT(tx.vin[i], const txin_to_key, itk, void());
@@ -1569,13 +1620,15 @@ namespace cryptonote
 
     LOG_PRINT_L2("Filling block template, median weight " << median_weight << ", " << m_txs_by_fee_and_receive_time.size() << " txes in the pool");
 
-    LockedTXN lock(m_blockchain.get_db());
+    LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
 
+    // weight, fee and key images come from m_template_candidates, only txes
+    // that would make it into the block are read from the db to check them
     auto sorted_it = m_txs_by_fee_and_receive_time.begin();
     for (; sorted_it != m_txs_by_fee_and_receive_time.end(); ++sorted_it)
     {
-      txpool_tx_meta_t meta;
-      if (!m_blockchain.get_txpool_tx_meta(sorted_it->second, meta))
+      template_candidate *candidate = get_template_candidate(sorted_it->second);
+      if (!candidate)
       {
         static bool warned = false;
         if (!warned)
@@ -1583,21 +1636,21 @@ namespace cryptonote
         warned = true;
         continue;
       }
-      LOG_PRINT_L2("Considering " << sorted_it->second << ", weight " << meta.weight << ", current block weight " << total_weight << "/" << max_total_weight << ", current coinbase " << print_money(best_coinbase) << ", relay method " << (unsigned)meta.get_relay_method());
+      LOG_PRINT_L2("Considering " << sorted_it->second << ", weight " << candidate->weight << ", current block weight " << total_weight << "/" << max_total_weight << ", current coinbase " << print_money(best_coinbase) << ", relay method " << (unsigned)candidate->relay);
 
-      if (!meta.matches(relay_category::legacy) && !(m_mine_stem_txes && meta.get_relay_method() == relay_method::stem))
+      if (!matches_category(candidate->relay, relay_category::legacy) && !(m_mine_stem_txes && candidate->relay == relay_method::stem))
       {
-        LOG_PRINT_L2("  tx relay method is " << (unsigned)meta.get_relay_method());
+        LOG_PRINT_L2("  tx relay method is " << (unsigned)candidate->relay);
         continue;
       }
-      if (meta.pruned)
+      if (candidate->pruned)
       {
         LOG_PRINT_L2("  tx is pruned");
         continue;
       }
 
       // Can not exceed maximum block weight
-      if (max_total_weight < total_weight + meta.weight)
+      if (max_total_weight < total_weight + candidate->weight)
       {
         LOG_PRINT_L2("  would exceed maximum block weight");
         continue;
@@ -1609,12 +1662,12 @@ namespace cryptonote
         // If we're getting lower coinbase tx,
         // stop including more tx
         uint64_t block_reward;
-        if(!get_block_reward(median_weight, total_weight + meta.weight, already_generated_coins, block_reward, version))
+        if(!get_block_reward(median_weight, total_weight + candidate->weight, already_generated_coins, block_reward, version))
         {
           LOG_PRINT_L2("  would exceed maximum block weight");
           continue;
         }
-        coinbase = block_reward + fee + meta.fee;
+        coinbase = block_reward + fee + candidate->fee;
         if (coinbase < template_accept_threshold(best_coinbase))
         {
           LOG_PRINT_L2("  would decrease coinbase to " << print_money(coinbase));
@@ -1632,53 +1685,62 @@ namespace cryptonote
         }
       }
 
-      // "local" and "stem" txes are filtered above
-      cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(sorted_it->second, relay_category::all);
-
-      cryptonote::transaction tx;
-
       // Skip transactions that are not ready to be
       // included into the blockchain or that are
-      // missing key images
-      const cryptonote::txpool_tx_meta_t original_meta = meta;
-      bool ready = false;
-      try
-      {
-        ready = is_transaction_ready_to_go(meta, sorted_it->second, txblob, tx);
-      }
-      catch (const std::exception &e)
-      {
-        MERROR("Failed to check transaction readiness: " << e.what());
-        // continue, not fatal
-      }
-      if (memcmp(&original_meta, &meta, sizeof(meta)))
+      // missing key images. The answer holds until
+      // the chain changes.
+      if (!candidate->ready_known)
       {
+        txpool_tx_meta_t meta;
+        if (!m_blockchain.get_txpool_tx_meta(sorted_it->second, meta))
+          continue;
+
+        // "local" and "stem" txes are filtered above
+        cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(sorted_it->second, relay_category::all);
+
+        std::shared_ptr<const transaction> tx;
+        const cryptonote::txpool_tx_meta_t original_meta = meta;
+        bool ready = false;
         try
-	{
-	  m_blockchain.update_txpool_tx(sorted_it->second, meta);
-	}
+        {
+          ready = is_transaction_ready_to_go(meta, sorted_it->second, txblob, tx);
+        }
         catch (const std::exception &e)
-	{
-	  MERROR("Failed to update tx meta: " << e.what());
-	  // continue, not fatal
-	}
+        {
+          MERROR("Failed to check transaction readiness: " << e.what());
+          // continue, not fatal
+        }
+        if (memcmp(&original_meta, &meta, sizeof(meta)))
+        {
+          try
+          {
+            m_blockchain.update_txpool_tx(sorted_it->second, meta);
+          }
+          catch (const std::exception &e)
+          {
+            MERROR("Failed to update tx meta: " << e.what());
+            // continue, not fatal
+          }
+        }
+        candidate->ready = ready;
+        candidate->ready_known = true;
       }
-      if (!ready)
+      if (!candidate->ready)
       {
         LOG_PRINT_L2("  not ready to go");
         continue;
       }
-      if (have_key_images(k_images, tx))
+      if (std::any_of(candidate->key_images.begin(), candidate->key_images.end(), [&k_images](const crypto::key_image &k_image) { return k_images.count(k_image) != 0; }))
       {
         LOG_PRINT_L2("  key images already seen");
         continue;
       }
 
       bl.tx_hashes.push_back(sorted_it->second);
-      total_weight += meta.weight;
-      fee += meta.fee;
+      total_weight += candidate->weight;
+      fee += candidate->fee;
       best_coinbase = coinbase;
-      append_key_images(k_images, tx);
+      k_images.insert(candidate->key_images.begin(), candidate->key_images.end());
       LOG_PRINT_L2("  added, new block weight " << total_weight << "/" << max_total_weight << ", coinbase " << print_money(best_coinbase));
     }
     lock.commit();
@@ -1690,6 +1752,89 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------------------------
+  tx_memory_pool::template_candidate *tx_memory_pool::get_template_candidate(const crypto::hash &txid)
+  {
+    auto it = m_template_candidates.find(txid);
+    if (it != m_template_candidates.end())
+      return &it->second;
+
+    try
+    {
+      txpool_tx_meta_t meta;
+      if (!m_blockchain.get_txpool_tx_meta(txid, meta))
+        return NULL;
+      const cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(txid, relay_category::all);
+      cryptonote::transaction_prefix tx;
+      if (!parse_and_validate_tx_prefix_from_blob(txblob, tx))
+      {
+        MERROR("Failed to parse tx from txpool: " << txid);
+        return NULL;
+      }
+
+      template_candidate candidate{};
+      candidate.weight = meta.weight;
+      candidate.fee = meta.fee;
+      candidate.relay = meta.get_relay_method();
+      candidate.pruned = meta.pruned;
+      candidate.key_images.reserve(tx.vin.size());
+      for (const auto &in: tx.vin)
+      {
+        CHECKED_GET_SPECIFIC_VARIANT(in, const txin_to_key, txin, NULL);
+        candidate.key_images.push_back(txin.k_image);
+      }
+      return &m_template_candidates.emplace(txid, std::move(candidate)).first->second;
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to read tx from txpool: " << e.what());
+      return NULL;
+    }
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::add_parsed_tx(const transaction &tx, const crypto::hash &txid, size_t blob_size)
+  {
+    auto parsed_tx = std::make_shared<transaction>(tx);
+    // check_tx_inputs expands the ring, which is not part of the tx as relayed
+    parsed_tx->rct_signatures.mixRing.clear();
+    parsed_tx->set_hash(txid);
+    parsed_tx->set_blob_size(blob_size);
+    cache_parsed_tx(txid, std::move(parsed_tx));
+  }
+  //---------------------------------------------------------------------------------
+  std::shared_ptr<const transaction> tx_memory_pool::get_parsed_tx(const crypto::hash &txid, bool pruned, const cryptonote::blobdata_ref &txblob) const
+  {
+    const auto it = m_parsed_txs.find(txid);
+    if (it != m_parsed_txs.end())
+      return it->second;
+
+    auto tx = std::make_shared<transaction>();
+    if (!(pruned ? parse_and_validate_tx_base_from_blob(txblob, *tx) : parse_and_validate_tx_from_blob(txblob, *tx)))
+      return nullptr;
+    tx->set_hash(txid);
+    tx->set_blob_size(txblob.size());
+    cache_parsed_tx(txid, tx);
+    return tx;
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::cache_parsed_tx(const crypto::hash &txid, std::shared_ptr<const transaction> tx) const
+  {
+    uncache_parsed_tx(txid);
+    // past the cap, whichever entries come first go: they are parsed again when next used
+    while (!m_parsed_txs.empty() && m_parsed_txs_size + tx->blob_size > TXPOOL_PARSED_TXS_MAX_SIZE)
+      uncache_parsed_tx(m_parsed_txs.begin()->first);
+    m_parsed_txs_size += tx->blob_size;
+    m_parsed_txs.emplace(txid, std::move(tx));
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::uncache_parsed_tx(const crypto::hash &txid) const
+  {
+    const auto it = m_parsed_txs.find(txid);
+    if (it == m_parsed_txs.end())
+      return;
+    m_parsed_txs_size -= it->second->blob_size;
+    m_parsed_txs.erase(it);
+  }
+  //---------------------------------------------------------------------------------
   size_t tx_memory_pool::validate(uint8_t version)
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
@@ -1703,7 +1848,7 @@ namespace cryptonote
 
     MINFO("Validating txpool contents for v" << (unsigned)version);
 
-    LockedTXN lock(m_blockchain.get_db());
+    LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
 
     struct tx_entry_t
     {
@@ -1758,8 +1903,10 @@ namespace cryptonote
     return n_removed;
   }
   //---------------------------------------------------------------------------------
-  void tx_memory_pool::add_tx_to_transient_lists(const crypto::hash& txid, double fee, time_t receive_time)
+  void tx_memory_pool::add_tx_to_transient_lists(const crypto::hash& txid, double fee, time_t receive_time, bool sensitive)
   {
+    // (re)added txes may have new metadata, it gets read again when needed
+    m_template_candidates.erase(txid);
 
     time_t now = time(NULL);
     const std::unordered_map<crypto::hash, time_t>::iterator it = m_added_txs_by_id.find(txid);
@@ -1795,10 +1942,13 @@ namespace cryptonote
     {
       m_added_txs_start_time = now;
     }
+    log_pool_change(txid, true, sensitive);
   }
   //---------------------------------------------------------------------------------
   void tx_memory_pool::remove_tx_from_transient_lists(const cryptonote::sorted_tx_container::iterator& sorted_it, const crypto::hash& txid, bool sensitive)
   {
+    m_template_candidates.erase(txid);
+    uncache_parsed_tx(txid);
     if (sorted_it == m_txs_by_fee_and_receive_time.end())
     {
       LOG_PRINT_L1("Removing tx " << txid << " from tx pool, but it was not found in the sorted txs container!");
@@ -1818,6 +1968,7 @@ namespace cryptonote
       MDEBUG("Removing tx " << txid << " from tx pool, but it was not found in the map of added txs");
     }
     track_removed_tx(txid, sensitive);
+    log_pool_change(txid, false, sensitive);
   }
   //---------------------------------------------------------------------------------
   void tx_memory_pool::track_removed_tx(const crypto::hash& txid, bool sensitive)
@@ -1858,6 +2009,23 @@ namespace cryptonote
     }
   }
   //---------------------------------------------------------------------------------
+  void tx_memory_pool::log_pool_change(const crypto::hash& txid, bool added, bool sensitive)
+  {
+    m_pool_changes.push_back(pool_change{++m_pool_change_seq, txid, added, sensitive});
+
+    // Clients asking for changes older than this get the whole pool instead
+    const size_t MAX_CHANGES = 65536;
+    if (m_pool_changes.size() > MAX_CHANGES)
+      m_pool_changes.erase(m_pool_changes.begin(), m_pool_changes.begin() + MAX_CHANGES / 4);
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::reset_pool_change_log()
+  {
+    m_pool_changes.clear();
+    m_pool_change_seq = 0;
+    m_pool_change_log_id = crypto::rand_range<uint64_t>(1, std::numeric_limits<uint64_t>::max());
+  }
+  //---------------------------------------------------------------------------------
   bool tx_memory_pool::init(size_t max_txpool_weight, bool mine_stem_txes)
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
@@ -1865,10 +2033,14 @@ namespace cryptonote
 
     m_txpool_max_weight = max_txpool_weight ? max_txpool_weight : DEFAULT_TXPOOL_MAX_WEIGHT;
     m_txs_by_fee_and_receive_time.clear();
+    m_template_candidates.clear();
+    m_parsed_txs.clear();
+    m_parsed_txs_size = 0;
     m_added_txs_by_id.clear();
     m_added_txs_start_time = (time_t)0;
     m_removed_txs_by_time.clear();
     m_removed_txs_start_time = (time_t)0;
+    reset_pool_change_log();
     m_spent_key_images.clear();
     m_txpool_weight = 0;
     std::vector<crypto::hash> remove;
@@ -1893,7 +2065,7 @@ namespace cryptonote
           MFATAL("Failed to insert key images from txpool tx");
           return false;
         }
-        add_tx_to_transient_lists(txid, meta.fee / (double)meta.weight, meta.receive_time);
+        add_tx_to_transient_lists(txid, meta.fee / (double)meta.weight, meta.receive_time, !meta.matches(relay_category::broadcasted));
         m_txpool_weight += meta.weight;
         return true;
       }, true, relay_category::all);
@@ -1902,7 +2074,7 @@ namespace cryptonote
     }
     if (!remove.empty())
     {
-      LockedTXN lock(m_blockchain.get_db());
+      LockedTXN lock(m_blockchain.get_db(), !m_blockchain.get_txpool_write_behind());
       for (const auto &txid: remove)
       {
         try
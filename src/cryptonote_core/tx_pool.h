@@ -32,6 +32,8 @@
 #include "include_base_utils.h"
 
 #include <atomic>
+#include <deque>
+#include <memory>
 #include <set>
 #include <tuple>
 #include <unordered_map>
@@ -253,11 +255,13 @@ namespace cryptonote
     /**
      * @brief get a list of all transactions in the pool
      *
+     * The transactions are shared with the pool's parsed tx cache, not copied.
+     *
      * @param txs return-by-reference the list of transactions
      * @param include_sensitive return stempool, anonymity-pool, and unrelayed txes
      *
      */
-    void get_transactions(std::vector<transaction>& txs, bool include_sensitive = false) const;
+    void get_transactions(std::vector<std::shared_ptr<const transaction>>& txs, bool include_sensitive = false) const;
 
     /**
      * @brief get a list of all transaction hashes in the pool
@@ -439,7 +443,7 @@ namespace cryptonote
      */
     struct tx_details
     {
-      transaction tx;  //!< the transaction
+      std::shared_ptr<const transaction> tx;  //!< the transaction, shared with the parsed tx cache
       cryptonote::blobdata tx_blob; //!< the transaction's binary blob
       size_t blob_size;  //!< the transaction's size
       size_t weight;  //!< the transaction's weight
@@ -498,6 +502,24 @@ namespace cryptonote
      */
     bool get_pool_info(time_t start_time, bool include_sensitive, size_t max_tx_count, std::vector<std::pair<crypto::hash, tx_details>>& added_txs, std::vector<crypto::hash>& remaining_added_txids, std::vector<crypto::hash>& removed_txs, bool& incremental) const;
 
+    /**
+     * @brief get the txes added to and removed from the pool after a given change
+     *
+     * Every add and remove is numbered in a change log. If log_id is not the
+     * current log's id (eg, the daemon restarted), or the log no longer goes
+     * back to since_seq, the whole pool is returned in added_txs instead.
+     *
+     * @param log_id the log id returned by a previous call, or 0
+     * @param since_seq the seq returned by a previous call
+     * @param include_sensitive include stem/local txes
+     * @param current_log_id return-by-reference the current log's id
+     * @param seq return-by-reference the number of the latest change
+     * @param added_txs return-by-reference txes in the pool that were added after since_seq
+     * @param removed_txs return-by-reference txes that left the pool after since_seq
+     * @param incremental return-by-reference false if the whole pool was returned
+     */
+    void get_pool_changes(uint64_t log_id, uint64_t since_seq, bool include_sensitive, uint64_t &current_log_id, uint64_t &seq, std::vector<crypto::hash>& added_txs, std::vector<crypto::hash>& removed_txs, bool& incremental) const;
+
   private:
 
     /**
@@ -587,8 +609,8 @@ namespace cryptonote
      *
      * @return true if the transaction is good to go, otherwise false
      */
-    bool is_transaction_ready_to_go(txpool_tx_meta_t& txd, const crypto::hash &txid, const cryptonote::blobdata_ref &txblob, transaction&tx) const;
-    bool is_transaction_ready_to_go(txpool_tx_meta_t& txd, const crypto::hash &txid, const cryptonote::blobdata &txblob, transaction&tx) const;
+    bool is_transaction_ready_to_go(txpool_tx_meta_t& txd, const crypto::hash &txid, const cryptonote::blobdata_ref &txblob, std::shared_ptr<const transaction> &tx) const;
+    bool is_transaction_ready_to_go(txpool_tx_meta_t& txd, const crypto::hash &txid, const cryptonote::blobdata &txblob, std::shared_ptr<const transaction> &tx) const;
 
     /**
      * @brief mark all transactions double spending the one passed
@@ -602,9 +624,11 @@ namespace cryptonote
      */
     void prune(size_t bytes = 0);
 
-    void add_tx_to_transient_lists(const crypto::hash& txid, double fee, time_t receive_time);
+    void add_tx_to_transient_lists(const crypto::hash& txid, double fee, time_t receive_time, bool sensitive);
     void remove_tx_from_transient_lists(const cryptonote::sorted_tx_container::iterator& sorted_it, const crypto::hash& txid, bool sensitive);
     void track_removed_tx(const crypto::hash& txid, bool sensitive);
+    void log_pool_change(const crypto::hash& txid, bool added, bool sensitive);
+    void reset_pool_change_log();
 
     //TODO: confirm the below comments and investigate whether or not this
     //      is the desired behavior
@@ -632,6 +656,9 @@ private:
     //! interval on which to check for stale/"stuck" transactions
     epee::math_helper::once_a_time_seconds<30> m_remove_stuck_tx_interval;
 
+    //! interval on which deferred txpool writes are flushed to the db
+    epee::math_helper::once_a_time_seconds<TXPOOL_WRITE_BEHIND_FLUSH_INTERVAL> m_flush_txpool_writes_interval;
+
     //TODO: look into doing this better
     //!< container for transactions organized by fee per size and receive time
     sorted_tx_container m_txs_by_fee_and_receive_time;
@@ -658,6 +685,22 @@ private:
     // (it gets shorted periodically to prevent overflow)
     time_t m_removed_txs_start_time;
 
+    struct pool_change
+    {
+      uint64_t seq;
+      crypto::hash txid;
+      bool added;
+      bool sensitive;
+    };
+
+    // Numbered adds and removes, oldest first, trimmed to a fixed size
+    std::deque<pool_change> m_pool_changes;
+
+    // Number of the latest change, and a random id that changes whenever
+    // the numbering restarts
+    uint64_t m_pool_change_seq;
+    uint64_t m_pool_change_log_id;
+
     /**
      * @brief get an iterator to a transaction in the sorted container
      *
@@ -684,7 +727,69 @@ private:
 
     mutable std::unordered_map<crypto::hash, std::tuple<bool, tx_verification_context, uint64_t, crypto::hash>> m_input_cache;
 
-    std::unordered_map<crypto::hash, transaction> m_parsed_tx_cache;
+    /**
+     * @brief keep the parsed form of a tx just added to the pool
+     *
+     * @param tx the transaction
+     * @param txid the hash of the transaction
+     * @param blob_size the size of the transaction blob
+     */
+    void add_parsed_tx(const transaction &tx, const crypto::hash &txid, size_t blob_size);
+
+    /**
+     * @brief get the parsed form of a pool tx, parsing its blob the first time
+     *
+     * @param txid the hash of the transaction
+     * @param pruned whether the blob is pruned
+     * @param txblob the transaction blob from the db
+     *
+     * @return the transaction, or NULL if the blob does not parse
+     */
+    std::shared_ptr<const transaction> get_parsed_tx(const crypto::hash &txid, bool pruned, const cryptonote::blobdata_ref &txblob) const;
+
+    /**
+     * @brief keep a parsed tx, dropping others to stay under TXPOOL_PARSED_TXS_MAX_SIZE
+     *
+     * @param txid the hash of the transaction
+     * @param tx the transaction, with its blob size set
+     */
+    void cache_parsed_tx(const crypto::hash &txid, std::shared_ptr<const transaction> tx) const;
+
+    /**
+     * @brief forget the parsed form of a tx, if kept
+     *
+     * @param txid the hash of the transaction
+     */
+    void uncache_parsed_tx(const crypto::hash &txid) const;
+
+    //! parsed pool txes, never modified once in here, the db keeps the blobs
+    //! and anything dropped past the cap is parsed again on its next use
+    mutable std::unordered_map<crypto::hash, std::shared_ptr<const transaction>> m_parsed_txs;
+    mutable size_t m_parsed_txs_size; //!< total blob size of m_parsed_txs
+
+    //! what fill_block_template needs to know about a pool tx
+    struct template_candidate
+    {
+      size_t weight;
+      uint64_t fee;
+      relay_method relay;
+      bool pruned;
+      bool ready_known; //!< whether ready is valid, reset when the chain changes
+      bool ready;
+      std::vector<crypto::key_image> key_images;
+    };
+
+    /**
+     * @brief get the template data for a pool tx, reading it from the db the first time
+     *
+     * @param txid the hash of the transaction
+     *
+     * @return a pointer to the entry, or NULL if the tx could not be read
+     */
+    template_candidate *get_template_candidate(const crypto::hash &txid);
+
+    //! template data for pool txes, filled as fill_block_template meets them
+    std::unordered_map<crypto::hash, template_candidate> m_template_candidates;
 
     //! Next timestamp that a DB check for relayable txes is allowed
     std::atomic<time_t> m_next_check;
@@ -925,10 +925,23 @@ namespace cryptonote
     else
       stem_txs.reserve(arg.txs.size());
 
-    for (auto& tx : arg.txs)
+    std::vector<tx_verification_context> tvcs(arg.txs.size());
+    if (!m_core.handle_incoming_txs(epee::to_span(arg.txs), epee::to_mut_span(tvcs), tx_relay, true))
     {
-      tx_verification_context tvc{};
-      if (!m_core.handle_incoming_tx(tx, tvc, tx_relay, true) && !tvc.m_no_drop_offense)
+      const bool judged = std::any_of(tvcs.begin(), tvcs.end(), [](const tx_verification_context &tvc) {
+        return tvc.m_verifivation_failed || tvc.m_verifivation_impossible;
+      });
+      if (!judged)
+      {
+        LOG_PRINT_CCONTEXT_L1("Tx verification failed, dropping connection");
+        drop_connection(context, false, false);
+        return 1;
+      }
+    }
+    for (size_t i = 0; i < arg.txs.size(); ++i)
+    {
+      const tx_verification_context &tvc = tvcs[i];
+      if ((tvc.m_verifivation_failed || tvc.m_verifivation_impossible) && !tvc.m_no_drop_offense)
       {
         LOG_PRINT_CCONTEXT_L1("Tx verification failed, dropping connection");
         drop_connection(context, false, false);
@@ -939,11 +952,11 @@ namespace cryptonote
       {
         case relay_method::local:
         case relay_method::stem:
-          stem_txs.push_back(std::move(tx));
+          stem_txs.push_back(std::move(arg.txs[i]));
           break;
         case relay_method::block:
         case relay_method::fluff:
-          fluff_txs.push_back(std::move(tx));
+          fluff_txs.push_back(std::move(arg.txs[i]));
           break;
         default:
         case relay_method::forward: // not supposed to happen here
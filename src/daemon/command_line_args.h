@@ -140,30 +140,12 @@ namespace daemon_args
   , true
   };
 
-  const command_line::arg_descriptor<std::string> arg_quantum_key_file = {
-    "quantum-key-file"
-  , "Path to quantum-safe key file containing BOTH XMSS and SPHINCS+ keys - REQUIRED"
-  , ""
-  };
-
   const command_line::arg_descriptor<bool> arg_quantum_hybrid_mode = {
     "quantum-hybrid"
   , "Enable hybrid mode combining classical and quantum-resistant cryptography - MANDATORY"
   , true
   };
 
-  const command_line::arg_descriptor<uint32_t> arg_xmss_tree_height = {
-    "xmss-tree-height"
-  , "XMSS tree height (default: 10, max: 20) - REQUIRED for dual enforcement"
-  , 10
-  };
-
-  const command_line::arg_descriptor<uint32_t> arg_sphincs_level = {
-    "sphincs-level"
-  , "SPHINCS+ tree level (default: 5, max: 10) - REQUIRED for dual enforcement"
-  , 5
-  };
-
   const command_line::arg_descriptor<bool> arg_enforce_quantum_safe = {
     "enforce-quantum-safe"
   , "Enforce quantum-safe signatures for all transactions - MANDATORY"
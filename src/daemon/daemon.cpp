@@ -122,6 +122,7 @@ public:
         core.get().get_blockchain_storage().set_txpool_notify(cryptonote::listener::zmq_pub::txpool_add{shared});
         core.get().get_blockchain_storage().add_block_notify(cryptonote::listener::zmq_pub::chain_main{shared});
         core.get().get_blockchain_storage().add_miner_notify(cryptonote::listener::zmq_pub::miner_data{shared});
+        core.get().get_blockchain_storage().add_miner_template_notify(cryptonote::listener::zmq_pub::miner_template{shared});
       }
     }
   }
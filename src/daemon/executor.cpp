@@ -30,11 +30,11 @@
 
 #include "daemon/executor.h"
 #include "daemon/command_line_args.h"
+#include "cryptonote_core/cryptonote_core.h"
 #include "common/command_line.h"
 
 #include "cryptonote_config.h"
 #include "version.h"
-#include "crypto/quantum_safe.h"
 #include <boost/filesystem.hpp>
 
 #include <string>
@@ -103,9 +103,9 @@ namespace daemonize
       const bool randomx_integration = true; // ALWAYS true
       
       // Use defaults if not specified
-      uint32_t xmss_height = command_line::get_arg(vm, daemon_args::arg_xmss_tree_height);
-      uint32_t sphincs_level = command_line::get_arg(vm, daemon_args::arg_sphincs_level);
-      const std::string key_file = command_line::get_arg(vm, daemon_args::arg_quantum_key_file);
+      uint32_t xmss_height = command_line::get_arg(vm, cryptonote::arg_xmss_tree_height);
+      uint32_t sphincs_level = command_line::get_arg(vm, cryptonote::arg_sphincs_level);
+      const std::string key_file = command_line::get_arg(vm, cryptonote::arg_quantum_key_file);
       
       // Validate parameter ranges
       if (xmss_height == 0 || xmss_height > 20)
@@ -113,57 +113,20 @@ namespace daemonize
       if (sphincs_level == 0 || sphincs_level > 10)
         sphincs_level = QSF_DEFAULT_SPHINCS_LEVEL; // Use default instead of error
       
-      // Auto-generate keys if no key file provided
+      // Keys are loaded (or generated) once by core, which keeps them for the
+      // lifetime of the daemon; only fail early on an obviously bad path here
       if (key_file.empty())
       {
-        LOG_PRINT_L0("No quantum key file provided - auto-generating dual quantum-safe keys");
-        crypto::quantum_safe_manager manager;
-        if (!manager.generate_dual_keys(xmss_height, sphincs_level))
-        {
-          throw std::runtime_error("Failed to auto-generate quantum-safe dual keys");
-        }
-        LOG_PRINT_L0("Auto-generated quantum-safe dual keys: XMSS(height=" << xmss_height 
-                     << "), SPHINCS+(level=" << sphincs_level << ")");
+        LOG_PRINT_L0("No quantum key file provided - dual quantum-safe keys will be auto-generated in memory");
       }
       else
       {
-        // Validate provided key file
         boost::filesystem::path p{key_file};
         if (!boost::filesystem::exists(p))
         {
           throw std::runtime_error(std::string("quantum-key-file does not exist: ") + key_file);
         }
-        
-        crypto::quantum_safe_manager manager;
-        if (!manager.load_dual_keys(key_file))
-        {
-          if (!manager.load_keys(key_file))
-            throw std::runtime_error("Failed to load quantum-safe keys from file");
-        }
-        
-        // Auto-migrate old keys to new secure format if needed (plug-and-play)
-        if (manager.has_old_format_keys())
-        {
-          LOG_PRINT_L0("Detected old-format quantum-safe keys - auto-migrating to new secure format");
-          if (!manager.ensure_modern_keys(xmss_height, sphincs_level))
-          {
-            throw std::runtime_error("Failed to auto-migrate quantum-safe keys to new secure format");
-          }
-          
-          // Save migrated keys back to file
-          if (!manager.save_dual_keys(key_file))
-          {
-            LOG_PRINT_L1("Warning: Failed to save migrated keys to file - keys will be regenerated on next load");
-          }
-          else
-          {
-            LOG_PRINT_L0("Successfully migrated and saved quantum-safe keys to: " << key_file);
-          }
-        }
-        else
-        {
-          LOG_PRINT_L0("Quantum-safe key file loaded: " << key_file);
-        }
+        LOG_PRINT_L0("Quantum-safe key file: " << key_file);
       }
       
       LOG_PRINT_L0("Quantum-safe enforcement: ALWAYS ACTIVE | dual_enforcement=ON, hybrid=ON, xmss_height=" 
@@ -164,10 +164,7 @@ int main(int argc, char const * argv[])
       // Quantum-safe arguments
       command_line::add_arg(core_settings, daemon_args::arg_quantum_safe_enabled);
       command_line::add_arg(core_settings, daemon_args::arg_dual_quantum_enforcement);
-      command_line::add_arg(core_settings, daemon_args::arg_quantum_key_file);
       command_line::add_arg(core_settings, daemon_args::arg_quantum_hybrid_mode);
-      command_line::add_arg(core_settings, daemon_args::arg_xmss_tree_height);
-      command_line::add_arg(core_settings, daemon_args::arg_sphincs_level);
       command_line::add_arg(core_settings, daemon_args::arg_enforce_quantum_safe);
       command_line::add_arg(core_settings, daemon_args::arg_randomx_quantum_integration);
 
@@ -670,8 +670,8 @@ namespace cryptonote
           std::stringstream oss;
           binary_archive<true> ar(oss);
           bool r = req.prune
-            ? const_cast<cryptonote::transaction&>(added_pool_tx.second.tx).serialize_base(ar)
-            : ::serialization::serialize(ar, const_cast<cryptonote::transaction&>(added_pool_tx.second.tx));
+            ? const_cast<cryptonote::transaction&>(*added_pool_tx.second.tx).serialize_base(ar)
+            : ::serialization::serialize(ar, const_cast<cryptonote::transaction&>(*added_pool_tx.second.tx));
           if (!r)
           {
             res.status = "Failed to serialize transaction";
@@ -724,7 +724,7 @@ namespace cryptonote
       }
 
       std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > > bs;
-      if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.start_height, req.prune, !req.no_miner_tx, max_blocks, COMMAND_RPC_GET_BLOCKS_FAST_MAX_TX_COUNT))
+      if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.start_height, req.prune, !req.no_miner_tx, !req.no_quantum_signatures, max_blocks, COMMAND_RPC_GET_BLOCKS_FAST_MAX_TX_COUNT))
       {
         res.status = "Failed";
         add_host_fail(ctx);
@@ -1051,14 +1051,14 @@ namespace cryptonote
             const tx_memory_pool::tx_details &td = i->second;
             std::stringstream ss;
             binary_archive<true> ba(ss);
-            bool r = const_cast<cryptonote::transaction&>(td.tx).serialize_base(ba);
+            bool r = const_cast<cryptonote::transaction&>(*td.tx).serialize_base(ba);
             if (!r)
             {
               res.status = "Failed to serialize transaction base";
               return true;
             }
             const cryptonote::blobdata pruned = ss.str();
-            const crypto::hash prunable_hash = td.tx.version == 1 ? crypto::null_hash : get_transaction_prunable_hash(td.tx);
+            const crypto::hash prunable_hash = td.tx->version == 1 ? crypto::null_hash : get_transaction_prunable_hash(*td.tx);
             sorted_txs.push_back(std::make_tuple(h, pruned, prunable_hash, std::string(td.tx_blob, pruned.size())));
             missed_txs.erase(std::find(missed_txs.begin(), missed_txs.end(), h));
             pool_tx_hashes.insert(h);
@@ -1728,6 +1728,58 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_txpool_changes_bin(const COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES_BIN::request& req, COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES_BIN::response& res, const connection_context *ctx)
+  {
+    RPC_TRACKER(get_txpool_changes);
+    bool r;
+    if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES_BIN>(invoke_http_mode::BIN, "/get_txpool_changes.bin", req, res, r))
+      return r;
+
+    CHECK_PAYMENT(req, res, 1);
+
+    const bool restricted = m_restricted && ctx;
+    const bool request_has_rpc_origin = ctx != NULL;
+    const bool allow_sensitive = !request_has_rpc_origin || !restricted;
+
+    m_core.get_pool_changes(req.log_id, req.since_seq, allow_sensitive, res.log_id, res.seq, res.added_tx_hashes, res.removed_tx_hashes, res.incremental);
+    const size_t n_txes = res.added_tx_hashes.size() + res.removed_tx_hashes.size();
+    if (n_txes > 0)
+      CHECK_PAYMENT_SAME_TS(req, res, n_txes * COST_PER_POOL_HASH);
+
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_txpool_changes(const COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES::request& req, COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES::response& res, const connection_context *ctx)
+  {
+    RPC_TRACKER(get_txpool_changes);
+    bool r;
+    if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES>(invoke_http_mode::JON, "/get_txpool_changes", req, res, r))
+      return r;
+
+    CHECK_PAYMENT(req, res, 1);
+
+    const bool restricted = m_restricted && ctx;
+    const bool request_has_rpc_origin = ctx != NULL;
+    const bool allow_sensitive = !request_has_rpc_origin || !restricted;
+
+    std::vector<crypto::hash> added_tx_hashes, removed_tx_hashes;
+    m_core.get_pool_changes(req.log_id, req.since_seq, allow_sensitive, res.log_id, res.seq, added_tx_hashes, removed_tx_hashes, res.incremental);
+    const size_t n_txes = added_tx_hashes.size() + removed_tx_hashes.size();
+    if (n_txes > 0)
+      CHECK_PAYMENT_SAME_TS(req, res, n_txes * COST_PER_POOL_HASH);
+
+    res.added_tx_hashes.reserve(added_tx_hashes.size());
+    for (const crypto::hash &tx_hash: added_tx_hashes)
+      res.added_tx_hashes.push_back(epee::string_tools::pod_to_hex(tx_hash));
+    res.removed_tx_hashes.reserve(removed_tx_hashes.size());
+    for (const crypto::hash &tx_hash: removed_tx_hashes)
+      res.removed_tx_hashes.push_back(epee::string_tools::pod_to_hex(tx_hash));
+
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_transaction_pool_stats(const COMMAND_RPC_GET_TRANSACTION_POOL_STATS::request& req, COMMAND_RPC_GET_TRANSACTION_POOL_STATS::response& res, const connection_context *ctx)
   {
     RPC_TRACKER(get_transaction_pool_stats);
@@ -2449,7 +2501,7 @@ namespace cryptonote
     crypto::hash last_block_hash;
     m_core.get_blockchain_top(last_block_height, last_block_hash);
     block last_block;
-    bool have_last_block = m_core.get_block_by_hash(last_block_hash, last_block);
+    bool have_last_block = m_core.get_block_by_hash(last_block_hash, last_block, NULL, false);
     if (!have_last_block)
     {
       error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
@@ -2496,7 +2548,7 @@ namespace cryptonote
       }
       block blk;
       bool orphan = false;
-      bool have_block = m_core.get_block_by_hash(block_hash, blk, &orphan);
+      bool have_block = m_core.get_block_by_hash(block_hash, blk, &orphan, false);
       if (!have_block)
       {
         error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
@@ -2564,7 +2616,7 @@ namespace cryptonote
     {
       crypto::hash block_hash = m_core.get_block_id_by_height(h);
       block blk;
-      bool have_block = m_core.get_block_by_hash(block_hash, blk);
+      bool have_block = m_core.get_block_by_hash(block_hash, blk, NULL, false);
       if (!have_block)
       {
         error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
@@ -2613,7 +2665,7 @@ namespace cryptonote
     CHECK_PAYMENT_MIN1(req, res, COST_PER_BLOCK_HEADER, false);
     crypto::hash block_hash = m_core.get_block_id_by_height(req.height);
     block blk;
-    bool have_block = m_core.get_block_by_hash(block_hash, blk);
+    bool have_block = m_core.get_block_by_hash(block_hash, blk, NULL, false);
     if (!have_block)
     {
       error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
@@ -2862,17 +2914,12 @@ namespace cryptonote
     std::vector<crypto::hash> txids;
     if (req.txids.empty())
     {
-      std::vector<transaction> pool_txs;
-      bool r = m_core.get_pool_transactions(pool_txs, true);
+      bool r = m_core.get_pool_transaction_hashes(txids, true);
       if (!r)
       {
         res.status = "Failed to get txpool contents";
         return true;
       }
-      for (const auto &tx: pool_txs)
-      {
-        txids.push_back(cryptonote::get_transaction_hash(tx));
-      }
     }
     else
     {
@@ -88,7 +88,7 @@ namespace cryptonote
 // advance which version they will stop working with
 // Don't go over 32767 for any of these
 #define CORE_RPC_VERSION_MAJOR 3
-#define CORE_RPC_VERSION_MINOR 15
+#define CORE_RPC_VERSION_MINOR 17
 #define MAKE_CORE_RPC_VERSION(major,minor) (((major)<<16)|(minor))
 #define CORE_RPC_VERSION MAKE_CORE_RPC_VERSION(CORE_RPC_VERSION_MAJOR, CORE_RPC_VERSION_MINOR)
 
@@ -177,6 +177,7 @@ namespace cryptonote
       bool        prune;
       bool        no_miner_tx;
       uint64_t    pool_info_since;
+      bool        no_quantum_signatures; // blocks come with empty quantum signature fields
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_request_base)
         KV_SERIALIZE_OPT(requested_info, (uint8_t)0)
@@ -185,6 +186,7 @@ namespace cryptonote
         KV_SERIALIZE(prune)
         KV_SERIALIZE_OPT(no_miner_tx, false)
         KV_SERIALIZE_OPT(pool_info_since, (uint64_t)0)
+        KV_SERIALIZE_OPT(no_quantum_signatures, false)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<request_t> request;
@@ -1634,6 +1636,76 @@ namespace cryptonote
     typedef epee::misc_utils::struct_init<response_t> response;
   };
 
+  struct COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES_BIN
+  {
+    struct request_t: public rpc_access_request_base
+    {
+      uint64_t log_id;
+      uint64_t since_seq;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_access_request_base)
+        KV_SERIALIZE_OPT(log_id, (uint64_t)0)
+        KV_SERIALIZE_OPT(since_seq, (uint64_t)0)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<request_t> request;
+
+    struct response_t: public rpc_access_response_base
+    {
+      uint64_t log_id;
+      uint64_t seq;
+      bool incremental;
+      std::vector<crypto::hash> added_tx_hashes;
+      std::vector<crypto::hash> removed_tx_hashes;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_access_response_base)
+        KV_SERIALIZE(log_id)
+        KV_SERIALIZE(seq)
+        KV_SERIALIZE(incremental)
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(added_tx_hashes)
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(removed_tx_hashes)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<response_t> response;
+  };
+
+  struct COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES
+  {
+    struct request_t: public rpc_access_request_base
+    {
+      uint64_t log_id;
+      uint64_t since_seq;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_access_request_base)
+        KV_SERIALIZE_OPT(log_id, (uint64_t)0)
+        KV_SERIALIZE_OPT(since_seq, (uint64_t)0)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<request_t> request;
+
+    struct response_t: public rpc_access_response_base
+    {
+      uint64_t log_id;
+      uint64_t seq;
+      bool incremental;
+      std::vector<std::string> added_tx_hashes;
+      std::vector<std::string> removed_tx_hashes;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_access_response_base)
+        KV_SERIALIZE(log_id)
+        KV_SERIALIZE(seq)
+        KV_SERIALIZE(incremental)
+        KV_SERIALIZE(added_tx_hashes)
+        KV_SERIALIZE(removed_tx_hashes)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<response_t> response;
+  };
+
   struct tx_backlog_entry
   {
     uint64_t weight;
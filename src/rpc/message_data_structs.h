@@ -34,6 +34,7 @@
 #include "ringct/rctSigs.h"
 #include "rpc/rpc_handler.h"
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -87,7 +88,7 @@ namespace rpc
 
   struct tx_in_pool
   {
-    cryptonote::transaction tx;
+    std::shared_ptr<const cryptonote::transaction> tx;
     crypto::hash tx_hash;
     uint64_t blob_size;
     uint64_t weight;
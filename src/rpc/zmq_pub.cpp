@@ -47,6 +47,7 @@
 #include "crypto/crypto.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_basic/events.h"
+#include "int-util.h"
 #include "misc_log_ex.h"
 #include "serialization/json_object.h"
 #include "ringct/rctTypes.h"
@@ -61,6 +62,7 @@ namespace
 
   using chain_writer =  void(epee::byte_stream&, std::uint64_t, epee::span<const cryptonote::block>);
   using miner_writer =  void(epee::byte_stream&, uint8_t, uint64_t, const crypto::hash&, const crypto::hash&, cryptonote::difficulty_type, uint64_t, uint64_t, const std::vector<cryptonote::tx_block_template_backlog_entry>&);
+  using template_writer = void(epee::byte_stream&, uint64_t, const crypto::hash&, cryptonote::difficulty_type, uint64_t, const cryptonote::blobdata&, const cryptonote::blobdata&);
   using txpool_writer = void(epee::byte_stream&, epee::span<const cryptonote::txpool_event>);
 
   template<typename F>
@@ -203,6 +205,32 @@ namespace
     json_pub(buf, miner_data{major_version, height, prev_id, seed_hash, diff, median_weight, already_generated_coins, tx_backlog});
   }
 
+  void write_u64(epee::byte_stream& buf, const std::uint64_t value)
+  {
+    const std::uint64_t le = SWAP64LE(value);
+    buf.write(reinterpret_cast<const char*>(std::addressof(le)), sizeof(le));
+  }
+
+  void write_blob(epee::byte_stream& buf, const cryptonote::blobdata& blob)
+  {
+    write_u64(buf, blob.size());
+    buf.write(blob.data(), blob.size());
+  }
+
+  /*! Little-endian u64 height, u64 low and u64 high words of the difficulty,
+      32 byte seed hash, u64 reserved offset (into the template blob), then the
+      hashing blob and the template blob, each prefixed by its u64 size. */
+  void bin_miner_template(epee::byte_stream& buf, uint64_t height, const crypto::hash& seed_hash, cryptonote::difficulty_type diff, uint64_t reserved_offset, const cryptonote::blobdata& hashing_blob, const cryptonote::blobdata& template_blob)
+  {
+    write_u64(buf, height);
+    write_u64(buf, (diff & 0xffffffffffffffff).convert_to<std::uint64_t>());
+    write_u64(buf, (diff >> 64).convert_to<std::uint64_t>());
+    buf.write(reinterpret_cast<const char*>(seed_hash.data), sizeof(seed_hash.data));
+    write_u64(buf, reserved_offset);
+    write_blob(buf, hashing_blob);
+    write_blob(buf, template_blob);
+  }
+
   // boost::adaptors are in place "views" - no copy/move takes place
   // moving transactions (via sort, etc.), is expensive!
 
@@ -237,6 +265,11 @@ namespace
     {u8"json-full-miner_data", json_miner_data},
   }};
 
+  constexpr const std::array<context<template_writer>, 1> template_contexts =
+  {{
+    {u8"bin-full-miner_template", bin_miner_template},
+  }};
+
   constexpr const std::array<context<txpool_writer>, 2> txpool_contexts =
   {{
     {u8"json-full-txpool_add", json_full_txpool},
@@ -361,6 +394,7 @@ zmq_pub::zmq_pub(void* context)
   : relay_(),
     chain_subs_{{0}},
     miner_subs_{{0}},
+    template_subs_{{0}},
     txpool_subs_{{0}},
     sync_()
 {
@@ -369,6 +403,7 @@ zmq_pub::zmq_pub(void* context)
 
   verify_sorted(chain_contexts, "chain_contexts");
   verify_sorted(miner_contexts, "miner_contexts");
+  verify_sorted(template_contexts, "template_contexts");
   verify_sorted(txpool_contexts, "txpool_contexts");
 
   relay_.reset(zmq_socket(context, ZMQ_PAIR));
@@ -390,12 +425,14 @@ bool zmq_pub::sub_request(boost::string_ref message)
 
     const auto chain_range = get_range(chain_contexts, message);
     const auto miner_range = get_range(miner_contexts, message);
+    const auto template_range = get_range(template_contexts, message);
     const auto txpool_range = get_range(txpool_contexts, message);
 
-    if (!chain_range.empty() || !miner_range.empty() || !txpool_range.empty())
+    if (!chain_range.empty() || !miner_range.empty() || !template_range.empty() || !txpool_range.empty())
     {
       MDEBUG("Client " << (tag ? "subscribed" : "unsubscribed") << " to " <<
-             chain_range.size() << " chain topic(s), " << miner_range.size() << " miner topic(s) and " << txpool_range.size() << " txpool topic(s)");
+             chain_range.size() << " chain topic(s), " << miner_range.size() << " miner topic(s), " <<
+             template_range.size() << " template topic(s) and " << txpool_range.size() << " txpool topic(s)");
 
       const boost::lock_guard<boost::mutex> lock{sync_};
       switch (tag)
@@ -403,11 +440,13 @@ bool zmq_pub::sub_request(boost::string_ref message)
       case 0:
         remove_subscriptions(chain_subs_, chain_range, chain_contexts.begin());
         remove_subscriptions(miner_subs_, miner_range, miner_contexts.begin());
+        remove_subscriptions(template_subs_, template_range, template_contexts.begin());
         remove_subscriptions(txpool_subs_, txpool_range, txpool_contexts.begin());
         return true;
       case 1:
         add_subscriptions(chain_subs_, chain_range, chain_contexts.begin());
         add_subscriptions(miner_subs_, miner_range, miner_contexts.begin());
+        add_subscriptions(template_subs_, template_range, template_contexts.begin());
         add_subscriptions(txpool_subs_, txpool_range, txpool_contexts.begin());
         return true;
       default:
@@ -499,6 +538,25 @@ std::size_t zmq_pub::send_miner_data(uint8_t major_version, uint64_t height, con
   return 0;
 }
 
+std::size_t zmq_pub::send_miner_template(uint64_t height, const crypto::hash& seed_hash, difficulty_type diff, uint64_t reserved_offset, const cryptonote::blobdata& hashing_blob, const cryptonote::blobdata& template_blob)
+{
+  boost::unique_lock<boost::mutex> guard{sync_};
+
+  const auto subs_copy = template_subs_;
+  guard.unlock();
+
+  for (const std::size_t sub : subs_copy)
+  {
+    if (sub)
+    {
+        auto messages = make_pubs(subs_copy, template_contexts, height, seed_hash, diff, reserved_offset, hashing_blob, template_blob);
+        guard.lock();
+        return send_messages(relay_.get(), messages);
+    }
+  }
+  return 0;
+}
+
 std::size_t zmq_pub::send_txpool_add(std::vector<txpool_event> txes)
 {
   if (txes.empty())
@@ -538,6 +596,15 @@ void zmq_pub::miner_data::operator()(uint8_t major_version, uint64_t height, con
     MERROR("Unable to send ZMQ/Pub - ZMQ server destroyed");
 }
 
+void zmq_pub::miner_template::operator()(uint64_t height, const crypto::hash& seed_hash, difficulty_type diff, uint64_t reserved_offset, const cryptonote::blobdata& hashing_blob, const cryptonote::blobdata& template_blob) const
+{
+  const std::shared_ptr<zmq_pub> self = self_.lock();
+  if (self)
+    self->send_miner_template(height, seed_hash, diff, reserved_offset, hashing_blob, template_blob);
+  else
+    MERROR("Unable to send ZMQ/Pub - ZMQ server destroyed");
+}
+
 void zmq_pub::txpool_add::operator()(std::vector<cryptonote::txpool_event> txes) const
 {
   const std::shared_ptr<zmq_pub> self = self_.lock();
@@ -37,6 +37,7 @@
 #include <memory>
 #include <vector>
 
+#include "cryptonote_basic/blobdatatype.h"
 #include "cryptonote_basic/fwd.h"
 #include "net/zmq.h"
 #include "span.h"
@@ -62,6 +63,7 @@ class zmq_pub
     std::deque<std::vector<txpool_event>> txes_;
     std::array<std::size_t, 2> chain_subs_;
     std::array<std::size_t, 1> miner_subs_;
+    std::array<std::size_t, 1> template_subs_;
     std::array<std::size_t, 2> txpool_subs_;
     boost::mutex sync_; //!< Synchronizes counts in `*_subs_` arrays.
 
@@ -96,6 +98,12 @@ class zmq_pub
         \return Number of ZMQ messages sent to relay. */
     std::size_t send_miner_data(uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<tx_block_template_backlog_entry>& tx_backlog);
 
+    /*! Send a `ZMQ_PUB` notification for a new block template. The binary
+        payload lets miners start on a template without polling
+        `get_block_template`. Thread-safe.
+        \return Number of ZMQ messages sent to relay. */
+    std::size_t send_miner_template(uint64_t height, const crypto::hash& seed_hash, difficulty_type diff, uint64_t reserved_offset, const cryptonote::blobdata& hashing_blob, const cryptonote::blobdata& template_blob);
+
     /*! Send a `ZMQ_PUB` notification for new tx(es) being added to the local
         pool. Thread-safe.
         \return Number of ZMQ messages sent to relay. */
@@ -115,6 +123,13 @@ class zmq_pub
       void operator()(uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<tx_block_template_backlog_entry>& tx_backlog) const;
     };
 
+    //! Callable for `send_miner_template` with weak ownership to `zmq_pub` object.
+    struct miner_template
+    {
+      std::weak_ptr<zmq_pub> self_;
+      void operator()(uint64_t height, const crypto::hash& seed_hash, difficulty_type diff, uint64_t reserved_offset, const cryptonote::blobdata& hashing_blob, const cryptonote::blobdata& template_blob) const;
+    };
+
     //! Callable for `send_txpool_add` with weak ownership to `zmq_pub` object.
     struct txpool_add
     {
@@ -59,6 +59,9 @@ namespace serialization
 
     template <typename C>
     void do_reserve(C &c, size_t N) {}
+
+    template <typename C>
+    bool can_hold(const C &c, size_t N) { return true; }
   }
 }
 
@@ -77,6 +80,12 @@ bool do_serialize_container(Archive<false> &ar, C &v)
     return false;
   }
 
+  // fixed capacity containers
+  if (!::serialization::detail::can_hold(v, cnt)) {
+    ar.set_fail();
+    return false;
+  }
+
   ::serialization::detail::do_reserve(v, cnt);
 
   for (size_t i = 0; i < cnt; i++) {
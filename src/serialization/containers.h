@@ -36,6 +36,7 @@
 #include <map>
 #include <unordered_set>
 #include <set>
+#include <boost/container/static_vector.hpp>
 #include "serialization.h"
 
 template <template <bool> class Archive, class T> bool do_serialize(Archive<false> &ar, std::vector<T> &v);
@@ -44,6 +45,9 @@ template <template <bool> class Archive, class T> bool do_serialize(Archive<true
 template <template <bool> class Archive, class T> bool do_serialize(Archive<false> &ar, std::deque<T> &v);
 template <template <bool> class Archive, class T> bool do_serialize(Archive<true> &ar, std::deque<T> &v);
 
+template <template <bool> class Archive, class T, size_t N> bool do_serialize(Archive<false> &ar, boost::container::static_vector<T, N> &v);
+template <template <bool> class Archive, class T, size_t N> bool do_serialize(Archive<true> &ar, boost::container::static_vector<T, N> &v);
+
 template<typename K, typename V>
 class serializable_unordered_map: public std::unordered_map<K, V>
 {
@@ -92,6 +96,9 @@ namespace serialization
 
     template <typename T> void do_add(std::deque<T> &c, T &&e) { c.emplace_back(std::forward<T>(e)); }
 
+    template <typename T, size_t N> bool can_hold(const boost::container::static_vector<T, N> &c, size_t n) { return n <= N; }
+    template <typename T, size_t N> void do_add(boost::container::static_vector<T, N> &c, T &&e) { c.emplace_back(std::forward<T>(e)); }
+
     template <typename K, typename V> void do_add(serializable_unordered_map<K, V> &c, std::pair<K, V> &&e) { c.insert(std::forward<std::pair<K, V>>(e)); }
 
     template <typename K, typename V> void do_add(serializable_map<K, V> &c, std::pair<K, V> &&e) { c.insert(std::forward<std::pair<K, V>>(e)); }
@@ -112,6 +119,9 @@ template <template <bool> class Archive, class T> bool do_serialize(Archive<true
 template <template <bool> class Archive, class T> bool do_serialize(Archive<false> &ar, std::deque<T> &v) { return do_serialize_container(ar, v); }
 template <template <bool> class Archive, class T> bool do_serialize(Archive<true> &ar, std::deque<T> &v) { return do_serialize_container(ar, v); }
 
+template <template <bool> class Archive, class T, size_t N> bool do_serialize(Archive<false> &ar, boost::container::static_vector<T, N> &v) { return do_serialize_container(ar, v); }
+template <template <bool> class Archive, class T, size_t N> bool do_serialize(Archive<true> &ar, boost::container::static_vector<T, N> &v) { return do_serialize_container(ar, v); }
+
 template <template <bool> class Archive, typename K, typename V> bool do_serialize(Archive<false> &ar, serializable_unordered_map<K, V> &v) { return do_serialize_container(ar, v); }
 template <template <bool> class Archive, typename K, typename V> bool do_serialize(Archive<true> &ar, serializable_unordered_map<K, V> &v) { return do_serialize_container(ar, v); }
 
@@ -906,7 +906,7 @@ void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const cryptonote::r
 {
   dest.StartObject();
 
-  INSERT_INTO_JSON_OBJECT(dest, tx, tx.tx);
+  INSERT_INTO_JSON_OBJECT(dest, tx, *tx.tx);
   INSERT_INTO_JSON_OBJECT(dest, tx_hash, tx.tx_hash);
   INSERT_INTO_JSON_OBJECT(dest, blob_size, tx.blob_size);
   INSERT_INTO_JSON_OBJECT(dest, weight, tx.weight);
@@ -933,7 +933,9 @@ void fromJsonValue(const rapidjson::Value& val, cryptonote::rpc::tx_in_pool& tx)
     throw WRONG_TYPE("json object");
   }
 
-  GET_FROM_JSON_OBJECT(val, tx.tx, tx);
+  cryptonote::transaction parsed_tx;
+  GET_FROM_JSON_OBJECT(val, parsed_tx, tx);
+  tx.tx = std::make_shared<const cryptonote::transaction>(parsed_tx);
   GET_FROM_JSON_OBJECT(val, tx.blob_size, blob_size);
   GET_FROM_JSON_OBJECT(val, tx.weight, weight);
   GET_FROM_JSON_OBJECT(val, tx.fee, fee);
@@ -116,7 +116,8 @@ struct event_visitor_settings
     set_txs_keeped_by_block = 1 << 0,
     set_txs_do_not_relay = 1 << 1,
     set_local_relay = 1 << 2,
-    set_txs_stem = 1 << 3
+    set_txs_stem = 1 << 3,
+    set_txs_batch = 1 << 4 //!< tx lists go through one handle_incoming_txs call
   };
 
   event_visitor_settings(int a_mask = 0)
@@ -512,6 +513,7 @@ private:
   size_t m_ev_index;
 
   cryptonote::relay_method m_tx_relay;
+  bool m_txs_batch;
 
 public:
   push_core_event_visitor(cryptonote::core& c, const std::vector<test_event_entry>& events, t_test_class& validator)
@@ -520,6 +522,7 @@ public:
     , m_validator(validator)
     , m_ev_index(0)
     , m_tx_relay(cryptonote::relay_method::fluff)
+    , m_txs_batch(false)
   {
   }
 
@@ -538,6 +541,7 @@ public:
   {
     log_event("event_visitor_settings");
 
+    m_txs_batch = settings.mask & event_visitor_settings::set_txs_batch;
     if (settings.mask & event_visitor_settings::set_txs_keeped_by_block)
     {
       m_tx_relay = cryptonote::relay_method::block;
@@ -588,8 +592,11 @@ public:
       tvcs.push_back(tvc0);
     }
     size_t pool_size = m_c.get_pool_transactions_count();
-    for (size_t i = 0; i < tx_blobs.size(); ++i)
-      m_c.handle_incoming_tx(tx_blobs[i], tvcs[i], m_tx_relay, false);
+    if (m_txs_batch)
+      m_c.handle_incoming_txs(epee::to_span(tx_blobs), epee::to_mut_span(tvcs), m_tx_relay, false);
+    else
+      for (size_t i = 0; i < tx_blobs.size(); ++i)
+        m_c.handle_incoming_tx(tx_blobs[i], tvcs[i], m_tx_relay, false);
     size_t tx_added = m_c.get_pool_transactions_count() - pool_size;
     bool r = m_validator.check_tx_verification_context_array(tvcs, tx_added, m_ev_index, txs);
     CHECK_AND_NO_ASSERT_MES(r, false, "tx verification context check failed");
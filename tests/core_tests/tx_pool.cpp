@@ -608,6 +608,82 @@ bool txpool_double_spend_keyimage::generate(std::vector<test_event_entry>& event
   return true;
 }
 
+txpool_batch_bad_tx::txpool_batch_bad_tx()
+  : txpool_base()
+{
+  REGISTER_CALLBACK_METHOD(txpool_batch_bad_tx, check_pool_txs);
+}
+
+bool txpool_batch_bad_tx::generate(std::vector<test_event_entry>& events) const
+{
+  uint64_t send_amount = 1000;
+  uint64_t ts_start = 1338224400;
+  GENERATE_ACCOUNT(miner_account);
+  GENERATE_ACCOUNT(bob_account);
+  MAKE_GENESIS_BLOCK(events, blk_0, miner_account, ts_start);
+
+  // each tx spends the coinbase of its own account, so the batch has no conflicts
+  std::vector<cryptonote::account_base> senders(tx_count);
+  cryptonote::block blk_last = blk_0;
+  for (size_t i = 0; i < tx_count; ++i)
+  {
+    senders[i].generate();
+    events.push_back(senders[i]);
+    MAKE_NEXT_BLOCK(events, blk, blk_last, senders[i]);
+    blk_last = blk;
+  }
+  REWIND_BLOCKS(events, blk_r, blk_last, miner_account);
+
+  std::vector<cryptonote::transaction> batch(tx_count);
+  for (size_t i = 0; i < tx_count; ++i)
+  {
+    if (!construct_tx_to_key(events, batch[i], blk_r, senders[i], bob_account, send_amount, TESTS_DEFAULT_FEE, 0))
+      return false;
+  }
+
+  // a bad ring signature is caught when the pool checks the inputs
+  cryptonote::transaction& bad_tx = batch[bad_tx_index];
+  CHECK_AND_ASSERT_MES(!bad_tx.signatures.empty() && !bad_tx.signatures[0].empty(), false, "Expected a tx with ring signatures");
+  bad_tx.signatures[0][0].c.data[0] ^= 1;
+  bad_tx.invalidate_hashes();
+
+  SET_EVENT_VISITOR_SETT(events, event_visitor_settings::set_txs_batch);
+  events.push_back(batch);
+  DO_CALLBACK(events, "check_pool_txs");
+
+  return true;
+}
+
+bool txpool_batch_bad_tx::check_tx_verification_context_array(const std::vector<cryptonote::tx_verification_context>& tvcs, size_t tx_added, size_t /*event_idx*/, const std::vector<cryptonote::transaction>& /*txs*/)
+{
+  CHECK_AND_ASSERT_MES(tvcs.size() == tx_count, false, "Unexpected number of tx verification contexts");
+  CHECK_AND_ASSERT_MES(tx_added == bad_tx_index, false, "Expected " << bad_tx_index << " txs added, got " << tx_added);
+  for (size_t i = 0; i < bad_tx_index; ++i)
+    CHECK_AND_ASSERT_MES(!tvcs[i].m_verifivation_failed && tvcs[i].m_added_to_pool, false, "tx " << i << " before the bad tx was not added");
+  CHECK_AND_ASSERT_MES(tvcs[bad_tx_index].m_verifivation_failed && !tvcs[bad_tx_index].m_added_to_pool, false, "The bad tx was not rejected");
+  // txs after the offence may or may not have been checked, but none is added
+  for (size_t i = bad_tx_index + 1; i < tx_count; ++i)
+    CHECK_AND_ASSERT_MES(!tvcs[i].m_added_to_pool, false, "tx " << i << " after the bad tx was added");
+  return true;
+}
+
+bool txpool_batch_bad_tx::check_pool_txs(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  CHECK_AND_ASSERT_MES(ev_index > 0 && typeid(std::vector<cryptonote::transaction>) == events[ev_index - 1].type(), false, "Expected the batch before the callback");
+  const std::vector<cryptonote::transaction>& batch = boost::get<std::vector<cryptonote::transaction>>(events[ev_index - 1]);
+
+  std::vector<crypto::hash> hashes;
+  CHECK_AND_ASSERT_MES(c.get_pool_transaction_hashes(hashes, true), false, "Failed to get pool tx hashes");
+  const std::unordered_set<crypto::hash> pool_hashes(hashes.begin(), hashes.end());
+  CHECK_AND_ASSERT_MES(pool_hashes.size() == bad_tx_index, false, "Expected " << bad_tx_index << " txs in the pool, got " << pool_hashes.size());
+  for (size_t i = 0; i < tx_count; ++i)
+  {
+    const bool in_pool = pool_hashes.count(cryptonote::get_transaction_hash(batch[i]));
+    CHECK_AND_ASSERT_MES(in_pool == (i < bad_tx_index), false, "tx " << i << (in_pool ? " unexpectedly in" : " missing from") << " the pool");
+  }
+  return true;
+}
+
 bool txpool_stem_loop::generate(std::vector<test_event_entry>& events) const
 {
   INIT_MEMPOOL_TEST();
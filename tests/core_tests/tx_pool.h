@@ -128,6 +128,19 @@ struct txpool_double_spend_keyimage : txpool_double_spend_base
   bool generate(std::vector<test_event_entry>& events) const;
 };
 
+struct txpool_batch_bad_tx : txpool_base
+{
+  static const size_t tx_count = 5;
+  static const size_t bad_tx_index = 2;
+
+  txpool_batch_bad_tx();
+
+  bool generate(std::vector<test_event_entry>& events) const;
+
+  bool check_tx_verification_context_array(const std::vector<cryptonote::tx_verification_context>& tvcs, size_t tx_added, size_t event_idx, const std::vector<cryptonote::transaction>& /*txs*/);
+  bool check_pool_txs(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+};
+
 struct txpool_stem_loop : txpool_double_spend_base
 {
   txpool_stem_loop()
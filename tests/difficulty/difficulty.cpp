@@ -82,6 +82,75 @@ static int test_wide_difficulty(const char *filename)
     return 0;
 }
 
+// replays the data through a difficulty_window, popping and re-pushing blocks now and then,
+// and checks LWMA3 from its running sums against next_difficulty_lwma over the same blocks;
+// solvetimes are multiplied by scale and difficulties by its square
+static int test_difficulty_window(const char *filename, bool monotonic, uint64_t scale)
+{
+    std::vector<uint64_t> timestamps;
+    std::vector<cryptonote::difficulty_type> cumulative_difficulties;
+    fstream data(filename, fstream::in);
+    data.exceptions(fstream::badbit);
+    data.clear(data.rdstate());
+    uint64_t timestamp;
+    uint64_t difficulty;
+    cryptonote::difficulty_type cumulative_difficulty = 0;
+    while (data >> timestamp >> difficulty) {
+        if (!timestamps.empty()) {
+            if (monotonic)
+                timestamp = std::max(timestamp, timestamps.back());
+            timestamp = timestamps.back() + (int64_t)(timestamp - timestamps.back()) * (int64_t)scale;
+        }
+        timestamps.push_back(timestamp);
+        cumulative_difficulties.push_back(cumulative_difficulty += cryptonote::difficulty_type(difficulty) * scale * scale);
+    }
+    if (!data.eof()) {
+        data.clear(fstream::badbit);
+    }
+
+    static const size_t capacity = DIFFICULTY_BLOCKS_COUNT;
+    cryptonote::difficulty_window window(capacity, DEFAULT_TEST_DIFFICULTY_TARGET);
+    size_t n = 0;
+    const auto check = [&](size_t n) {
+        for (size_t count: {(size_t)3, (size_t)31, (size_t)91, capacity}) {
+            const size_t end = n, begin = end - std::min(std::min(count, end), window.size());
+            const std::vector<uint64_t> t(timestamps.begin() + begin, timestamps.begin() + end);
+            const std::vector<cryptonote::difficulty_type> d(cumulative_difficulties.begin() + begin, cumulative_difficulties.begin() + end);
+            for (size_t lwma_window: {(size_t)0, (size_t)30, (size_t)90}) {
+                for (bool hf18: {false, true}) {
+                    for (uint64_t height: {(uint64_t)n, n + ::config::DIFFICULTY_RESCUE_HEIGHT}) {
+                        const cryptonote::difficulty_type expected = cryptonote::next_difficulty_lwma(t, d, DEFAULT_TEST_DIFFICULTY_TARGET, hf18, lwma_window, height, 0);
+                        const cryptonote::difficulty_type res = window.next_difficulty_lwma(count, DEFAULT_TEST_DIFFICULTY_TARGET, hf18, lwma_window, height, 0);
+                        if (res != expected) {
+                            cerr << "Wrong difficulty window LWMA for block " << n << ", count " << count << ", window " << lwma_window << endl
+                                << "Expected: " << expected << endl
+                                << "Found: " << res << endl;
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    };
+    size_t pushes = 0;
+    while (n < timestamps.size()) {
+        window.push_back(timestamps[n], cumulative_difficulties[n]);
+        ++n;
+        ++pushes;
+        if (!check(n))
+            return 1;
+        const size_t pops = pushes % 7 == 0 ? 3 : pushes % 11 == 0 ? 5 : 0;
+        for (size_t i = 0; i < pops && window.size() > 1; ++i) {
+            window.pop_back();
+            --n;
+            if (!check(n))
+                return 1;
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     TRY_ENTRY();
 
@@ -138,6 +207,14 @@ int main(int argc, char *argv[]) {
     if (!data.eof()) {
         data.clear(fstream::badbit);
     }
+
+    for (bool monotonic: {false, true}) {
+        // scaled up so that the safety valve kicks in
+        for (uint64_t scale: {(uint64_t)1, (uint64_t)1000}) {
+            if (test_difficulty_window(argv[1], monotonic, scale))
+                return 1;
+        }
+    }
     return 0;
 
     CATCH_ENTRY_L0("main", 1);
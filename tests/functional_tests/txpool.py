@@ -177,9 +177,23 @@ class TransferTest():
         assert res.pool_stats.num_not_relayed == 0
         assert res.pool_stats.num_double_spends == 0
 
+        res = daemon.get_txpool_changes()
+        assert not res.incremental
+        assert sorted(res.added_tx_hashes) == sorted(txes.keys())
+        assert not 'removed_tx_hashes' in res or len(res.removed_tx_hashes) == 0
+        log_id = res.log_id
+        seq = res.seq
+
         print('Flushing 2 transactions')
         txes_keys = list(txes.keys())
         daemon.flush_txpool([txes_keys[1], txes_keys[3]])
+
+        res = daemon.get_txpool_changes(log_id, seq)
+        assert res.incremental
+        assert res.log_id == log_id
+        assert res.seq == seq + 2
+        assert not 'added_tx_hashes' in res or len(res.added_tx_hashes) == 0
+        assert sorted(res.removed_tx_hashes) == sorted([txes_keys[1], txes_keys[3]])
         res = daemon.get_transaction_pool()
         assert len(res.transactions) == txpool_size - 2
         assert len([x for x in res.transactions if x.id_hash == txes_keys[1]]) == 0
@@ -65,6 +65,9 @@
 #include "multiexp.h"
 #include "sig_mlsag.h"
 #include "sig_clsag.h"
+#include "quantum_safe_sign.h"
+#include "quantum_safe_manager.h"
+#include "txpool_admission.h"
 
 namespace po = boost::program_options;
 
@@ -222,6 +225,21 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 32);
   TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 16384);
 
+  TEST_PERFORMANCE2(filter, p, test_quantum_sign, crypto::quantum_algorithm::XMSS, false);
+  TEST_PERFORMANCE2(filter, p, test_quantum_sign, crypto::quantum_algorithm::XMSS, true);
+  TEST_PERFORMANCE2(filter, p, test_quantum_sign, crypto::quantum_algorithm::SPHINCS_PLUS, false);
+  TEST_PERFORMANCE2(filter, p, test_quantum_sign, crypto::quantum_algorithm::SPHINCS_PLUS, true);
+  TEST_PERFORMANCE0(filter, p, test_quantum_generate_dual_keys);
+  TEST_PERFORMANCE1(filter, p, test_quantum_dual_signature, false);
+  TEST_PERFORMANCE1(filter, p, test_quantum_dual_signature, true);
+  TEST_PERFORMANCE1(filter, p, test_quantum_dual_keys_file, false);
+  TEST_PERFORMANCE1(filter, p, test_quantum_dual_keys_file, true);
+  TEST_PERFORMANCE1(filter, p, test_add_quantum_safe_signatures_to_block, false);
+  TEST_PERFORMANCE1(filter, p, test_add_quantum_safe_signatures_to_block, true);
+
+  TEST_PERFORMANCE1(filter, p, test_txpool_admission, false); // 64 fresh txs on a regtest core, one handle_incoming_tx each
+  TEST_PERFORMANCE1(filter, p, test_txpool_admission, true); // 64 fresh txs on a regtest core, one handle_incoming_txs batch
+
   TEST_PERFORMANCE3(filter, p, test_sig_mlsag, 4, 2, 2); // MLSAG verification
   TEST_PERFORMANCE3(filter, p, test_sig_mlsag, 8, 2, 2);
   TEST_PERFORMANCE3(filter, p, test_sig_mlsag, 16, 2, 2);
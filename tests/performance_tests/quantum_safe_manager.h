@@ -0,0 +1,150 @@
+// Copyright (c) 2024, The QSF Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <boost/filesystem.hpp>
+
+#include "crypto/crypto.h"
+#include "crypto/quantum_safe.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+
+class test_quantum_generate_dual_keys
+{
+public:
+  static const size_t loop_count = 20000;
+
+  bool init()
+  {
+    return true;
+  }
+
+  bool test()
+  {
+    crypto::quantum_safe_manager qmgr;
+    return qmgr.generate_dual_keys();
+  }
+};
+
+template<bool verify>
+class test_quantum_dual_signature
+{
+public:
+  static const size_t loop_count = verify ? 50000 : 10000;
+
+  bool init()
+  {
+    m_message.resize(sizeof(crypto::hash));
+    crypto::rand(m_message.size(), m_message.data());
+    if (!m_qmgr.generate_dual_keys())
+      return false;
+    m_signature = m_qmgr.create_dual_signature(m_message);
+    return !m_signature.empty();
+  }
+
+  bool test()
+  {
+    if (verify)
+      return m_qmgr.verify_dual_signature(m_message, m_signature);
+    m_signature = m_qmgr.create_dual_signature(m_message);
+    return !m_signature.empty();
+  }
+
+private:
+  std::vector<uint8_t> m_message;
+  std::vector<uint8_t> m_signature;
+  crypto::quantum_safe_manager m_qmgr;
+};
+
+template<bool load>
+class test_quantum_dual_keys_file
+{
+public:
+  static const size_t loop_count = 1000;
+
+  ~test_quantum_dual_keys_file()
+  {
+    boost::system::error_code ec;
+    boost::filesystem::remove(m_filename, ec);
+  }
+
+  bool init()
+  {
+    m_filename = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    return m_qmgr.generate_dual_keys() && m_qmgr.save_dual_keys(m_filename);
+  }
+
+  bool test()
+  {
+    if (load)
+    {
+      crypto::quantum_safe_manager qmgr;
+      return qmgr.load_dual_keys(m_filename);
+    }
+    return m_qmgr.save_dual_keys(m_filename);
+  }
+
+private:
+  std::string m_filename;
+  crypto::quantum_safe_manager m_qmgr;
+};
+
+// with_signer uses the long-lived signer, which moves to a new XMSS leaf for
+// each block and rotates keys when the tree is used up
+template<bool with_signer>
+class test_add_quantum_safe_signatures_to_block
+{
+public:
+  static const size_t loop_count = 10000;
+
+  bool init()
+  {
+    m_block.major_version = 1;
+    m_block.minor_version = 1;
+    m_block.timestamp = 1;
+    crypto::rand(sizeof(m_block.prev_id), (uint8_t*)&m_block.prev_id);
+    if (with_signer)
+      return m_signer.init("");
+    return m_qmgr.generate_dual_keys();
+  }
+
+  bool test()
+  {
+    ++m_block.nonce;
+    m_block.invalidate_hashes();
+    if (with_signer)
+      return cryptonote::add_quantum_safe_signatures_to_block(m_block, m_signer);
+    return cryptonote::add_quantum_safe_signatures_to_block(m_block, m_qmgr);
+  }
+
+private:
+  cryptonote::block m_block;
+  crypto::quantum_safe_manager m_qmgr;
+  crypto::quantum_safe_signer m_signer;
+};
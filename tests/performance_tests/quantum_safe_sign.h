@@ -0,0 +1,77 @@
+// Copyright (c) 2024, The QSF Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "crypto/crypto.h"
+#include "crypto/quantum_safe.h"
+
+template<crypto::quantum_algorithm algo, bool verify>
+class test_quantum_sign
+{
+public:
+  static const size_t loop_count = verify ? 100000 : 20000;
+
+  bool init()
+  {
+    crypto::rand(sizeof(m_message), (uint8_t*)&m_message);
+    if (!m_xmss_key.generate() || !m_sphincs_key.generate())
+      return false;
+    m_xmss_pub = m_xmss_key.get_public_key();
+    m_sphincs_pub = m_sphincs_key.get_public_key();
+    m_xmss_sig = m_xmss_key.sign(m_message);
+    m_sphincs_sig = m_sphincs_key.sign(m_message);
+    return true;
+  }
+
+  bool test()
+  {
+    if (algo == crypto::quantum_algorithm::XMSS)
+    {
+      if (verify)
+        return m_xmss_pub.verify(m_message, m_xmss_sig);
+      m_xmss_sig = m_xmss_key.sign(m_message);
+    }
+    else
+    {
+      if (verify)
+        return m_sphincs_pub.verify(m_message, m_sphincs_sig);
+      m_sphincs_sig = m_sphincs_key.sign(m_message);
+    }
+    return true;
+  }
+
+private:
+  crypto::hash m_message;
+  crypto::xmss_private_key m_xmss_key;
+  crypto::xmss_public_key m_xmss_pub;
+  crypto::xmss_signature m_xmss_sig;
+  crypto::sphincs_private_key m_sphincs_key;
+  crypto::sphincs_public_key m_sphincs_pub;
+  crypto::sphincs_signature m_sphincs_sig;
+};
@@ -0,0 +1,216 @@
+// Copyright (c) 2024, The QSF Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_basic/miner.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "ringct/rctOps.h"
+
+// Admission of a flood of fresh RingCT txs through a regtest core: parsing,
+// non-input checks and preverify_tx_inputs, then tx_memory_pool::add_tx with
+// the full ring signature check. init() mines a fake chain whose coinbases
+// fund one tx each, so every tx is distinct and spends real outputs. With
+// batch the txs go through one core::handle_incoming_txs call, which spreads
+// the first stage over the compute threads; without, they go one at a time
+// through core::handle_incoming_tx, as a single-tx relay would. Pool and
+// ring signature caches are warm after the first call, so only a loop count
+// of one measures cold admission.
+template<bool batch>
+class test_txpool_admission
+{
+public:
+  static const size_t loop_count = 1;
+  static const size_t ring_size = 16;
+  static const size_t tx_count = 4 * ring_size;
+
+  ~test_txpool_admission()
+  {
+    if (m_core)
+      m_core->deinit();
+    m_core.reset();
+    if (!m_data_dir.empty())
+    {
+      boost::system::error_code ec;
+      boost::filesystem::remove_all(m_data_dir, ec);
+    }
+  }
+
+  bool init()
+  {
+    using namespace cryptonote;
+
+    m_data_dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("qsf-txpool-admission-%%%%-%%%%");
+
+    boost::program_options::options_description desc;
+    core::init_options(desc);
+    const std::vector<std::string> args = {"--regtest", "--fixed-difficulty=1", "--offline", "--data-dir=" + m_data_dir.string()};
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::command_line_parser(args).options(desc).run(), vm);
+    boost::program_options::notify(vm);
+
+    m_core.reset(new core(nullptr));
+    if (!m_core->init(vm))
+      return false;
+
+    // one coinbase per sender, then enough blocks on top to unlock them all
+    std::vector<account_base> senders(tx_count);
+    std::vector<transaction> miner_txs(tx_count);
+    for (size_t i = 0; i < tx_count; ++i)
+    {
+      senders[i].generate();
+      if (!mine_block(senders[i].get_keys().m_account_address, &miner_txs[i]))
+        return false;
+    }
+    account_base filler;
+    filler.generate();
+    for (size_t i = 0; i < CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW; ++i)
+      if (!mine_block(filler.get_keys().m_account_address, nullptr))
+        return false;
+
+    std::vector<size_t> out_indices(tx_count);
+    std::vector<tx_source_entry::output_entry> ring_members(tx_count);
+    for (size_t i = 0; i < tx_count; ++i)
+    {
+      std::vector<size_t> outs;
+      uint64_t money = 0;
+      if (!lookup_acc_outs(senders[i].get_keys(), miner_txs[i], outs, money) || outs.empty())
+        return false;
+      std::vector<uint64_t> gindices;
+      if (!m_core->get_tx_outputs_gindexs(get_transaction_hash(miner_txs[i]), gindices) || gindices.size() != miner_txs[i].vout.size())
+        return false;
+      crypto::public_key out_key;
+      if (!get_output_public_key(miner_txs[i].vout[outs[0]], out_key))
+        return false;
+      out_indices[i] = outs[0];
+      ring_members[i] = std::make_pair(gindices[outs[0]], rct::ctkey({rct::pk2rct(out_key), rct::zeroCommit(miner_txs[i].vout[outs[0]].amount)}));
+    }
+
+    m_alice.generate();
+    const uint64_t fee = m_core->get_blockchain_storage().get_dynamic_base_fee_estimate(10) * 4000;
+    for (size_t i = 0; i < tx_count; ++i)
+    {
+      // the ring is the block of ring_size coinbases holding the real output
+      const size_t first = i / ring_size * ring_size;
+      const uint64_t amount = miner_txs[i].vout[out_indices[i]].amount;
+      if (amount <= fee + 1)
+        return false;
+
+      tx_source_entry source;
+      source.amount = amount;
+      source.outputs.assign(ring_members.begin() + first, ring_members.begin() + first + ring_size);
+      source.real_output = i - first;
+      source.real_out_tx_key = get_tx_pub_key_from_extra(miner_txs[i]);
+      source.real_output_in_tx_index = out_indices[i];
+      source.mask = rct::identity();
+      source.rct = true;
+      std::vector<tx_source_entry> sources(1, source);
+
+      std::vector<tx_destination_entry> destinations;
+      destinations.push_back(tx_destination_entry(amount - fee - 1, m_alice.get_keys().m_account_address, false));
+      destinations.push_back(tx_destination_entry(1, m_alice.get_keys().m_account_address, false));
+
+      transaction tx;
+      crypto::secret_key tx_key;
+      std::vector<crypto::secret_key> additional_tx_keys;
+      std::unordered_map<crypto::public_key, subaddress_index> subaddresses;
+      subaddresses[senders[i].get_keys().m_account_address.m_spend_public_key] = {0,0};
+      rct::RCTConfig rct_config{rct::RangeProofPaddedBulletproof, 4};
+      if (!construct_tx_and_get_tx_key(senders[i].get_keys(), subaddresses, sources, destinations, boost::none, std::vector<uint8_t>(), tx, tx_key, additional_tx_keys, true, rct_config, true))
+        return false;
+      m_blobs.push_back(tx_to_blob(tx));
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    using namespace cryptonote;
+
+    std::vector<tx_verification_context> tvcs(tx_count);
+    if (batch)
+    {
+      if (!m_core->handle_incoming_txs(epee::to_span(m_blobs), epee::to_mut_span(tvcs), relay_method::fluff, false))
+        return false;
+    }
+    else
+    {
+      for (size_t i = 0; i < tx_count; ++i)
+        if (!m_core->handle_incoming_tx(m_blobs[i], tvcs[i], relay_method::fluff, false))
+          return false;
+    }
+
+    for (const tx_verification_context &tvc: tvcs)
+      if (tvc.m_verifivation_failed)
+        return false;
+    // later calls find the txs already in the pool
+    return m_core->get_pool_transactions_count() == tx_count;
+  }
+
+private:
+  bool mine_block(const cryptonote::account_public_address &address, cryptonote::transaction *miner_tx)
+  {
+    using namespace cryptonote;
+
+    block b;
+    difficulty_type diffic;
+    uint64_t height, expected_reward, seed_height;
+    crypto::hash seed_hash;
+    if (!m_core->get_block_template(b, address, diffic, height, expected_reward, blobdata(), seed_height, seed_hash))
+      return false;
+    const Blockchain &bc = m_core->get_blockchain_storage();
+    if (!miner::find_nonce_for_given_block([&bc](const block &b, uint64_t height, const crypto::hash *seed_hash, unsigned int threads, crypto::hash &hash) {
+        return get_block_longhash(&bc, b, hash, height, seed_hash, threads);
+      }, b, diffic, height, &seed_hash))
+      return false;
+    block_verification_context bvc{};
+    if (!m_core->handle_block_found(b, bvc) || !bvc.m_added_to_main_chain)
+      return false;
+    if (miner_tx)
+      *miner_tx = b.miner_tx;
+    return true;
+  }
+
+  std::unique_ptr<cryptonote::core> m_core;
+  boost::filesystem::path m_data_dir;
+  cryptonote::account_base m_alice;
+  std::vector<cryptonote::blobdata> m_blobs;
+};
@@ -39,6 +39,9 @@
 #include "blockchain_db/blockchain_db.h"
 #include "blockchain_db/lmdb/db_lmdb.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_basic/account.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "crypto/quantum_safe.h"
 
 using namespace cryptonote;
 using epee::string_tools::pod_to_hex;
@@ -341,4 +344,117 @@ TYPED_TEST(BlockchainDBTest, RetrieveBlockData)
   ASSERT_HASH_EQ(get_block_hash(this->m_blocks[1].first), hashes[1]);
 }
 
+// a block at the given height, with quantum signatures unless unsigned
+std::pair<block, blobdata> make_quantum_block(uint64_t height, const crypto::hash &prev_id, bool sign)
+{
+  account_base miner;
+  miner.generate();
+  block b;
+  b.major_version = 1;
+  b.prev_id = prev_id;
+  CHECK_AND_ASSERT_THROW_MES(construct_miner_tx(height, 0, 0, 0, 0, miner.get_keys().m_account_address, b.miner_tx), "Failed to construct miner tx");
+  if (sign)
+  {
+    reserve_quantum_signature_slots(b);
+    crypto::quantum_safe_signer signer;
+    CHECK_AND_ASSERT_THROW_MES(signer.init(""), "Failed to init quantum signer");
+    CHECK_AND_ASSERT_THROW_MES(add_quantum_safe_signatures_to_block(b, signer), "Failed to sign block");
+  }
+  return std::make_pair(b, block_to_blob(b));
+}
+
+TEST(BlockchainLMDB, migrate_5_6)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  std::vector<std::pair<block, blobdata>> blocks;
+  blocks.push_back(make_quantum_block(0, crypto::null_hash, true));
+  blocks.push_back(make_quantum_block(1, get_block_hash(blocks[0].first), false));
+  blocks.push_back(make_quantum_block(2, get_block_hash(blocks[1].first), true));
+
+  // write a v6 db
+  {
+    BlockchainLMDB db;
+    HardFork hardfork(db, 1, 0);
+    ASSERT_NO_THROW(db.open(dirPath));
+    hardfork.init();
+    db.set_hard_fork(&hardfork);
+    {
+      db_wtxn_guard guard(&db);
+      for (size_t i = 0; i < blocks.size(); ++i)
+        ASSERT_NO_THROW(db.add_block(blocks[i], 1000, 1000, i + 1, 0, {}));
+    }
+    ASSERT_NO_THROW(db.close());
+  }
+
+  // turn it back into what a v5 db looked like: full blobs in blocks, no
+  // block_quantum_sigs entries
+  MDB_env *env;
+  MDB_txn *txn;
+  MDB_dbi dbi_blocks, dbi_quantum_sigs, dbi_properties;
+  MDB_val k, v;
+  ASSERT_EQ(0, mdb_env_create(&env));
+  ASSERT_EQ(0, mdb_env_set_maxdbs(env, 32));
+  ASSERT_EQ(0, mdb_env_open(env, dirPath.c_str(), 0, 0644));
+  ASSERT_EQ(0, mdb_txn_begin(env, NULL, 0, &txn));
+  ASSERT_EQ(0, mdb_dbi_open(txn, "blocks", MDB_INTEGERKEY, &dbi_blocks));
+  ASSERT_EQ(0, mdb_dbi_open(txn, "block_quantum_sigs", MDB_INTEGERKEY, &dbi_quantum_sigs));
+  ASSERT_EQ(0, mdb_dbi_open(txn, "properties", 0, &dbi_properties));
+  for (uint64_t height = 0; height < blocks.size(); ++height)
+  {
+    k = {sizeof(height), (void*)&height};
+    ASSERT_EQ(0, mdb_get(txn, dbi_blocks, &k, &v));
+    ASSERT_LE(v.mv_size, blocks[height].second.size());
+    v = {blocks[height].second.size(), (void*)blocks[height].second.data()};
+    ASSERT_EQ(0, mdb_put(txn, dbi_blocks, &k, &v, 0));
+  }
+  ASSERT_EQ(0, mdb_drop(txn, dbi_quantum_sigs, 1));
+  uint32_t version = 5;
+  k = {sizeof("version"), (void*)"version"};
+  v = {sizeof(version), (void*)&version};
+  ASSERT_EQ(0, mdb_put(txn, dbi_properties, &k, &v, 0));
+  ASSERT_EQ(0, mdb_txn_commit(txn));
+  mdb_env_close(env);
+
+  // opening it migrates it
+  {
+    BlockchainLMDB db;
+    ASSERT_NO_THROW(db.open(dirPath));
+    ASSERT_EQ(blocks.size(), db.height());
+    for (uint64_t height = 0; height < blocks.size(); ++height)
+    {
+      ASSERT_EQ(blocks[height].second, db.get_block_blob_from_height(height));
+      ASSERT_HASH_EQ(get_block_hash(blocks[height].first), db.get_block_hash_from_height(height));
+    }
+    ASSERT_NO_THROW(db.close());
+  }
+
+  ASSERT_EQ(0, mdb_env_create(&env));
+  ASSERT_EQ(0, mdb_env_set_maxdbs(env, 32));
+  ASSERT_EQ(0, mdb_env_open(env, dirPath.c_str(), MDB_RDONLY, 0644));
+  ASSERT_EQ(0, mdb_txn_begin(env, NULL, MDB_RDONLY, &txn));
+  ASSERT_EQ(0, mdb_dbi_open(txn, "blocks", MDB_INTEGERKEY, &dbi_blocks));
+  ASSERT_EQ(0, mdb_dbi_open(txn, "block_quantum_sigs", MDB_INTEGERKEY, &dbi_quantum_sigs));
+  ASSERT_EQ(0, mdb_dbi_open(txn, "properties", 0, &dbi_properties));
+  k = {sizeof("version"), (void*)"version"};
+  ASSERT_EQ(0, mdb_get(txn, dbi_properties, &k, &v));
+  ASSERT_EQ(6u, *(const uint32_t*)v.mv_data);
+  for (uint64_t height = 0; height < blocks.size(); ++height)
+  {
+    // blocks hold stripped blobs again, and the signatures their own entry
+    blobdata stripped, qs;
+    ASSERT_TRUE(split_block_quantum_signatures(blocks[height].second, blocks[height].first, stripped, qs));
+    k = {sizeof(height), (void*)&height};
+    ASSERT_EQ(0, mdb_get(txn, dbi_blocks, &k, &v));
+    ASSERT_EQ(stripped, blobdata((const char*)v.mv_data, v.mv_size));
+    ASSERT_EQ(0, mdb_get(txn, dbi_quantum_sigs, &k, &v));
+    ASSERT_EQ(qs, blobdata((const char*)v.mv_data, v.mv_size));
+  }
+  mdb_txn_abort(txn);
+  mdb_env_close(env);
+
+  boost::filesystem::remove_all(tempPath);
+}
+
 }  // anonymous namespace
@@ -0,0 +1,132 @@
+// Copyright (c) 2014-2022, The QSF Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+#include "crypto/quantum_safe.h"
+
+namespace
+{
+  // signed layouts: signature_hash (32) || message (32) || ...
+  const size_t SIG_HASH_OFFSET = 0;
+  const size_t MESSAGE_OFFSET = sizeof(crypto::hash);
+  // XMSS: ... || index (4) || nonce (32) || filler, then the index again
+  const size_t XMSS_NONCE_OFFSET = sizeof(crypto::hash) * 2 + sizeof(uint32_t);
+  const size_t XMSS_TRAILING_INDEX_OFFSET = crypto::xmss_signature::SIGNATURE_SIZE;
+  // SPHINCS+: ... || nonce (32) || filler
+  const size_t SPHINCS_NONCE_OFFSET = sizeof(crypto::hash) * 2;
+
+  void check_round_trip(crypto::quantum_algorithm algo)
+  {
+    crypto::quantum_safe_manager manager;
+    ASSERT_TRUE(manager.generate_keys(algo));
+    const crypto::hash message = crypto::rand<crypto::hash>();
+    const std::vector<uint8_t> signature = manager.sign(message, algo);
+    ASSERT_FALSE(signature.empty());
+    ASSERT_TRUE(manager.verify(message, signature, algo));
+
+    // a verifier holding only the public key
+    crypto::quantum_safe_manager verifier;
+    ASSERT_TRUE(verifier.generate_keys(algo));
+    ASSERT_FALSE(verifier.verify(message, signature, algo));
+  }
+
+  void check_message_tamper(crypto::quantum_algorithm algo)
+  {
+    crypto::quantum_safe_manager manager;
+    ASSERT_TRUE(manager.generate_keys(algo));
+    const crypto::hash message = crypto::rand<crypto::hash>();
+    const std::vector<uint8_t> signature = manager.sign(message, algo);
+    ASSERT_TRUE(manager.verify(message, signature, algo));
+    for (size_t bit = 0; bit < sizeof(crypto::hash) * 8; bit += 7)
+    {
+      crypto::hash tampered = message;
+      tampered.data[bit / 8] ^= 1 << (bit % 8);
+      ASSERT_FALSE(manager.verify(tampered, signature, algo)) << "bit " << bit;
+    }
+  }
+
+  void check_signature_tamper(crypto::quantum_algorithm algo, const std::vector<size_t> &offsets)
+  {
+    crypto::quantum_safe_manager manager;
+    ASSERT_TRUE(manager.generate_keys(algo));
+    const crypto::hash message = crypto::rand<crypto::hash>();
+    const std::vector<uint8_t> signature = manager.sign(message, algo);
+    ASSERT_TRUE(manager.verify(message, signature, algo));
+    for (size_t offset: offsets)
+    {
+      for (size_t bit = 0; bit < 8; ++bit)
+      {
+        std::vector<uint8_t> tampered = signature;
+        ASSERT_LT(offset, tampered.size());
+        tampered[offset] ^= 1 << bit;
+        ASSERT_FALSE(manager.verify(message, tampered, algo)) << "byte " << offset << " bit " << bit;
+      }
+    }
+  }
+}
+
+TEST(quantum_safe, xmss_sign_verify)
+{
+  check_round_trip(crypto::quantum_algorithm::XMSS);
+}
+
+TEST(quantum_safe, xmss_tampered_message)
+{
+  check_message_tamper(crypto::quantum_algorithm::XMSS);
+}
+
+TEST(quantum_safe, xmss_tampered_signature)
+{
+  check_signature_tamper(crypto::quantum_algorithm::XMSS, {
+    SIG_HASH_OFFSET, SIG_HASH_OFFSET + 31,
+    MESSAGE_OFFSET, MESSAGE_OFFSET + 31,
+    XMSS_NONCE_OFFSET, XMSS_NONCE_OFFSET + 31,
+    XMSS_TRAILING_INDEX_OFFSET, XMSS_TRAILING_INDEX_OFFSET + 3
+  });
+}
+
+TEST(quantum_safe, sphincs_sign_verify)
+{
+  check_round_trip(crypto::quantum_algorithm::SPHINCS_PLUS);
+}
+
+TEST(quantum_safe, sphincs_tampered_message)
+{
+  check_message_tamper(crypto::quantum_algorithm::SPHINCS_PLUS);
+}
+
+TEST(quantum_safe, sphincs_tampered_signature)
+{
+  check_signature_tamper(crypto::quantum_algorithm::SPHINCS_PLUS, {
+    SIG_HASH_OFFSET, SIG_HASH_OFFSET + 31,
+    MESSAGE_OFFSET, MESSAGE_OFFSET + 31,
+    SPHINCS_NONCE_OFFSET, SPHINCS_NONCE_OFFSET + 31
+  });
+}
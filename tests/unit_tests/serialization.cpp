@@ -304,6 +304,32 @@ TEST(Serialization, serializes_vector_int64_as_fixed_int)
   ASSERT_EQ(57, blob.size());
 }
 
+TEST(Serialization, serializes_static_vector_like_vector)
+{
+  std::vector<uint8_t> v;
+  boost::container::static_vector<uint8_t, 4> sv;
+  string blob, sv_blob;
+
+  for (uint8_t i = 0; i < 4; ++i)
+  {
+    ASSERT_TRUE(serialization::dump_binary(v, blob));
+    ASSERT_TRUE(serialization::dump_binary(sv, sv_blob));
+    ASSERT_EQ(blob, sv_blob);
+    v.push_back(0xF0 + i);
+    sv.push_back(0xF0 + i);
+  }
+  ASSERT_TRUE(serialization::dump_binary(v, blob));
+
+  boost::container::static_vector<uint8_t, 4> parsed;
+  ASSERT_TRUE(serialization::parse_binary(blob, parsed));
+  ASSERT_EQ(sv, parsed);
+
+  // more elements than the capacity
+  v.push_back(0);
+  ASSERT_TRUE(serialization::dump_binary(v, blob));
+  ASSERT_FALSE(serialization::parse_binary(blob, parsed));
+}
+
 namespace
 {
   template<typename T>
@@ -36,6 +36,9 @@
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/tx_extra.h"
 #include "cryptonote_core/cryptonote_tx_utils.h"
+#include "crypto/quantum_safe.h"
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
 
 namespace
 {
@@ -357,3 +360,143 @@ TEST(remove_field_from_tx_extra, invalid_varint)
   ASSERT_FALSE(cryptonote::remove_field_from_tx_extra(extra, typeid(cryptonote::tx_extra_nonce)));
   ASSERT_EQ(sizeof(extra_arr), extra.size());
 }
+
+namespace
+{
+  // a block signed the way core::handle_block_found signs mined blocks
+  bool make_signed_block(cryptonote::block &b, crypto::hash &id)
+  {
+    cryptonote::account_base miner;
+    miner.generate();
+    b = cryptonote::block{};
+    b.major_version = HF_VERSION_BLOCK_SIGNATURE_FORMAT;
+    if (!cryptonote::construct_miner_tx(0, 0, 0, 0, 0, miner.get_keys().m_account_address, b.miner_tx))
+      return false;
+    cryptonote::reserve_quantum_signature_slots(b);
+    id = cryptonote::get_block_hash(b);
+
+    crypto::quantum_safe_signer signer;
+    if (!signer.init(""))
+      return false;
+    return cryptonote::add_quantum_safe_signatures_to_block(b, signer);
+  }
+}
+
+TEST(check_block_quantum_signature_format, accepts_signatures_over_the_block_id)
+{
+  cryptonote::block b;
+  crypto::hash id;
+  ASSERT_TRUE(make_signed_block(b, id));
+  ASSERT_TRUE(cryptonote::check_block_quantum_signature_format(b, id));
+}
+
+TEST(check_block_quantum_signature_format, rejects_another_block_id)
+{
+  cryptonote::block b;
+  crypto::hash id;
+  ASSERT_TRUE(make_signed_block(b, id));
+  id.data[0] ^= 1;
+  ASSERT_FALSE(cryptonote::check_block_quantum_signature_format(b, id));
+}
+
+TEST(check_block_quantum_signature_format, rejects_tampered_signature)
+{
+  cryptonote::block b;
+  crypto::hash id;
+  ASSERT_TRUE(make_signed_block(b, id));
+
+  // XMSS part: length (4) || signature hash (32) || message (32) || ...
+  cryptonote::block tampered = b;
+  tampered.quantum_signatures.xmss_signature[4 + 32 + 4] ^= 1;
+  ASSERT_FALSE(cryptonote::check_block_quantum_signature_format(tampered, id));
+
+  tampered = b;
+  tampered.quantum_signatures.xmss_signature[4] ^= 1;
+  ASSERT_FALSE(cryptonote::check_block_quantum_signature_format(tampered, id));
+
+  tampered = b;
+  tampered.quantum_signatures.sphincs_signature.pop_back();
+  ASSERT_FALSE(cryptonote::check_block_quantum_signature_format(tampered, id));
+}
+
+TEST(check_block_quantum_signature_format, rejects_reserved_slots)
+{
+  cryptonote::block b;
+  cryptonote::reserve_quantum_signature_slots(b);
+  ASSERT_FALSE(cryptonote::check_block_quantum_signature_format(b, crypto::null_hash));
+}
+
+TEST(block_quantum_signatures, split_join_round_trip)
+{
+  cryptonote::block b;
+  crypto::hash id;
+  ASSERT_TRUE(make_signed_block(b, id));
+  const cryptonote::blobdata blob = cryptonote::block_to_blob(b);
+
+  cryptonote::blobdata stripped, qs, joined;
+  ASSERT_TRUE(cryptonote::split_block_quantum_signatures(blob, b, stripped, qs));
+  ASSERT_LT(stripped.size(), blob.size());
+  ASSERT_EQ(qs, cryptonote::t_serializable_object_to_blob(b.quantum_signatures));
+  ASSERT_TRUE(cryptonote::join_block_quantum_signatures(stripped, qs, joined));
+  ASSERT_EQ(blob, joined);
+
+  // the stripped blob is a block with empty signature fields
+  cryptonote::block sb;
+  ASSERT_TRUE(cryptonote::parse_and_validate_block_from_stripped_blob(stripped, sb));
+  ASSERT_TRUE(sb.quantum_signatures.xmss_signature.empty());
+  ASSERT_TRUE(sb.quantum_signatures.sphincs_signature.empty());
+  ASSERT_TRUE(sb.quantum_signatures.dual_public_key.empty());
+}
+
+TEST(block_quantum_signatures, split_join_round_trip_unsigned)
+{
+  cryptonote::block b;
+  crypto::hash id;
+  ASSERT_TRUE(make_signed_block(b, id));
+  b.quantum_signatures = cryptonote::block::quantum_signature_data();
+  const cryptonote::blobdata blob = cryptonote::block_to_blob(b);
+
+  cryptonote::blobdata stripped, qs, joined;
+  ASSERT_TRUE(cryptonote::split_block_quantum_signatures(blob, b, stripped, qs));
+  ASSERT_EQ(blob, stripped);
+  ASSERT_TRUE(cryptonote::join_block_quantum_signatures(stripped, qs, joined));
+  ASSERT_EQ(blob, joined);
+}
+
+TEST(block_quantum_signatures, split_rejects_mismatched_block)
+{
+  cryptonote::block b;
+  crypto::hash id;
+  ASSERT_TRUE(make_signed_block(b, id));
+  const cryptonote::blobdata blob = cryptonote::block_to_blob(b);
+
+  cryptonote::block other = b;
+  other.quantum_signatures.xmss_signature[0] ^= 1;
+  cryptonote::blobdata stripped, qs;
+  ASSERT_FALSE(cryptonote::split_block_quantum_signatures(blob, other, stripped, qs));
+
+  // a full blob is not a stripped one
+  cryptonote::blobdata joined;
+  ASSERT_FALSE(cryptonote::join_block_quantum_signatures(blob, qs, joined));
+}
+
+TEST(block_quantum_signatures, stripped_blob_has_the_block_hash)
+{
+  cryptonote::block b;
+  crypto::hash id;
+  ASSERT_TRUE(make_signed_block(b, id));
+  const cryptonote::blobdata blob = cryptonote::block_to_blob(b);
+  cryptonote::blobdata stripped, qs;
+  ASSERT_TRUE(cryptonote::split_block_quantum_signatures(blob, b, stripped, qs));
+
+  cryptonote::block full_block, stripped_block;
+  crypto::hash full_hash, stripped_hash;
+  ASSERT_TRUE(cryptonote::parse_and_validate_block_from_blob(blob, full_block, full_hash));
+  ASSERT_TRUE(cryptonote::parse_and_validate_block_from_stripped_blob(stripped, stripped_block, &stripped_hash));
+  ASSERT_EQ(full_hash, stripped_hash);
+  ASSERT_EQ(id, stripped_hash);
+  ASSERT_EQ(full_hash, cryptonote::get_block_hash(stripped_block));
+
+  // the full blob parser still wants the signatures
+  ASSERT_FALSE(cryptonote::parse_and_validate_block_from_blob(stripped, stripped_block));
+}
@@ -0,0 +1,339 @@
+// Copyright (c) 2014-2022, The QSF Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <unordered_map>
+
+#include "gtest/gtest.h"
+#include "cryptonote_core/blockchain.h"
+#include "cryptonote_core/tx_pool.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "blockchain_db/testdb.h"
+
+namespace
+{
+
+// a chain of weightless blocks and an in-memory txpool with batch rollback
+class TestDB: public cryptonote::BaseTestDB
+{
+public:
+  TestDB(): in_batch(false), fail_writes(false), writes(0) { m_open = true; }
+
+  virtual void add_block( const cryptonote::block& blk
+                        , size_t block_weight
+                        , uint64_t long_term_block_weight
+                        , const cryptonote::difficulty_type& cumulative_difficulty
+                        , const uint64_t& coins_generated
+                        , uint64_t num_rct_outs
+                        , const crypto::hash& blk_hash
+                        ) override {
+    ++blocks;
+  }
+  virtual uint64_t height() const override { return blocks; }
+  virtual size_t get_block_weight(const uint64_t &h) const override { return 0; }
+  virtual uint64_t get_block_long_term_weight(const uint64_t &h) const override { return 0; }
+  virtual std::vector<uint64_t> get_block_weights(uint64_t start_height, size_t count) const override {
+    return std::vector<uint64_t>(std::min<uint64_t>(count, blocks - std::min(start_height, blocks)), 0);
+  }
+  virtual std::vector<uint64_t> get_long_term_block_weights(uint64_t start_height, size_t count) const override {
+    return get_block_weights(start_height, count);
+  }
+  virtual crypto::hash get_block_hash_from_height(const uint64_t &height) const override {
+    crypto::hash hash = crypto::null_hash;
+    *(uint64_t*)&hash = height;
+    return hash;
+  }
+  virtual crypto::hash top_block_hash(uint64_t *block_height = NULL) const override {
+    crypto::hash top = crypto::null_hash;
+    if (blocks)
+      *(uint64_t*)&top = blocks - 1;
+    if (block_height)
+      *block_height = blocks - 1;
+    return top;
+  }
+  virtual void pop_block(cryptonote::block &blk, std::vector<cryptonote::transaction> &txs) override { --blocks; }
+
+  virtual bool batch_start(uint64_t batch_num_blocks=0, uint64_t batch_bytes=0) override {
+    if (in_batch)
+      return false;
+    in_batch = true;
+    saved_txpool = txpool;
+    return true;
+  }
+  virtual void batch_stop() override { in_batch = false; }
+  virtual void batch_abort() override { txpool = saved_txpool; in_batch = false; }
+
+  virtual void add_txpool_tx(const crypto::hash &txid, const cryptonote::blobdata_ref &blob, const cryptonote::txpool_tx_meta_t& details) override {
+    if (fail_writes)
+      throw cryptonote::DB_ERROR("Injected txpool write failure");
+    if (!txpool.emplace(txid, std::make_pair(cryptonote::blobdata(blob.data(), blob.size()), details)).second)
+      throw cryptonote::DB_ERROR("Attempting to add txpool tx that's already in the db");
+    ++writes;
+  }
+  virtual void update_txpool_tx(const crypto::hash &txid, const cryptonote::txpool_tx_meta_t& details) override {
+    if (fail_writes)
+      throw cryptonote::DB_ERROR("Injected txpool write failure");
+    const auto it = txpool.find(txid);
+    if (it == txpool.end())
+      throw cryptonote::DB_ERROR("Error finding txpool tx meta to update");
+    it->second.second = details;
+    ++writes;
+  }
+  virtual void remove_txpool_tx(const crypto::hash& txid) override {
+    txpool.erase(txid);
+    ++writes;
+  }
+  virtual uint64_t get_txpool_tx_count(cryptonote::relay_category category = cryptonote::relay_category::broadcasted) const override {
+    uint64_t count = 0;
+    for (const auto &e: txpool)
+      count += e.second.second.matches(category);
+    return count;
+  }
+  virtual bool txpool_has_tx(const crypto::hash &txid, cryptonote::relay_category category) const override {
+    const auto it = txpool.find(txid);
+    return it != txpool.end() && it->second.second.matches(category);
+  }
+  virtual bool get_txpool_tx_meta(const crypto::hash& txid, cryptonote::txpool_tx_meta_t &meta) const override {
+    const auto it = txpool.find(txid);
+    if (it == txpool.end())
+      return false;
+    meta = it->second.second;
+    return true;
+  }
+  virtual bool get_txpool_tx_blob(const crypto::hash& txid, cryptonote::blobdata &bd, cryptonote::relay_category category) const override {
+    const auto it = txpool.find(txid);
+    if (it == txpool.end() || !it->second.second.matches(category))
+      return false;
+    bd = it->second.first;
+    return true;
+  }
+  virtual cryptonote::blobdata get_txpool_tx_blob(const crypto::hash& txid, cryptonote::relay_category category) const override {
+    cryptonote::blobdata bd;
+    if (!get_txpool_tx_blob(txid, bd, category))
+      throw cryptonote::DB_ERROR("Tx not found in txpool");
+    return bd;
+  }
+  virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash&, const cryptonote::txpool_tx_meta_t&, const cryptonote::blobdata_ref*)> f, bool include_blob = false, cryptonote::relay_category category = cryptonote::relay_category::broadcasted) const override {
+    for (const auto &e: txpool)
+    {
+      if (!e.second.second.matches(category))
+        continue;
+      const cryptonote::blobdata_ref bd = e.second.first;
+      if (!f(e.first, e.second.second, include_blob ? &bd : NULL))
+        return false;
+    }
+    return true;
+  }
+
+  bool in_batch;
+  bool fail_writes;
+  size_t writes;
+  std::unordered_map<crypto::hash, std::pair<cryptonote::blobdata, cryptonote::txpool_tx_meta_t>> txpool;
+
+private:
+  uint64_t blocks = 0;
+  std::unordered_map<crypto::hash, std::pair<cryptonote::blobdata, cryptonote::txpool_tx_meta_t>> saved_txpool;
+};
+
+cryptonote::txpool_tx_meta_t make_meta(cryptonote::relay_method method, uint64_t fee = 0)
+{
+  cryptonote::txpool_tx_meta_t meta{};
+  meta.fee = fee;
+  meta.set_relay_method(method);
+  return meta;
+}
+
+struct BlockchainAndPool
+{
+  cryptonote::tx_memory_pool txpool;
+  cryptonote::Blockchain bc;
+  TestDB *db;
+  BlockchainAndPool(): txpool(bc), bc(txpool), db(new TestDB()) {}
+};
+
+#define PREFIX \
+  BlockchainAndPool bap; \
+  cryptonote::Blockchain *bc = &bap.bc; \
+  TestDB *db = bap.db; \
+  const std::pair<uint8_t, uint64_t> hard_forks[2] = {std::make_pair(1, (uint64_t)0), std::make_pair((uint8_t)0, (uint64_t)0)}; \
+  const cryptonote::test_options test_options = {hard_forks, 0}; \
+  ASSERT_TRUE(bc->init(db, cryptonote::FAKECHAIN, true, &test_options, 0, NULL)); \
+  bc->set_txpool_write_behind(true); \
+  const size_t writes_after_init = db->writes
+
+}
+
+TEST(txpool_write_behind, add_update_remove_visibility)
+{
+  PREFIX;
+  const crypto::hash a = crypto::rand<crypto::hash>(), b = crypto::rand<crypto::hash>();
+
+  bc->add_txpool_tx(a, "blob a", make_meta(cryptonote::relay_method::block, 10));
+  bc->add_txpool_tx(b, "blob b", make_meta(cryptonote::relay_method::block, 20));
+  ASSERT_EQ(writes_after_init, db->writes);
+  ASSERT_TRUE(db->txpool.empty());
+  ASSERT_EQ(2u, bc->get_txpool_pending_write_count());
+  ASSERT_THROW(bc->add_txpool_tx(a, "blob a", make_meta(cryptonote::relay_method::block)), cryptonote::DB_ERROR);
+
+  cryptonote::txpool_tx_meta_t meta;
+  ASSERT_TRUE(bc->get_txpool_tx_meta(a, meta));
+  ASSERT_EQ(10u, meta.fee);
+  ASSERT_EQ("blob b", bc->get_txpool_tx_blob(b, cryptonote::relay_category::broadcasted));
+  ASSERT_TRUE(bc->txpool_has_tx(a, cryptonote::relay_category::broadcasted));
+
+  bc->update_txpool_tx(a, make_meta(cryptonote::relay_method::block, 11));
+  ASSERT_TRUE(bc->get_txpool_tx_meta(a, meta));
+  ASSERT_EQ(11u, meta.fee);
+  ASSERT_EQ("blob a", bc->get_txpool_tx_blob(a, cryptonote::relay_category::broadcasted));
+
+  bc->remove_txpool_tx(b);
+  ASSERT_FALSE(bc->txpool_has_tx(b, cryptonote::relay_category::all));
+  ASSERT_FALSE(bc->get_txpool_tx_meta(b, meta));
+  ASSERT_THROW(bc->update_txpool_tx(b, make_meta(cryptonote::relay_method::block)), cryptonote::DB_ERROR);
+
+  std::unordered_map<crypto::hash, cryptonote::blobdata> seen;
+  ASSERT_TRUE(bc->for_all_txpool_txes([&seen](const crypto::hash &txid, const cryptonote::txpool_tx_meta_t&, const cryptonote::blobdata_ref *bd) {
+    seen[txid] = cryptonote::blobdata(bd->data(), bd->size());
+    return true;
+  }, true));
+  ASSERT_EQ(1u, seen.size());
+  ASSERT_EQ("blob a", seen[a]);
+
+  // the db sees the same once flushed
+  ASSERT_EQ(2u, bc->flush_txpool_writes());
+  ASSERT_EQ(0u, bc->get_txpool_pending_write_count());
+  ASSERT_EQ(1u, db->txpool.size());
+  ASSERT_EQ("blob a", db->txpool[a].first);
+  ASSERT_EQ(11u, db->txpool[a].second.fee);
+
+  // metadata updates of flushed txes are deferred too, and keep the db blob
+  bc->update_txpool_tx(a, make_meta(cryptonote::relay_method::block, 12));
+  ASSERT_EQ(11u, db->txpool[a].second.fee);
+  ASSERT_TRUE(bc->get_txpool_tx_meta(a, meta));
+  ASSERT_EQ(12u, meta.fee);
+  ASSERT_EQ("blob a", bc->get_txpool_tx_blob(a, cryptonote::relay_category::broadcasted));
+  ASSERT_EQ(1u, bc->flush_txpool_writes());
+  ASSERT_EQ(12u, db->txpool[a].second.fee);
+
+  // and so are removals of flushed txes
+  bc->remove_txpool_tx(a);
+  ASSERT_EQ(1u, db->txpool.size());
+  ASSERT_FALSE(bc->txpool_has_tx(a, cryptonote::relay_category::all));
+  seen.clear();
+  ASSERT_TRUE(bc->for_all_txpool_txes([&seen](const crypto::hash &txid, const cryptonote::txpool_tx_meta_t&, const cryptonote::blobdata_ref*) {
+    seen[txid];
+    return true;
+  }, false, cryptonote::relay_category::all));
+  ASSERT_TRUE(seen.empty());
+  ASSERT_EQ(1u, bc->flush_txpool_writes());
+  ASSERT_TRUE(db->txpool.empty());
+}
+
+TEST(txpool_write_behind, count)
+{
+  PREFIX;
+  const crypto::hash a = crypto::rand<crypto::hash>(), b = crypto::rand<crypto::hash>(), c = crypto::rand<crypto::hash>();
+
+  bc->add_txpool_tx(a, "a", make_meta(cryptonote::relay_method::block));
+  bc->add_txpool_tx(b, "b", make_meta(cryptonote::relay_method::local));
+  ASSERT_EQ(1u, bc->get_txpool_tx_count(false));
+  ASSERT_EQ(2u, bc->get_txpool_tx_count(true));
+  ASSERT_EQ(2u, bc->flush_txpool_writes());
+  ASSERT_EQ(1u, bc->get_txpool_tx_count(false));
+  ASSERT_EQ(2u, bc->get_txpool_tx_count(true));
+
+  // txes in both the db and the overlay are counted once, by their overlay state
+  bc->update_txpool_tx(b, make_meta(cryptonote::relay_method::fluff));
+  ASSERT_EQ(2u, bc->get_txpool_tx_count(false));
+  ASSERT_EQ(2u, bc->get_txpool_tx_count(true));
+  bc->remove_txpool_tx(a);
+  bc->add_txpool_tx(c, "c", make_meta(cryptonote::relay_method::local));
+  ASSERT_EQ(1u, bc->get_txpool_tx_count(false));
+  ASSERT_EQ(2u, bc->get_txpool_tx_count(true));
+
+  ASSERT_EQ(3u, bc->flush_txpool_writes());
+  ASSERT_EQ(1u, bc->get_txpool_tx_count(false));
+  ASSERT_EQ(2u, bc->get_txpool_tx_count(true));
+  ASSERT_EQ(1u, db->get_txpool_tx_count(cryptonote::relay_category::broadcasted));
+  ASSERT_EQ(2u, db->get_txpool_tx_count(cryptonote::relay_category::all));
+}
+
+TEST(txpool_write_behind, flush_deferred_while_batch_open)
+{
+  PREFIX;
+  const crypto::hash a = crypto::rand<crypto::hash>();
+
+  bc->add_txpool_tx(a, "a", make_meta(cryptonote::relay_method::block));
+  ASSERT_TRUE(db->batch_start());
+  ASSERT_EQ(0u, bc->flush_txpool_writes());
+  ASSERT_EQ(1u, bc->get_txpool_pending_write_count());
+  ASSERT_TRUE(db->txpool.empty());
+
+  // the open batch aborting does not lose the change
+  db->batch_abort();
+  ASSERT_TRUE(bc->txpool_has_tx(a, cryptonote::relay_category::broadcasted));
+  ASSERT_EQ(1u, bc->flush_txpool_writes());
+  ASSERT_EQ(0u, bc->get_txpool_pending_write_count());
+  ASSERT_EQ(1u, db->txpool.count(a));
+  ASSERT_FALSE(db->in_batch);
+}
+
+TEST(txpool_write_behind, restore_on_failure)
+{
+  PREFIX;
+  const crypto::hash a = crypto::rand<crypto::hash>(), b = crypto::rand<crypto::hash>();
+
+  bc->add_txpool_tx(a, "a", make_meta(cryptonote::relay_method::block));
+  ASSERT_EQ(1u, bc->flush_txpool_writes());
+  bc->update_txpool_tx(a, make_meta(cryptonote::relay_method::block, 5));
+  bc->add_txpool_tx(b, "b", make_meta(cryptonote::relay_method::block));
+
+  db->fail_writes = true;
+  ASSERT_EQ(0u, bc->flush_txpool_writes());
+  ASSERT_FALSE(db->in_batch);
+  ASSERT_EQ(2u, bc->get_txpool_pending_write_count());
+  ASSERT_EQ(1u, db->txpool.size());
+  ASSERT_EQ(0u, db->txpool[a].second.fee);
+  cryptonote::txpool_tx_meta_t meta;
+  ASSERT_TRUE(bc->get_txpool_tx_meta(a, meta));
+  ASSERT_EQ(5u, meta.fee);
+  ASSERT_EQ("b", bc->get_txpool_tx_blob(b, cryptonote::relay_category::broadcasted));
+
+  // turning write-behind off needs a flush, so it stays on
+  bc->set_txpool_write_behind(false);
+  ASSERT_TRUE(bc->get_txpool_write_behind());
+
+  db->fail_writes = false;
+  ASSERT_EQ(2u, bc->flush_txpool_writes());
+  ASSERT_EQ(0u, bc->get_txpool_pending_write_count());
+  ASSERT_EQ(5u, db->txpool[a].second.fee);
+  ASSERT_EQ("b", db->txpool[b].first);
+
+  bc->set_txpool_write_behind(false);
+  ASSERT_FALSE(bc->get_txpool_write_behind());
+}
@@ -27,14 +27,21 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <boost/filesystem.hpp>
 #include <boost/preprocessor/stringize.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
 #include <gtest/gtest.h>
+#include <thread>
 #include <rapidjson/document.h>
 
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/events.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_basic/tx_extra.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "int-util.h"
 #include "json_serialization.h"
 #include "net/zmq.h"
 #include "rpc/message.h"
@@ -728,6 +735,119 @@ TEST_F(zmq_pub, JsonAll)
   }
 }
 
+TEST_F(zmq_pub, BinFullMinerTemplate)
+{
+  static constexpr const char topic[] = "\1bin-full-miner_template";
+  static constexpr const std::size_t reserve_size = 8;
+
+  ASSERT_TRUE(sub_request(topic));
+
+  const boost::filesystem::path data_dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  boost::program_options::options_description desc;
+  cryptonote::core::init_options(desc);
+  const std::vector<std::string> args = {
+    "--regtest", "--fixed-difficulty=1", "--offline", "--data-dir=" + data_dir.string(), "--quantum-deferred-signing",
+    "--miner-template-address=" + cryptonote::get_account_address_as_str(cryptonote::FAKECHAIN, false, acct.get_keys().m_account_address),
+    "--miner-template-reserve-size=" + std::to_string(reserve_size)
+  };
+  boost::program_options::variables_map vm;
+  boost::program_options::store(boost::program_options::command_line_parser(args).options(desc).run(), vm);
+  boost::program_options::notify(vm);
+
+  cryptonote::core core{nullptr};
+  ASSERT_TRUE(core.init(vm));
+  cryptonote::Blockchain& chain = core.get_blockchain_storage();
+  chain.add_miner_template_notify(cryptonote::listener::zmq_pub::miner_template{pub});
+
+  // the template is built on the blockchain's async thread
+  chain.update_miner_template();
+  bool relayed = false;
+  for (unsigned i = 0; i < 1000 && !relayed; ++i)
+  {
+    relayed = pub->relay_to_pub(relay.get(), dummy_pub.get());
+    if (!relayed)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  const uint64_t chain_height = chain.get_current_blockchain_height();
+  const crypto::hash seed_id = chain.get_block_id_by_height(crypto::rx_seedheight(chain_height));
+  core.deinit();
+  boost::filesystem::remove_all(data_dir);
+  ASSERT_TRUE(relayed);
+
+  const auto messages = get_messages(dummy_client.get());
+  ASSERT_EQ(1u, messages.size());
+  const std::string& message = messages.front();
+  const std::size_t split = message.find(':');
+  ASSERT_NE(std::string::npos, split);
+  EXPECT_EQ("bin-full-miner_template", message.substr(0, split));
+
+  std::size_t pos = split + 1;
+  const auto read = [&message, &pos](void* out, std::size_t size) {
+    if (message.size() - pos < size)
+      return false;
+    std::memcpy(out, message.data() + pos, size);
+    pos += size;
+    return true;
+  };
+  const auto read_u64 = [&read](uint64_t& out) {
+    if (!read(std::addressof(out), sizeof(out)))
+      return false;
+    out = SWAP64LE(out);
+    return true;
+  };
+  const auto read_blob = [&read, &read_u64](cryptonote::blobdata& out) {
+    uint64_t size = 0;
+    if (!read_u64(size) || size > std::numeric_limits<std::size_t>::max())
+      return false;
+    out.resize(size);
+    return read(std::addressof(out[0]), size);
+  };
+
+  uint64_t height = 0, diff_lo = 0, diff_hi = 0, reserved_offset = 0;
+  crypto::hash seed_hash{};
+  cryptonote::blobdata hashing_blob, template_blob;
+  ASSERT_TRUE(read_u64(height));
+  ASSERT_TRUE(read_u64(diff_lo));
+  ASSERT_TRUE(read_u64(diff_hi));
+  ASSERT_TRUE(read(seed_hash.data, sizeof(seed_hash.data)));
+  ASSERT_TRUE(read_u64(reserved_offset));
+  ASSERT_TRUE(read_blob(hashing_blob));
+  ASSERT_TRUE(read_blob(template_blob));
+  EXPECT_EQ(message.size(), pos);
+
+  EXPECT_EQ(chain_height, height);
+  EXPECT_EQ(1u, diff_lo);
+  EXPECT_EQ(0u, diff_hi);
+  EXPECT_EQ(seed_id, seed_hash);
+
+  cryptonote::block b;
+  ASSERT_TRUE(cryptonote::parse_and_validate_block_from_blob(template_blob, b));
+  EXPECT_EQ(cryptonote::get_block_hashing_blob(b), hashing_blob);
+  EXPECT_EQ(height, cryptonote::get_block_height(b));
+
+  // the coinbase pays the configured address
+  std::vector<std::size_t> outs;
+  uint64_t money = 0;
+  ASSERT_TRUE(cryptonote::lookup_acc_outs(acct.get_keys(), b.miner_tx, outs, money));
+  EXPECT_FALSE(outs.empty());
+
+  // the reserve follows the tx pub key, its extra nonce tag and size, and is zeroed
+  const crypto::public_key tx_pub_key = cryptonote::get_tx_pub_key_from_extra(b.miner_tx);
+  ASSERT_LE(sizeof(tx_pub_key) + 2, reserved_offset);
+  ASSERT_LE(reserved_offset + reserve_size, template_blob.size());
+  EXPECT_EQ(0, std::memcmp(template_blob.data() + reserved_offset - 2 - sizeof(tx_pub_key), &tx_pub_key, sizeof(tx_pub_key)));
+  EXPECT_EQ(TX_EXTRA_NONCE, (uint8_t)template_blob[reserved_offset - 2]);
+  EXPECT_EQ(reserve_size, (uint8_t)template_blob[reserved_offset - 1]);
+  EXPECT_EQ(std::string(reserve_size, '\0'), template_blob.substr(reserved_offset, reserve_size));
+
+  // a miner writing its nonce there gets a valid block
+  cryptonote::blobdata mined_blob = template_blob;
+  mined_blob.replace(reserved_offset, sizeof(uint32_t), "\1\2\3\4", sizeof(uint32_t));
+  cryptonote::block mined;
+  ASSERT_TRUE(cryptonote::parse_and_validate_block_from_blob(mined_blob, mined));
+  EXPECT_NE(cryptonote::get_block_hash(b), cryptonote::get_block_hash(mined));
+}
+
 TEST_F(zmq_pub, JsonChainWeakPtrSkip)
 {
   static constexpr const char topic[] = "\1json";
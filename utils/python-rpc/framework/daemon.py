@@ -271,6 +271,14 @@ class Daemon(object):
         }
         return self.rpc.send_request('/get_transaction_pool_hashes', get_transaction_pool_hashes)
 
+    def get_txpool_changes(self, log_id = 0, since_seq = 0, client = ""):
+        get_txpool_changes = {
+            'log_id': log_id,
+            'since_seq': since_seq,
+            'client': client,
+        }
+        return self.rpc.send_request('/get_txpool_changes', get_txpool_changes)
+
     def get_transaction_pool_stats(self, client = ""):
         get_transaction_pool_stats = {
             'client': client,